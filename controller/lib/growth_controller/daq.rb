@@ -19,6 +19,7 @@ class ControllerModuleDAQ < ControllerModule
 		define_command("resume")
 		define_command("status")
 		define_command("switch_output")
+		define_command("set_parameters")
 
 		@context = zmq_context
 		connect()
@@ -105,6 +106,20 @@ class ControllerModuleDAQ < ControllerModule
 		return send_command({command: "startNewOutputFile"})
 	end
 
+	# Changes trigger thresholds without stopping acquisition, e.g.
+	# {"parameters": {"TriggerThresholds": [600, 600, 600, 600]}, "board": 0}
+	def set_parameters(option_json)
+		log_debug("set_parameters command invoked")
+		if(option_json["parameters"]==nil)then
+			return {status: "error", message: "daq.set_parameters command requires parameters option"}
+		end
+		command = {command: "setParameters", parameters: option_json["parameters"]}
+		if(option_json["board"]!=nil)then
+			command[:board] = option_json["board"].to_i
+		end
+		return send_command(command)
+	end
+
 end
 
 end
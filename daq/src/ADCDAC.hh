@@ -105,16 +105,21 @@ public:
 
 private:
 	void dumpError(int status) {
-		if (status < 0) {
+		if (status < 0 && !quiet) {
 			printf("Error: %s\n", strerror(errno));
 		}
 	}
 
 private:
 	bool initialized = false;
+	bool quiet = false;
 
 public:
-	ADCDAC(){
+	/** @param[in] quiet if true, SPI errors are not printed (the caller checks the returned
+	 * status instead); used for periodic reads during acquisition
+	 */
+	ADCDAC(bool quiet = false) :
+			quiet(quiet) {
 		initialize();
 	}
 
@@ -140,7 +145,7 @@ private:
 public:
 	/** Reads ADC value.
 	 * @param[in] channel ADC channel 0-7 (0-3 are temperature sensor)
-	 * @return 12-bit ADC value
+	 * @return 12-bit ADC value, or a negative ADCDACError
 	 */
 	int16_t readADC(size_t channel) {
 		int status;
@@ -168,6 +173,10 @@ public:
 		}
 #endif
 
+		if (status == -1) {
+			return SPICommunicationError;
+		}
+
 		return (data[1] & 0x0F) * 0x100 + data[2];
 	}
 
@@ -310,7 +319,9 @@ public:
 
 		//dump message if error code is returned
 		if (status == -1) {
-			printf("Error: %s (%08x\n)\n", strerror(errno), errno);
+			if (!quiet) {
+				printf("Error: %s (%08x\n)\n", strerror(errno), errno);
+			}
 			return SPICommunicationError;
 		}
 
@@ -355,7 +366,9 @@ public:
 
 		//dump message if error code is returned
 		if (status == -1) {
-			printf("Error: %s (%08x\n)\n", strerror(errno), errno);
+			if (!quiet) {
+				printf("Error: %s (%08x\n)\n", strerror(errno), errno);
+			}
 			return SPICommunicationError;
 		}
 
@@ -0,0 +1,169 @@
+#ifndef SRC_BASELINEESTIMATOR_HH_
+#define SRC_BASELINEESTIMATOR_HH_
+
+#include <cmath>
+#include "GROWTH_FY2015_ADC.hh"
+
+/** Streaming per-channel baseline estimator.
+ * For each event, the mean of the pre-trigger samples (or EventBatch::baseline
+ * computed by the FPGA when waveform is not available) is fed to an
+ * exponentially weighted moving average. Deviations larger than
+ * MaximumUpdateInADC are clipped so that pile-up in the pre-trigger region
+ * does not pull the estimate. The estimate is used to fill
+ * EventBatch::baselineCorrectedPHA (= phaMax - baseline).
+ *
+ * Drift is monitored by comparing the estimate with the value at the end of
+ * the warm-up period, and by fitting baseline vs temperature with the
+ * temperature samples given via addTemperatureSample().
+ */
+class BaselineEstimator {
+public:
+	/** Per-channel status returned by getStatus().
+	 */
+	struct Status {
+		bool valid; // false until the warm-up period completes
+		double baseline; // current estimate
+		double referenceBaseline; // estimate at the end of the warm-up period
+		double drift; // baseline - referenceBaseline
+		double temperature; // latest temperature sample (degC)
+		double driftPerDegC; // slope of baseline vs temperature (0 if not enough samples)
+	};
+
+public:
+	/** @param[in] timeConstantInEvents number of events over which the average is taken (1/weight)
+	 * @param[in] nPreTriggerSamples number of leading waveform samples used as baseline
+	 * @param[in] nChannels number of channels (counted over all boards, see GROWTH_FY2015_ADC_Type::getGlobalChannelIndex())
+	 */
+	BaselineEstimator(double timeConstantInEvents, size_t nPreTriggerSamples,
+			size_t nChannels = SpaceFibreADC::NumberOfChannels) :
+			nPreTriggerSamples(nPreTriggerSamples), channels(nChannels) {
+		weight = (timeConstantInEvents > 1) ? 1.0 / timeConstantInEvents : 1.0;
+		nWarmUpEvents = std::max<size_t>(static_cast<size_t>(timeConstantInEvents) * 3, 1);
+	}
+
+public:
+	/** Updates the estimates, and fills baselineCorrectedPHA of events.
+	 * @param[in,out] events decoded events
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		mutex.lock();
+		for (size_t i = 0; i < events.size(); i++) {
+			const size_t ch = events.getGlobalChannelIndex(i);
+			if (ch >= channels.size()) {
+				continue;
+			}
+			Channel& channel = channels[ch];
+			update(channel, measureBaseline(events, i));
+			events.baselineCorrectedPHA[i] = static_cast<float>(events.phaMax[i] - channel.baseline);
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Records a temperature sample of the ADC board for the drift fit.
+	 * @param[in] temperature temperature in degC
+	 */
+	void addTemperatureSample(double temperature) {
+		mutex.lock();
+		for (auto& channel : channels) {
+			channel.temperature = temperature;
+			if (channel.nEvents < nWarmUpEvents) {
+				continue;
+			}
+			channel.nFitSamples++;
+			channel.sumT += temperature;
+			channel.sumB += channel.baseline;
+			channel.sumTT += temperature * temperature;
+			channel.sumTB += temperature * channel.baseline;
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Returns the number of channels (counted over all boards).
+	 */
+	size_t getNChannels() const {
+		return channels.size();
+	}
+
+public:
+	/** Returns status of a channel.
+	 * @param[in] ch channel index counted over all boards
+	 */
+	Status getStatus(size_t ch) {
+		Status status { };
+		if (ch >= channels.size()) {
+			return status;
+		}
+		mutex.lock();
+		const Channel& channel = channels[ch];
+		status.valid = channel.nEvents >= nWarmUpEvents;
+		status.baseline = channel.baseline;
+		status.referenceBaseline = channel.referenceBaseline;
+		status.drift = status.valid ? channel.baseline - channel.referenceBaseline : 0;
+		status.temperature = channel.temperature;
+		const double n = static_cast<double>(channel.nFitSamples);
+		const double denominator = n * channel.sumTT - channel.sumT * channel.sumT;
+		if (channel.nFitSamples >= MinimumNFitSamples && std::fabs(denominator) > 1e-9) {
+			status.driftPerDegC = (n * channel.sumTB - channel.sumT * channel.sumB) / denominator;
+		}
+		mutex.unlock();
+		return status;
+	}
+
+private:
+	struct Channel {
+		size_t nEvents = 0;
+		double baseline = 0;
+		double referenceBaseline = 0;
+		double temperature = 0;
+		size_t nFitSamples = 0;
+		double sumT = 0;
+		double sumB = 0;
+		double sumTT = 0;
+		double sumTB = 0;
+	};
+
+private:
+	double measureBaseline(const GROWTH_FY2015_ADC_Type::EventBatch& events, size_t i) const {
+		if (nPreTriggerSamples == 0 || events.nSamples[i] <= nPreTriggerSamples) {
+			return events.baseline[i];
+		}
+		const uint16_t* waveform = events.getWaveform(i);
+		uint32_t sum = 0;
+		for (size_t o = 0; o < nPreTriggerSamples; o++) {
+			sum += waveform[o];
+		}
+		return static_cast<double>(sum) / nPreTriggerSamples;
+	}
+
+private:
+	void update(Channel& channel, double value) {
+		if (channel.nEvents == 0) {
+			channel.baseline = value;
+		} else {
+			double delta = value - channel.baseline;
+			if (delta > MaximumUpdateInADC) {
+				delta = MaximumUpdateInADC;
+			} else if (delta < -MaximumUpdateInADC) {
+				delta = -MaximumUpdateInADC;
+			}
+			channel.baseline += weight * delta;
+		}
+		channel.nEvents++;
+		if (channel.nEvents == nWarmUpEvents) {
+			channel.referenceBaseline = channel.baseline;
+		}
+	}
+
+private:
+	static constexpr double MaximumUpdateInADC = 20.0;
+	static const size_t MinimumNFitSamples = 3;
+	double weight;
+	size_t nWarmUpEvents;
+	size_t nPreTriggerSamples;
+	std::vector<Channel> channels;
+	CxxUtilities::Mutex mutex;
+};
+
+#endif /* SRC_BASELINEESTIMATOR_HH_ */
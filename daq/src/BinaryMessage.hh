@@ -0,0 +1,201 @@
+#ifndef SRC_BINARYMESSAGE_HH_
+#define SRC_BINARYMESSAGE_HH_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/** Compact binary encoding of MessageServer commands and replies.
+ * A message whose first byte is Magic is decoded as a binary message;
+ * otherwise it is parsed as JSON. All multi-byte values are little endian.
+ * <ul>
+ *   <li> Request: Magic (u8), schema version (u8), CommandID (u8), reserved (u8), arguments </li>
+ *   <li> Reply: Magic (u8), schema version (u8), CommandID (u8), Status (u8), UNIX time (u32), fields </li>
+ * </ul>
+ * Fields of a reply are only appended (never reordered) when SchemaVersion is
+ * incremented, so a client can read the prefix it knows. An error reply
+ * carries a message (u16 length + characters) instead of fields.
+ * Arguments and fields of each command are documented at CommandID.
+ */
+class BinaryMessage {
+public:
+	static const uint8_t Magic = 0xC7; // not a valid first byte of a JSON text
+	static const uint8_t SchemaVersion = 1;
+	static const size_t RequestHeaderSize = 4;
+	static const size_t ReplyHeaderSize = 8;
+
+public:
+	enum CommandID : uint8_t {
+		Ping = 1, // no arguments/fields
+		Stop = 2, // no arguments/fields
+		Pause = 3, // no arguments/fields
+		Resume = 4, // no arguments/fields
+		/** fields: daqStatus (u8, 1 = Running), boardConnected (u8), burstActive (u8), gpsFixValid (u8),
+		 * elapsedTime (u32), nEvents (u64), elapsedTimeOfCurrentOutputFile (u32), nEventsOfCurrentOutputFile (u64),
+		 * nBursts (u32), nLateEvents (u64), nCoincidences (u64), nVetoedEvents (u64), nDroppedEvents (u64),
+		 * nClockJumps (u32), clockRateRatio (f64), nLinkFailures (u32), nLinkRecoveries (u32),
+		 * ssdtpNResyncs (u64), ssdtpNDiscardedBytes (u64), outputFileName (string) */
+		GetStatus = 5,
+		StartNewOutputFile = 6, // no arguments/fields
+		/** arguments: lastNMinutes (f64, optional)
+		 * fields: binWidthInSec (f64), startTimeInSec (f64), nChannels (u16), nBands (u16), nBins (u32),
+		 * energy band boundaries (u32 x (nBands + 1)), counts[channel][band][bin] (u32 x nChannels x nBands x nBins) */
+		GetLightCurve = 7,
+		/** arguments: board (u8), flags (u8; bit 0 = TriggerThresholds, bit 1 = TriggerCloseThresholds follow),
+		 * TriggerThresholds (u16 x 4), TriggerCloseThresholds (u16 x 4) */
+		SetParameters = 8
+	};
+
+public:
+	enum Status : uint8_t {
+		OK = 0, //
+		Error = 1, // the command failed (see the message)
+		InvalidMessage = 2, // malformed header or arguments
+		UnknownCommand = 3, //
+		UnsupportedSchemaVersion = 4 // the request is newer than the server; the reply has the server's version
+	};
+
+public:
+	/** Appends values to a byte buffer.
+	 */
+	class Writer {
+	public:
+		Writer(std::vector<uint8_t>& buffer) :
+				buffer(buffer) {
+		}
+
+	public:
+		void putUInt8(uint8_t value) {
+			buffer.push_back(value);
+		}
+
+	public:
+		void putUInt16(uint16_t value) {
+			putLittleEndian(value, 2);
+		}
+
+	public:
+		void putUInt32(uint32_t value) {
+			putLittleEndian(value, 4);
+		}
+
+	public:
+		void putUInt64(uint64_t value) {
+			putLittleEndian(value, 8);
+		}
+
+	public:
+		void putDouble(double value) {
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			putLittleEndian(bits, 8);
+		}
+
+	public:
+		/** Writes a u16 length followed by characters (truncated to 65535 characters).
+		 */
+		void putString(const std::string& value) {
+			const size_t length = (value.size() < UINT16_MAX) ? value.size() : UINT16_MAX;
+			putUInt16(static_cast<uint16_t>(length));
+			buffer.insert(buffer.end(), value.begin(), value.begin() + length);
+		}
+
+	public:
+		size_t size() const {
+			return buffer.size();
+		}
+
+	public:
+		/** Discards bytes written after the specified size.
+		 */
+		void truncate(size_t size) {
+			buffer.resize(size);
+		}
+
+	private:
+		void putLittleEndian(uint64_t value, size_t nBytes) {
+			for (size_t i = 0; i < nBytes; i++) {
+				buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+			}
+		}
+
+	private:
+		std::vector<uint8_t>& buffer;
+	};
+
+public:
+	/** Reads values from a byte buffer. Reading beyond the end returns 0 and marks the reader as failed.
+	 */
+	class Reader {
+	public:
+		Reader(const uint8_t* data, size_t size) :
+				data(data), size(size) {
+		}
+
+	public:
+		uint8_t getUInt8() {
+			return static_cast<uint8_t>(getLittleEndian(1));
+		}
+
+	public:
+		uint16_t getUInt16() {
+			return static_cast<uint16_t>(getLittleEndian(2));
+		}
+
+	public:
+		uint32_t getUInt32() {
+			return static_cast<uint32_t>(getLittleEndian(4));
+		}
+
+	public:
+		uint64_t getUInt64() {
+			return getLittleEndian(8);
+		}
+
+	public:
+		double getDouble() {
+			const uint64_t bits = getLittleEndian(8);
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+	public:
+		/** Returns the number of bytes not read yet.
+		 */
+		size_t getRemainingSize() const {
+			return size - position;
+		}
+
+	public:
+		/** Returns false if a value was read beyond the end of the buffer.
+		 */
+		bool isValid() const {
+			return valid;
+		}
+
+	private:
+		uint64_t getLittleEndian(size_t nBytes) {
+			if (size - position < nBytes) {
+				valid = false;
+				position = size;
+				return 0;
+			}
+			uint64_t value = 0;
+			for (size_t i = 0; i < nBytes; i++) {
+				value |= static_cast<uint64_t>(data[position + i]) << (i * 8);
+			}
+			position += nBytes;
+			return value;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t position = 0;
+		bool valid = true;
+	};
+};
+
+#endif /* SRC_BINARYMESSAGE_HH_ */
@@ -0,0 +1,145 @@
+#ifndef SRC_BOARDREADER_HH_
+#define SRC_BOARDREADER_HH_
+
+#include "GROWTH_FY2015_ADC.hh"
+#include "Logger.hh"
+
+/** Thread which reads events from the EventFIFO of one ADC board.
+ * When multiple boards are connected to one growth_daq process, one
+ * BoardReader runs per board so that a slow UART link of one board does
+ * not delay readout of the others. Each board has its own
+ * RMAPHandlerUART and EventDecoder (held by GROWTH_FY2015_ADC).
+ * Decoded events are tagged with the board index, and buffered in an
+ * EventBatch until MainThread takes them with popEvents().
+ *
+ * When an RMAP transaction fails (link failure), the reader stops reading
+ * and reports it via hasLinkFailed(). MainThread recovers the link and then
+ * calls resume().
+ */
+class BoardReader: public CxxUtilities::StoppableThread {
+public:
+	/** @param[in] boardIndex index of the board (0 to MaxNumberOfBoards-1)
+	 * @param[in] adcBoard board instance (not owned by this instance)
+	 * @param[in] waitDurationInMillisec wait time after a read which returned no event
+	 */
+	BoardReader(size_t boardIndex, GROWTH_FY2015_ADC* adcBoard, uint32_t waitDurationInMillisec) :
+			boardIndex(boardIndex), adcBoard(adcBoard), waitDurationInMillisec(waitDurationInMillisec) {
+	}
+
+public:
+	void run() {
+		using namespace std;
+		while (!stopped) {
+			size_t nReceivedEvents = 0;
+			readMutex.lock();
+			if (!suspended) {
+				try {
+					readEvents.clear();
+					nReceivedEvents = adcBoard->getEvents(readEvents);
+					if (nReceivedEvents != 0) {
+						std::fill(readEvents.boardIndex.begin(), readEvents.boardIndex.end(),
+								static_cast<uint8_t>(boardIndex));
+						queueMutex.lock();
+						if (eventQueue.empty()) {
+							eventQueue.swap(readEvents);
+						} else {
+							eventQueue.append(readEvents);
+						}
+						queueMutex.unlock();
+					}
+				} catch (RMAPHandler::RMAPHandlerException& e) {
+					Logger::error() << "BoardReader: link failure on board " << boardIndex;
+					suspended = true;
+					linkFailed = true;
+				} catch (CxxUtilities::Exception& e) {
+					Logger::error() << "BoardReader: link failure on board " << boardIndex;
+					suspended = true;
+					linkFailed = true;
+				}
+			}
+			readMutex.unlock();
+			if (nReceivedEvents == 0) {
+				c.wait(waitDurationInMillisec);
+			}
+		}
+	}
+
+public:
+	/** Moves buffered events to the end of the specified batch.
+	 * @return the number of events moved
+	 */
+	size_t popEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		queueMutex.lock();
+		const size_t nEvents = eventQueue.size();
+		if (events.empty()) {
+			events.swap(eventQueue);
+		} else {
+			events.append(eventQueue);
+		}
+		eventQueue.clear();
+		queueMutex.unlock();
+		return nEvents;
+	}
+
+public:
+	/** Stops reading the EventFIFO. When this method returns, the reader does
+	 * not access the board until resume() is called.
+	 */
+	void suspend() {
+		readMutex.lock();
+		suspended = true;
+		readMutex.unlock();
+	}
+
+public:
+	/** Restarts reading the EventFIFO (e.g. after link recovery).
+	 */
+	void resume() {
+		readMutex.lock();
+		suspended = false;
+		linkFailed = false;
+		readMutex.unlock();
+	}
+
+public:
+	/** Stops reading as if the reader had detected a link failure
+	 * (used when an access from another thread failed).
+	 */
+	void reportLinkFailure() {
+		readMutex.lock();
+		suspended = true;
+		linkFailed = true;
+		readMutex.unlock();
+	}
+
+public:
+	/** Returns true if reading stopped because of a link failure.
+	 */
+	bool hasLinkFailed() const {
+		return linkFailed;
+	}
+
+public:
+	size_t getBoardIndex() const {
+		return boardIndex;
+	}
+
+public:
+	GROWTH_FY2015_ADC* getADCBoard() const {
+		return adcBoard;
+	}
+
+private:
+	size_t boardIndex;
+	GROWTH_FY2015_ADC* adcBoard;
+	uint32_t waitDurationInMillisec;
+	bool suspended = false;
+	bool linkFailed = false;
+	GROWTH_FY2015_ADC_Type::EventBatch readEvents; // used only by the reader thread
+	GROWTH_FY2015_ADC_Type::EventBatch eventQueue;
+	CxxUtilities::Mutex readMutex;
+	CxxUtilities::Mutex queueMutex;
+	CxxUtilities::Condition c;
+};
+
+#endif /* SRC_BOARDREADER_HH_ */
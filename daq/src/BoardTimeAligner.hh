@@ -0,0 +1,152 @@
+#ifndef SRC_BOARDTIMEALIGNER_HH_
+#define SRC_BOARDTIMEALIGNER_HH_
+
+#include <cmath>
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+#include "TimeReconstructor.hh"
+
+/** Maps time tags of multiple boards to a common time base.
+ * Each board has its own 40-bit time tag counter, which starts when the board
+ * is programmed, so time tags of different boards cannot be compared. The
+ * GPS Time Register of every board latches the time tag at the PPS together
+ * with the GPS time, and the time tags latched at the same PPS give the
+ * offset between the counters. align() replaces EventBatch::timeTag with
+ * (timeTag + offset of the board) mod 2^40 before events reach the time-based
+ * stages (TimeOrderedEventMerger, CoincidenceBuilder, TimeReconstructor,
+ * LightCurve, BurstDetector), so that they see one time base.
+ *
+ * The common time base is the counter of the first board (offset 0). The
+ * offsets of the other boards are latched at the start of a run, and again
+ * whenever the registers are read, so that the drift between the oscillators
+ * of the boards is followed. The PPS signal has to be connected to all boards.
+ *
+ * When the counter of a board restarts (link recovery), restart() is called.
+ * Until the offset is latched again, the first event of the board is placed
+ * at the latest common time tag (as TimeTagUnwrapper::restartFrom()). A new
+ * offset of the first board is derived from the previous PPS and the elapsed
+ * GPS time (nominal clock interval), so that the common time base continues.
+ */
+class BoardTimeAligner {
+public:
+	/** @param[in] nBoards number of boards
+	 */
+	BoardTimeAligner(size_t nBoards) :
+			offsets(nBoards, 0), latched(nBoards, false), continuityPending(nBoards, false) {
+	}
+
+public:
+	/** Latches the offset of a board from its GPS Time Register (see GROWTH_FY2015_ADC::getGPSRegisterUInt8()).
+	 * @return false if the offset could not be latched (see latch())
+	 */
+	bool latchGPSTimeRegister(size_t boardIndex, const uint8_t* gpsTimeRegisterBuffer) {
+		uint64_t timeTag;
+		double utcTime;
+		if (!TimeReconstructor::parseGPSTimeRegister(gpsTimeRegisterBuffer, timeTag, utcTime)) {
+			return false;
+		}
+		return latch(boardIndex, timeTag, utcTime);
+	}
+
+public:
+	/** Latches the offset of a board from the time tag latched at a PPS.
+	 * A board other than the first one needs the first board latched at the
+	 * same PPS (the registers are read one after another; if a PPS came in
+	 * between, the first board should be latched again).
+	 * @param[in] timeTag time tag of the board latched at the PPS
+	 * @param[in] utcTime GPS time of the PPS (UNIX time in sec)
+	 * @return false if the board index is invalid, or the first board has not been latched at the same PPS
+	 */
+	bool latch(size_t boardIndex, uint64_t timeTag, double utcTime) {
+		if (boardIndex >= offsets.size()) {
+			return false;
+		}
+		timeTag &= TimeTagUnwrapper::TimeTagMask;
+		if (boardIndex == 0) {
+			if (!latched[0] && hasReference) {
+				// the counter restarted; the common time base continues from the previous PPS
+				const int64_t elapsedClocks = std::llround((utcTime - referenceUTCTime) / GROWTH_FY2015_ADC::ClockInterval);
+				offsets[0] = (referenceTimeTag + static_cast<uint64_t>(elapsedClocks) - timeTag)
+						& TimeTagUnwrapper::TimeTagMask;
+			}
+			latched[0] = true;
+			continuityPending[0] = false;
+			hasReference = true;
+			referenceTimeTag = (timeTag + offsets[0]) & TimeTagUnwrapper::TimeTagMask;
+			referenceUTCTime = utcTime;
+			return true;
+		}
+		if (!latched[0] || utcTime != referenceUTCTime) {
+			return false;
+		}
+		offsets[boardIndex] = (referenceTimeTag - timeTag) & TimeTagUnwrapper::TimeTagMask;
+		latched[boardIndex] = true;
+		continuityPending[boardIndex] = false;
+		return true;
+	}
+
+public:
+	/** Called when the time tag counter of a board has been restarted (the
+	 * board was reprogrammed after link recovery). Events of the board taken
+	 * before the restart should have been aligned.
+	 * @param[in] boardIndex index of the board
+	 */
+	void restart(size_t boardIndex) {
+		if (boardIndex < offsets.size()) {
+			latched[boardIndex] = false;
+			continuityPending[boardIndex] = true;
+		}
+	}
+
+public:
+	/** Maps time tags of events to the common time base.
+	 * @param[in,out] events events whose timeTag is replaced
+	 * @param[in] firstRow rows before this are not modified (already aligned)
+	 */
+	void align(GROWTH_FY2015_ADC_Type::EventBatch& events, size_t firstRow = 0) {
+		for (size_t i = firstRow; i < events.size(); i++) {
+			const uint8_t boardIndex = events.boardIndex[i];
+			if (boardIndex >= offsets.size()) {
+				continue;
+			}
+			const uint64_t timeTag = events.timeTag[i] & TimeTagUnwrapper::TimeTagMask;
+			if (continuityPending[boardIndex]) {
+				offsets[boardIndex] = (latestTimeTag - timeTag) & TimeTagUnwrapper::TimeTagMask;
+				continuityPending[boardIndex] = false;
+			}
+			const uint64_t alignedTimeTag = (timeTag + offsets[boardIndex]) & TimeTagUnwrapper::TimeTagMask;
+			events.timeTag[i] = alignedTimeTag;
+			if (!hasLatestTimeTag
+					|| ((alignedTimeTag - latestTimeTag) & TimeTagUnwrapper::TimeTagMask) < TimeTagUnwrapper::TimeTagModulo / 2) {
+				latestTimeTag = alignedTimeTag;
+				hasLatestTimeTag = true;
+			}
+		}
+	}
+
+public:
+	/** Returns true if the offset of the board has been latched since the start or the last restart().
+	 */
+	bool isLatched(size_t boardIndex) const {
+		return boardIndex < latched.size() && latched[boardIndex];
+	}
+
+public:
+	/** Returns the offset added to the time tags of a board (mod 2^40).
+	 */
+	uint64_t getOffset(size_t boardIndex) const {
+		return (boardIndex < offsets.size()) ? offsets[boardIndex] : 0;
+	}
+
+private:
+	std::vector<uint64_t> offsets; // per board
+	std::vector<bool> latched;
+	std::vector<bool> continuityPending; // restarted; offset is set by the next event
+	bool hasReference = false;
+	uint64_t referenceTimeTag = 0; // latest PPS of the first board in the common time base
+	double referenceUTCTime = 0;
+	bool hasLatestTimeTag = false;
+	uint64_t latestTimeTag = 0; // latest aligned time tag (any board)
+};
+
+#endif /* SRC_BOARDTIMEALIGNER_HH_ */
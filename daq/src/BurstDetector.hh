@@ -0,0 +1,187 @@
+#ifndef SRC_BURSTDETECTOR_HH_
+#define SRC_BURSTDETECTOR_HH_
+
+#include <algorithm>
+#include <cmath>
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+
+/** Streaming detector of count-rate enhancements (bursts/glows).
+ * Events are counted in bins whose width equals the short window. When a bin
+ * is completed, its count is compared with the mean count per bin over the
+ * preceding long window (background). A burst starts when the count exceeds
+ * the background by more than the specified number of sigma, and ends when
+ * no bin exceeded the threshold for the hold time. The background is frozen
+ * during a burst so that burst counts do not raise the threshold.
+ * Events processed while a burst is active are tagged with its burst ID
+ * (EventBatch::burstID, 1-origin; 0 means no burst). A burst is detected
+ * when its first bin is completed, i.e. by the first event of the next bin,
+ * so events in the first bin of a burst are not tagged (0); offline, they
+ * are the events within one short window before the first tagged event.
+ * Time tags of all boards have to be on a common time base (BoardTimeAligner),
+ * and are extended to 64 bit as one counter.
+ */
+class BurstDetector {
+public:
+	enum class Transition {
+		None, Started, Ended
+	};
+
+public:
+	/** @param[in] shortWindowInSec duration of the short (signal) window
+	 * @param[in] longWindowInSec duration of the long (background) window
+	 * @param[in] thresholdInSigma trigger threshold in unit of Poisson sigma of the background
+	 * @param[in] holdTimeInSec a burst ends after this duration without an excess
+	 * @param[in] nBoards number of boards whose events are counted (events of the other boards are not tagged)
+	 */
+	BurstDetector(double shortWindowInSec, double longWindowInSec, double thresholdInSigma, double holdTimeInSec,
+			size_t nBoards) :
+			thresholdInSigma(thresholdInSigma), nBoards(nBoards > 0 ? nBoards : 1) {
+		binWidthInClock = static_cast<uint64_t>(shortWindowInSec / GROWTH_FY2015_ADC::ClockInterval + 0.5);
+		if (binWidthInClock == 0) {
+			binWidthInClock = 1;
+		}
+		nBackgroundBins = static_cast<size_t>(longWindowInSec / shortWindowInSec + 0.5);
+		if (nBackgroundBins == 0) {
+			nBackgroundBins = 1;
+		}
+		nHoldBins = static_cast<size_t>(std::ceil(holdTimeInSec / shortWindowInSec));
+		backgroundCounts.assign(nBackgroundBins, 0);
+	}
+
+public:
+	/** Processes decoded events, and tags them with the current burst ID.
+	 * @param[in,out] events decoded events
+	 * @return Transition::Started or Transition::Ended if the burst state changed
+	 * during this call, otherwise Transition::None
+	 */
+	Transition process(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		const bool burstActiveAtStart = burstActive;
+		for (size_t i = 0; i < events.size(); i++) {
+			if (events.boardIndex[i] >= nBoards) {
+				events.burstID[i] = 0;
+				continue;
+			}
+			const uint64_t time = unwrapper.unwrap(events.timeTag[i]);
+			if (latestTime < time) {
+				latestTime = time;
+			}
+			const uint64_t binNumber = time / binWidthInClock;
+			if (!binInitialized) {
+				currentBinNumber = binNumber;
+				binInitialized = true;
+			}
+			if (currentBinNumber < binNumber) {
+				completeBin();
+				// empty bins in between; beyond the background window and the hold time,
+				// further empty bins do not change the state
+				const uint64_t nEmptyBins = std::min<uint64_t>(binNumber - currentBinNumber - 1,
+						nBackgroundBins + nHoldBins);
+				for (uint64_t k = 0; k < nEmptyBins; k++) {
+					completeBin();
+				}
+				currentBinNumber = binNumber;
+			}
+			currentBinCount++;
+			events.burstID[i] = burstActive ? burstID : 0;
+		}
+		if (burstActive != burstActiveAtStart) {
+			return burstActive ? Transition::Started : Transition::Ended;
+		}
+		return Transition::None;
+	}
+
+public:
+	/** Called when the time tag counter has been restarted (the board was
+	 * reprogrammed after link recovery) and time tags are not mapped to a
+	 * common time base (single board). The next event is placed at the latest
+	 * time processed so far.
+	 * @param[in] boardIndex index of the board
+	 */
+	void restartTimeTag(size_t boardIndex) {
+		if (boardIndex < nBoards) {
+			unwrapper.restartFrom(latestTime);
+		}
+	}
+
+public:
+	bool isBurstActive() const {
+		return burstActive;
+	}
+
+public:
+	/** Returns the ID of the latest burst (0 if no burst has been detected).
+	 */
+	uint32_t getLatestBurstID() const {
+		return burstID;
+	}
+
+public:
+	/** Returns the background count rate (counts/s) estimated from the long window.
+	 */
+	double getBackgroundRate() const {
+		if (nFilledBackgroundBins == 0) {
+			return 0;
+		}
+		return static_cast<double>(backgroundSum) / nFilledBackgroundBins
+				/ (binWidthInClock * GROWTH_FY2015_ADC::ClockInterval);
+	}
+
+private:
+	void completeBin() {
+		const uint64_t count = currentBinCount;
+		currentBinCount = 0;
+
+		// evaluate only after the background window has been filled
+		if (nFilledBackgroundBins == nBackgroundBins) {
+			const double mean = static_cast<double>(backgroundSum) / nBackgroundBins;
+			const double sigma = std::sqrt(mean > MinimumBackgroundCountPerBin ? mean : MinimumBackgroundCountPerBin);
+			const bool excess = count > mean + thresholdInSigma * sigma;
+			if (excess) {
+				nBinsSinceLastExcess = 0;
+				if (!burstActive) {
+					burstActive = true;
+					burstID++;
+				}
+			} else if (burstActive) {
+				nBinsSinceLastExcess++;
+				if (nBinsSinceLastExcess >= nHoldBins) {
+					burstActive = false;
+				}
+			}
+		}
+
+		// update background when quiet
+		if (!burstActive) {
+			backgroundSum -= backgroundCounts[backgroundIndex];
+			backgroundCounts[backgroundIndex] = count;
+			backgroundSum += count;
+			backgroundIndex = (backgroundIndex + 1) % nBackgroundBins;
+			if (nFilledBackgroundBins < nBackgroundBins) {
+				nFilledBackgroundBins++;
+			}
+		}
+	}
+
+private:
+	static constexpr double MinimumBackgroundCountPerBin = 1.0;
+	double thresholdInSigma;
+	uint64_t binWidthInClock;
+	size_t nBackgroundBins;
+	size_t nHoldBins;
+	size_t nBoards;
+	TimeTagUnwrapper unwrapper; // common to all boards
+	uint64_t latestTime = 0; // latest unwrapped time tag processed
+	bool binInitialized = false;
+	uint64_t currentBinNumber = 0;
+	uint64_t currentBinCount = 0;
+	std::vector<uint64_t> backgroundCounts;
+	uint64_t backgroundSum = 0;
+	size_t backgroundIndex = 0;
+	size_t nFilledBackgroundBins = 0;
+	size_t nBinsSinceLastExcess = 0;
+	bool burstActive = false;
+	uint32_t burstID = 0;
+};
+
+#endif /* SRC_BURSTDETECTOR_HH_ */
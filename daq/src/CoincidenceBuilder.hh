@@ -0,0 +1,189 @@
+#ifndef SRC_COINCIDENCEBUILDER_HH_
+#define SRC_COINCIDENCEBUILDER_HH_
+
+#include <chrono>
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+
+/** Groups events of different channels which occurred within a time window.
+ * Input events should be in time order (output of TimeOrderedEventMerger).
+ * A group starts at an event, and contains all the following events whose
+ * time tags are within coincidenceWindow of the first one. Events of a group
+ * which hit two or more channels share EventBatch::coincidenceID (1, 2, 3, ...;
+ * 0 = not in a coincidence), and EventBatch::multiplicity is set to the number
+ * of channels hit in the group.
+ *
+ * Channels listed as veto channels (e.g. a plastic scintillator covering the
+ * main detector) work as anti-coincidence: when a group contains an event of
+ * a veto channel, EventBatch::vetoFlag of the other events of the group is set
+ * to 1. If dropVetoedEvents is true, vetoed events are removed from the output.
+ *
+ * The last group of the given events may be completed by events processed
+ * later, and therefore is held until an event outside the window arrives, no
+ * event is given for maximumHoldTime (wall clock), or flush is requested.
+ * Channels are identified by GROWTH_FY2015_ADC_Type::getGlobalChannelIndex().
+ * Time tags of all boards have to be on a common time base (BoardTimeAligner),
+ * and are extended to 64 bit as one counter.
+ */
+class CoincidenceBuilder {
+public:
+	/** @param[in] nBoards number of boards
+	 * @param[in] coincidenceWindowInSec width of the coincidence window
+	 * @param[in] vetoChannels global channel indices of the veto channels
+	 * @param[in] dropVetoedEvents true if vetoed events should not be output
+	 * @param[in] maximumHoldTimeInSec maximum wall-clock time an incomplete group is held
+	 */
+	CoincidenceBuilder(size_t nBoards, double coincidenceWindowInSec, const std::vector<size_t>& vetoChannels,
+			bool dropVetoedEvents, double maximumHoldTimeInSec) :
+			nBoards(nBoards), isVetoChannel(nBoards * SpaceFibreADC::NumberOfChannels, false), //
+			dropVetoedEvents(dropVetoedEvents), maximumHoldTimeInSec(maximumHoldTimeInSec) {
+		coincidenceWindowInClock = static_cast<uint64_t>(coincidenceWindowInSec / GROWTH_FY2015_ADC::ClockInterval);
+		for (auto ch : vetoChannels) {
+			if (ch < isVetoChannel.size()) {
+				isVetoChannel[ch] = true;
+			}
+		}
+		timeOfLastInput = std::chrono::steady_clock::now();
+	}
+
+public:
+	/** Groups events, and replaces the content of the given batch with events of completed groups.
+	 * @param[in,out] events time-ordered events; on return, events to be written
+	 * @param[in] flush true if all held events should be output (e.g. at the end of a run)
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events, bool flush = false) {
+		const auto now = std::chrono::steady_clock::now();
+		if (events.size() != 0) {
+			timeOfLastInput = now;
+		} else if (std::chrono::duration<double>(now - timeOfLastInput).count() > maximumHoldTimeInSec) {
+			flush = true;
+		}
+
+		// events of the incomplete group of the previous call come first
+		if (group.size() != 0) {
+			group.append(events);
+			events.swap(group);
+			group.clear();
+		}
+		size_t groupStart = 0;
+		for (size_t i = groupChannels.size(); i < events.size(); i++) {
+			const size_t ch = events.getGlobalChannelIndex(i);
+			const uint64_t time = (events.boardIndex[i] < nBoards) ? unwrapper.unwrap(events.timeTag[i]) : 0;
+			events.coincidenceID[i] = 0;
+			events.multiplicity[i] = 1;
+			events.vetoFlag[i] = 0;
+			if (groupChannels.size() != 0 && time - groupStartTime > coincidenceWindowInClock) {
+				closeGroup(events, groupStart);
+				groupStart = i;
+			}
+			if (groupChannels.size() == 0) {
+				groupStartTime = time;
+			}
+			groupChannels.push_back(ch);
+		}
+		if (flush) {
+			closeGroup(events, groupStart);
+			groupStart = events.size();
+		}
+
+		// hold the incomplete group, and remove dropped events
+		group.append(events, groupStart, events.size());
+		outputIndices.clear();
+		for (size_t i = 0; i < groupStart; i++) {
+			if (dropVetoedEvents && events.vetoFlag[i] != 0) {
+				nDroppedEvents++;
+			} else {
+				outputIndices.push_back(i);
+			}
+		}
+		events.keep(outputIndices);
+	}
+
+public:
+	/** Returns the number of groups which hit two or more channels.
+	 */
+	uint64_t getNCoincidences() const {
+		return nCoincidences;
+	}
+
+public:
+	/** Returns the number of events flagged as vetoed.
+	 */
+	uint64_t getNVetoedEvents() const {
+		return nVetoedEvents;
+	}
+
+public:
+	/** Returns the number of vetoed events removed from the output.
+	 */
+	uint64_t getNDroppedEvents() const {
+		return nDroppedEvents;
+	}
+
+public:
+	/** Returns the number of events held in an incomplete group.
+	 */
+	size_t getNHeldEvents() const {
+		return groupChannels.size();
+	}
+
+private:
+	/** Sets coincidence fields of the group which starts at events[groupStart] (groupChannels.size() events).
+	 */
+	void closeGroup(GROWTH_FY2015_ADC_Type::EventBatch& events, size_t groupStart) {
+		if (groupChannels.size() == 0) {
+			return;
+		}
+		// count distinct channels, and check if a veto channel was hit
+		size_t multiplicity = 0;
+		bool vetoed = false;
+		for (size_t i = 0; i < groupChannels.size(); i++) {
+			bool firstHitOfChannel = true;
+			for (size_t o = 0; o < i; o++) {
+				if (groupChannels[o] == groupChannels[i]) {
+					firstHitOfChannel = false;
+					break;
+				}
+			}
+			if (firstHitOfChannel) {
+				multiplicity++;
+			}
+			if (groupChannels[i] < isVetoChannel.size() && isVetoChannel[groupChannels[i]]) {
+				vetoed = true;
+			}
+		}
+		uint32_t coincidenceID = 0;
+		if (multiplicity >= 2) {
+			nCoincidences++;
+			coincidenceID = static_cast<uint32_t>(nCoincidences);
+		}
+		for (size_t i = 0; i < groupChannels.size(); i++) {
+			const size_t index = groupStart + i;
+			events.coincidenceID[index] = coincidenceID;
+			events.multiplicity[index] = static_cast<uint8_t>(multiplicity);
+			if (vetoed && !(groupChannels[i] < isVetoChannel.size() && isVetoChannel[groupChannels[i]])) {
+				events.vetoFlag[index] = 1;
+				nVetoedEvents++;
+			}
+		}
+		groupChannels.clear();
+	}
+
+private:
+	size_t nBoards;
+	TimeTagUnwrapper unwrapper; // common to all boards
+	std::vector<bool> isVetoChannel; // indexed by global channel index
+	bool dropVetoedEvents;
+	double maximumHoldTimeInSec;
+	uint64_t coincidenceWindowInClock;
+	uint64_t groupStartTime = 0;
+	GROWTH_FY2015_ADC_Type::EventBatch group; // events of the incomplete group held over calls
+	std::vector<size_t> groupChannels; // global channel indices of the events of the group being built
+	std::vector<size_t> outputIndices;
+	uint64_t nCoincidences = 0;
+	uint64_t nVetoedEvents = 0;
+	uint64_t nDroppedEvents = 0;
+	std::chrono::steady_clock::time_point timeOfLastInput;
+};
+
+#endif /* SRC_COINCIDENCEBUILDER_HH_ */
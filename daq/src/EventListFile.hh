@@ -9,7 +9,9 @@
 #define EVENTLISTFILE_HH_
 
 #include "CxxUtilities/CxxUtilities.hh"
+#include "GROWTH_FY2015_ADCModules/EventBatch.hh"
 #include "GROWTH_FY2015_ADCModules/Types.hh"
+#include "NMEAParser.hh"
 
 /** Represents an event list file.
  */
@@ -28,7 +30,7 @@ public:
 	}
 
 public:
-	virtual void fillEvents(std::vector<GROWTH_FY2015_ADC_Type::Event*>& events) =0;
+	virtual void fillEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) =0;
 
 public:
 	virtual size_t getEntries() =0;
@@ -38,6 +40,13 @@ public:
 
 public:
 	virtual void fillGPSTime(uint8_t* gpsTimeRegisterBuffer) =0;
+
+public:
+	virtual void fillGPSFix(const NMEAParser::Fix& fix) =0;
+
+public:
+	virtual void fillParameterChange(uint8_t boardIndex, uint64_t timeTag, const std::string& parameter,
+			const std::string& value) =0;
 };
 
 #endif /* EVENTLISTFILE_HH_ */
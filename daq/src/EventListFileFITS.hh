@@ -14,12 +14,12 @@ extern "C" {
 #include "CxxUtilities/FitsUtility.hh"
 #include "GROWTH_FY2015_ADC.hh"
 #include "EventListFile.hh"
+#include "Logger.hh"
 
 class EventListFileFITS: public EventListFile {
 private:
 	fitsfile* outputFile;
 	std::string detectorID;
-	GROWTH_FY2015_ADC_Type::Event eventEntry;
 	std::string configurationYAMLFile;
 
 private:
@@ -71,6 +71,22 @@ private:
 		Column_waveform = 11
 	};
 
+	// optional columns appended via enableXxxColumn() (0 = disabled)
+	int column_burstID = 0;
+	int column_pulseIntegral = 0;
+	int column_riseTime = 0;
+	int column_fallTime = 0;
+	int column_tailTotalRatio = 0;
+	int column_pileUpFlags = 0;
+	int column_filteredPHA = 0;
+	int column_baselineCorrectedPHA = 0;
+	int column_coincidenceID = 0;
+	int column_multiplicity = 0;
+	int column_vetoFlag = 0;
+	int column_unwrappedTimeTag = 0;
+	int column_utcTime = 0;
+	int column_timeQualityFlags = 0;
+
 	//---------------------------------------------
 	// GPS Time Register HDU
 	//---------------------------------------------
@@ -96,6 +112,88 @@ private:
 		Column_gpsTime = 3
 	};
 
+	//---------------------------------------------
+	// GPS NMEA (position/fix) HDU
+	//---------------------------------------------
+	static const size_t nColumns_GPSNMEA = 8;
+	char* ttypes_GPSNMEA[nColumns_GPSNMEA] = { //
+			(char*) "unixTime", //
+					(char*) "utcTime", //
+					(char*) "latitude", //
+					(char*) "longitude", //
+					(char*) "altitude", //
+					(char*) "fixQuality", //
+					(char*) "nSatellites", //
+					(char*) "hdop" //
+			};
+	char* tforms_GPSNMEA[nColumns_GPSNMEA] = { //
+			(char*) "V", //
+					(char*) "D", //
+					(char*) "D", //
+					(char*) "D", //
+					(char*) "E", //
+					(char*) "B", //
+					(char*) "B", //
+					(char*) "E" //
+			};
+	char* tunits_GPSNMEA[nColumns_GPSNMEA] = { //
+			(char*) "s", //
+					(char*) "s", //
+					(char*) "deg", //
+					(char*) "deg", //
+					(char*) "m", //
+					(char*) "", //
+					(char*) "", //
+					(char*) "" //
+			};
+	enum columnIndices_GPSNMEA {
+		Column_GPSNMEA_unixTime = 1, //
+		Column_GPSNMEA_utcTime = 2, //
+		Column_GPSNMEA_latitude = 3, //
+		Column_GPSNMEA_longitude = 4, //
+		Column_GPSNMEA_altitude = 5, //
+		Column_GPSNMEA_fixQuality = 6, //
+		Column_GPSNMEA_nSatellites = 7, //
+		Column_GPSNMEA_hdop = 8
+	};
+
+	//---------------------------------------------
+	// Parameter change (marker) HDU
+	//---------------------------------------------
+	static const size_t nColumns_Parameters = 6;
+	char* ttypes_Parameters[nColumns_Parameters] = { //
+			(char*) "unixTime", //
+					(char*) "timeTag", //
+					(char*) "eventRow", //
+					(char*) "boardIndex", //
+					(char*) "parameter", //
+					(char*) "value" //
+			};
+	char* tforms_Parameters[nColumns_Parameters] = { //
+			(char*) "V", //
+					(char*) "K", //
+					(char*) "K", //
+					(char*) "B", //
+					(char*) "32A", //
+					(char*) "80A" //
+			};
+	char* tunits_Parameters[nColumns_Parameters] = { //
+			(char*) "s", //
+					(char*) "", //
+					(char*) "", //
+					(char*) "", //
+					(char*) "", //
+					(char*) "" //
+			};
+	enum columnIndices_Parameters {
+		Column_Parameters_unixTime = 1, //
+		Column_Parameters_timeTag = 2, //
+		Column_Parameters_eventRow = 3, //
+		Column_Parameters_boardIndex = 4, //
+		Column_Parameters_parameter = 5, //
+		Column_Parameters_value = 6
+	};
+
 private:
 	static const size_t InitialRowNumber = 1000;
 	static const size_t InitialRowNumber_GPS = 1000;
@@ -103,6 +201,8 @@ private:
 	bool outputFileIsOpen = false;
 	size_t rowIndex; // will be initialized in createOutputFITSFile()
 	size_t rowIndex_GPS; // will be initialized in createOutputFITSFile()
+	size_t rowIndex_GPSNMEA; // will be initialized in createOutputFITSFile()
+	size_t rowIndex_Parameters; // will be initialized in createOutputFITSFile()
 	size_t fitsNRows; //currently allocated rows
 	size_t rowExpansionStep = InitialRowNumber;
 	size_t nSamples;
@@ -130,6 +230,8 @@ private:
 
 		rowIndex = 0;
 		rowIndex_GPS = 0;
+		rowIndex_GPSNMEA = 0;
+		rowIndex_Parameters = 0;
 
 		size_t nColumns = nColumns_Event;
 
@@ -169,6 +271,16 @@ private:
 				&fitsStatus);
 		this->reportErrorThenQuitIfError(fitsStatus, __func__);
 
+		// Create GPS NMEA HDU (rows are appended as sampled)
+		fits_create_tbl(outputFile, tbltype, 0, nColumns_GPSNMEA, ttypes_GPSNMEA, tforms_GPSNMEA, tunits_GPSNMEA,
+				"GPSNMEA", &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+
+		// Create parameter change HDU (rows are appended when parameters are changed during acquisition)
+		fits_create_tbl(outputFile, tbltype, 0, nColumns_Parameters, ttypes_Parameters, tforms_Parameters,
+				tunits_Parameters, "PARAMETERS", &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+
 		fits_movnam_hdu(outputFile, tbltype, (char*) "EVENTS", 0, &fitsStatus);
 		this->reportErrorThenQuitIfError(fitsStatus, __func__);
 
@@ -176,6 +288,89 @@ private:
 		fitsAccessMutes.unlock();
 	}
 
+public:
+	/** Appends the burstID column (uint32_t) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enableBurstIDColumn() {
+		if (column_burstID == 0) {
+			column_burstID = appendEventColumn("burstID", "V");
+		}
+	}
+
+public:
+	/** Appends pulse-shape feature columns (pulseIntegral, riseTime, fallTime,
+	 * tailTotalRatio, pileUpFlags) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enablePulseShapeColumns() {
+		if (column_pulseIntegral == 0) {
+			column_pulseIntegral = appendEventColumn("pulseIntegral", "J");
+			column_riseTime = appendEventColumn("riseTime", "U");
+			column_fallTime = appendEventColumn("fallTime", "U");
+			column_tailTotalRatio = appendEventColumn("tailTotalRatio", "E");
+			column_pileUpFlags = appendEventColumn("pileUpFlags", "B");
+		}
+	}
+
+public:
+	/** Appends the filteredPHA column (float) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enableFilteredPHAColumn() {
+		if (column_filteredPHA == 0) {
+			column_filteredPHA = appendEventColumn("filteredPHA", "E");
+		}
+	}
+
+public:
+	/** Appends the baselineCorrectedPHA column (float) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enableBaselineCorrectedPHAColumn() {
+		if (column_baselineCorrectedPHA == 0) {
+			column_baselineCorrectedPHA = appendEventColumn("baselineCorrectedPHA", "E");
+		}
+	}
+
+public:
+	/** Appends coincidence columns (coincidenceID, multiplicity, vetoFlag) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enableCoincidenceColumns() {
+		if (column_coincidenceID == 0) {
+			column_coincidenceID = appendEventColumn("coincidenceID", "V");
+			column_multiplicity = appendEventColumn("multiplicity", "B");
+			column_vetoFlag = appendEventColumn("vetoFlag", "B");
+		}
+	}
+
+public:
+	/** Appends absolute-time columns (unwrappedTimeTag, utcTime, timeQualityFlags) to the EVENTS HDU.
+	 * Should be called before filling events.
+	 */
+	void enableTimeReconstructionColumns() {
+		if (column_unwrappedTimeTag == 0) {
+			column_unwrappedTimeTag = appendEventColumn("unwrappedTimeTag", "K");
+			column_utcTime = appendEventColumn("utcTime", "D");
+			column_timeQualityFlags = appendEventColumn("timeQualityFlags", "B");
+		}
+	}
+
+private:
+	/** Appends a column to the end of the EVENTS HDU, and returns its column number.
+	 */
+	int appendEventColumn(std::string ttype, std::string tform) {
+		fitsAccessMutes.lock();
+		int nColumns = 0;
+		fits_get_num_cols(outputFile, &nColumns, &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+		fits_insert_col(outputFile, nColumns + 1, (char*) ttype.c_str(), (char*) tform.c_str(), &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+		fitsAccessMutes.unlock();
+		return nColumns + 1;
+	}
+
 public:
 	~EventListFileFITS() {
 		close();
@@ -222,8 +417,8 @@ private:
 						"exposure specified via command line", &fitsStatus) //
 
 						) {
-			using namespace std;
-			cerr << "Error: while updating TTYPE comment for " << n << endl;
+			Logger::error() << "While updating TTYPE comment for " << n;
+			Logger::flush();
 			exit(-1);
 		}
 
@@ -240,8 +435,10 @@ private:
 private:
 	void reportErrorThenQuitIfError(int fitsStatus, std::string methodName) {
 		if (fitsStatus) { //if error
-			using namespace std;
-			cerr << "Error (" << methodName << "):";
+			char errorText[FLEN_STATUS];
+			fits_get_errstatus(fitsStatus, errorText);
+			Logger::error() << "CFITSIO error in " << methodName << " (" << fitsStatus << ": " << errorText << ")";
+			Logger::flush();
 			fits_report_error(stderr, fitsStatus);
 			exit(-1);
 		}
@@ -295,46 +492,182 @@ public:
 	}
 
 public:
-	void fillEvents(std::vector<GROWTH_FY2015_ADC_Type::Event*>& events) {
+	/** Fill an entry to the HDU containing the GPS solution decoded from NMEA sentences.
+	 * @param[in] fix latest solution of NMEAParser
+	 */
+	void fillGPSFix(const NMEAParser::Fix& fix) {
 		fitsAccessMutes.lock();
-		for (auto& event : events) {
-			rowIndex++;
-			//ch
-			fits_write_col(outputFile, TBYTE, Column_boardIndexAndChannel, rowIndex, firstElement, 1, &event->ch,
-					&fitsStatus);
-			//timeTag
-			fits_write_col(outputFile, TLONGLONG, Column_timeTag, rowIndex, firstElement, 1, &event->timeTag, &fitsStatus);
-			//triggerCount
-			fits_write_col(outputFile, TUSHORT, Column_triggerCount, rowIndex, firstElement, 1, &event->triggerCount,
-					&fitsStatus);
-			//phaMax
-			fits_write_col(outputFile, TUSHORT, Column_phaMax, rowIndex, firstElement, 1, &event->phaMax, &fitsStatus);
-			//phaMaxTime
-			fits_write_col(outputFile, TUSHORT, Column_phaMaxTime, rowIndex, firstElement, 1, &event->phaMaxTime,
-					&fitsStatus);
-			//phaMin
-			fits_write_col(outputFile, TUSHORT, Column_phaMin, rowIndex, firstElement, 1, &event->phaMin, &fitsStatus);
-			//phaFirst
-			fits_write_col(outputFile, TUSHORT, Column_phaFirst, rowIndex, firstElement, 1, &event->phaFirst, &fitsStatus);
-			//phaLast
-			fits_write_col(outputFile, TUSHORT, Column_phaLast, rowIndex, firstElement, 1, &event->phaLast, &fitsStatus);
-			//maxDerivative
-			fits_write_col(outputFile, TUSHORT, Column_maxDerivative, rowIndex, firstElement, 1, &event->maxDerivative,
-					&fitsStatus);
-			//baseline
-			fits_write_col(outputFile, TUSHORT, Column_baseline, rowIndex, firstElement, 1, &event->baseline, &fitsStatus);
-			if (nSamples != 0) {
-				//waveform
-				fits_write_col(outputFile, TUSHORT, Column_waveform, rowIndex, firstElement, nSamples, event->waveform,
-						&fitsStatus);
-			}
+		fits_movnam_hdu(outputFile, BINARY_TBL, (char*) "GPSNMEA", 0, &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+
+		rowIndex_GPSNMEA++;
+		uint32_t unixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		double utcTime = fix.utcTime;
+		double latitude = fix.latitude;
+		double longitude = fix.longitude;
+		float altitude = static_cast<float>(fix.altitude);
+		uint8_t fixQuality = fix.fixQuality;
+		uint8_t nSatellites = fix.nSatellites;
+		float hdop = static_cast<float>(fix.hdop);
+		fits_write_col(outputFile, TUINT, Column_GPSNMEA_unixTime, rowIndex_GPSNMEA, firstElement, 1, &unixTime,
+				&fitsStatus);
+		fits_write_col(outputFile, TDOUBLE, Column_GPSNMEA_utcTime, rowIndex_GPSNMEA, firstElement, 1, &utcTime,
+				&fitsStatus);
+		fits_write_col(outputFile, TDOUBLE, Column_GPSNMEA_latitude, rowIndex_GPSNMEA, firstElement, 1, &latitude,
+				&fitsStatus);
+		fits_write_col(outputFile, TDOUBLE, Column_GPSNMEA_longitude, rowIndex_GPSNMEA, firstElement, 1, &longitude,
+				&fitsStatus);
+		fits_write_col(outputFile, TFLOAT, Column_GPSNMEA_altitude, rowIndex_GPSNMEA, firstElement, 1, &altitude,
+				&fitsStatus);
+		fits_write_col(outputFile, TBYTE, Column_GPSNMEA_fixQuality, rowIndex_GPSNMEA, firstElement, 1, &fixQuality,
+				&fitsStatus);
+		fits_write_col(outputFile, TBYTE, Column_GPSNMEA_nSatellites, rowIndex_GPSNMEA, firstElement, 1, &nSatellites,
+				&fitsStatus);
+		fits_write_col(outputFile, TFLOAT, Column_GPSNMEA_hdop, rowIndex_GPSNMEA, firstElement, 1, &hdop, &fitsStatus);
+
+		//move back to EVENTS HDU
+		fits_movnam_hdu(outputFile, BINARY_TBL, (char*) "EVENTS", 0, &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+		fitsAccessMutes.unlock();
+	}
+
+public:
+	/** Records a parameter change made during acquisition.
+	 * eventRow is the number of rows in the EVENTS HDU when the change was
+	 * recorded, and timeTag is the time tag of the last event of the board
+	 * read before the change. Events of the board in rows up to eventRow were
+	 * taken with the old value. Rows after eventRow may still begin with events
+	 * taken with the old value which were in the EventFIFO of the board at the
+	 * change (their timeTag is later than the recorded one).
+	 * @param[in] boardIndex index of the board whose parameter was changed
+	 * @param[in] timeTag time tag (as in the EVENTS HDU) of the last event of the board read before the change
+	 * @param[in] parameter name of the parameter (same as the configuration file)
+	 * @param[in] value new value (e.g. "[500, 500, 500, 500]")
+	 */
+	void fillParameterChange(uint8_t boardIndex, uint64_t timeTag, const std::string& parameter,
+			const std::string& value) {
+		fitsAccessMutes.lock();
+		fits_movnam_hdu(outputFile, BINARY_TBL, (char*) "PARAMETERS", 0, &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+
+		rowIndex_Parameters++;
+		uint32_t unixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		long long timeTagValue = static_cast<long long>(timeTag);
+		long long eventRow = static_cast<long long>(rowIndex);
+		char* parameterString = const_cast<char*>(parameter.c_str());
+		char* valueString = const_cast<char*>(value.c_str());
+		fits_write_col(outputFile, TUINT, Column_Parameters_unixTime, rowIndex_Parameters, firstElement, 1, &unixTime,
+				&fitsStatus);
+		fits_write_col(outputFile, TLONGLONG, Column_Parameters_timeTag, rowIndex_Parameters, firstElement, 1,
+				&timeTagValue, &fitsStatus);
+		fits_write_col(outputFile, TLONGLONG, Column_Parameters_eventRow, rowIndex_Parameters, firstElement, 1,
+				&eventRow, &fitsStatus);
+		fits_write_col(outputFile, TBYTE, Column_Parameters_boardIndex, rowIndex_Parameters, firstElement, 1,
+				&boardIndex, &fitsStatus);
+		fits_write_col(outputFile, TSTRING, Column_Parameters_parameter, rowIndex_Parameters, firstElement, 1,
+				&parameterString, &fitsStatus);
+		fits_write_col(outputFile, TSTRING, Column_Parameters_value, rowIndex_Parameters, firstElement, 1, &valueString,
+				&fitsStatus);
 
-			//
-			expandIfNecessary();
+		//move back to EVENTS HDU
+		fits_movnam_hdu(outputFile, BINARY_TBL, (char*) "EVENTS", 0, &fitsStatus);
+		this->reportErrorThenQuitIfError(fitsStatus, __func__);
+		fitsAccessMutes.unlock();
+	}
+
+public:
+	/** Writes events to the EVENTS HDU.
+	 * Columns of EventBatch are written with one fits_write_col() call per
+	 * column and batch (rather than one call per event and column).
+	 */
+	void fillEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		const size_t n = events.size();
+		if (n == 0) {
+			return;
+		}
+		fitsAccessMutes.lock();
+		const size_t firstRow = rowIndex + 1;
+		rowIndex += n;
+		expandIfNecessary();
+
+		//board index and ch
+		boardIndexAndChannelBuffer.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			boardIndexAndChannelBuffer[i] = events.getBoardIndexAndChannel(i);
+		}
+		writeColumn(TBYTE, Column_boardIndexAndChannel, firstRow, n, boardIndexAndChannelBuffer.data());
+		//timeTag
+		writeColumn(TLONGLONG, Column_timeTag, firstRow, n, events.timeTag.data());
+		//triggerCount, phaMax, phaMaxTime, phaMin, phaFirst, phaLast, maxDerivative, baseline
+		writeColumn(TUSHORT, Column_triggerCount, firstRow, n, events.triggerCount.data());
+		writeColumn(TUSHORT, Column_phaMax, firstRow, n, events.phaMax.data());
+		writeColumn(TUSHORT, Column_phaMaxTime, firstRow, n, events.phaMaxTime.data());
+		writeColumn(TUSHORT, Column_phaMin, firstRow, n, events.phaMin.data());
+		writeColumn(TUSHORT, Column_phaFirst, firstRow, n, events.phaFirst.data());
+		writeColumn(TUSHORT, Column_phaLast, firstRow, n, events.phaLast.data());
+		writeColumn(TUSHORT, Column_maxDerivative, firstRow, n, events.maxDerivative.data());
+		writeColumn(TUSHORT, Column_baseline, firstRow, n, events.baseline.data());
+		if (nSamples != 0) {
+			//waveform (rows of the waveform matrix are zero-padded)
+			const size_t stride = events.getWaveformStride();
+			if (stride == nSamples) {
+				writeColumn(TUSHORT, Column_waveform, firstRow, n * nSamples, events.getWaveforms());
+			} else {
+				// e.g. across a burst transition
+				const size_t nCopied = (stride < nSamples) ? stride : nSamples;
+				waveformBuffer.assign(n * nSamples, 0);
+				for (size_t i = 0; i < n; i++) {
+					std::copy_n(events.getWaveform(i), nCopied, waveformBuffer.begin() + i * nSamples);
+				}
+				writeColumn(TUSHORT, Column_waveform, firstRow, waveformBuffer.size(), waveformBuffer.data());
+			}
+		}
+		//burstID
+		if (column_burstID != 0) {
+			writeColumn(TUINT, column_burstID, firstRow, n, events.burstID.data());
+		}
+		//pulse-shape features
+		if (column_pulseIntegral != 0) {
+			writeColumn(TINT, column_pulseIntegral, firstRow, n, events.pulseIntegral.data());
+			writeColumn(TUSHORT, column_riseTime, firstRow, n, events.riseTime.data());
+			writeColumn(TUSHORT, column_fallTime, firstRow, n, events.fallTime.data());
+			writeColumn(TFLOAT, column_tailTotalRatio, firstRow, n, events.tailTotalRatio.data());
+			writeColumn(TBYTE, column_pileUpFlags, firstRow, n, events.pileUpFlags.data());
+		}
+		//filteredPHA
+		if (column_filteredPHA != 0) {
+			writeColumn(TFLOAT, column_filteredPHA, firstRow, n, events.filteredPHA.data());
+		}
+		//baselineCorrectedPHA
+		if (column_baselineCorrectedPHA != 0) {
+			writeColumn(TFLOAT, column_baselineCorrectedPHA, firstRow, n, events.baselineCorrectedPHA.data());
+		}
+		//coincidence
+		if (column_coincidenceID != 0) {
+			writeColumn(TUINT, column_coincidenceID, firstRow, n, events.coincidenceID.data());
+			writeColumn(TBYTE, column_multiplicity, firstRow, n, events.multiplicity.data());
+			writeColumn(TBYTE, column_vetoFlag, firstRow, n, events.vetoFlag.data());
+		}
+		//absolute time (unwrappedTimeTag is written as signed 64 bit)
+		if (column_unwrappedTimeTag != 0) {
+			writeColumn(TLONGLONG, column_unwrappedTimeTag, firstRow, n, events.unwrappedTimeTag.data());
+			writeColumn(TDOUBLE, column_utcTime, firstRow, n, events.utcTime.data());
+			writeColumn(TBYTE, column_timeQualityFlags, firstRow, n, events.timeQualityFlags.data());
 		}
 		fitsAccessMutes.unlock();
 	}
 
+private:
+	/** Writes nElements values to a column from firstRow.
+	 */
+	void writeColumn(int dataType, int column, size_t firstRow, size_t nElements, void* values) {
+		fits_write_col(outputFile, dataType, column, firstRow, firstElement, nElements, values, &fitsStatus);
+	}
+
+private:
+	std::vector<uint8_t> boardIndexAndChannelBuffer;
+	std::vector<uint16_t> waveformBuffer; // waveform column of a batch (events x nSamples)
+
 private:
 	void expandIfNecessary() {
 		using namespace std;
@@ -351,7 +684,7 @@ private:
 			fitsNRows = nRowsGot;
 
 			rowExpansionStep = rowExpansionStep * 2;
-			cout << "Output FITS file was resized to " << dec << fitsNRows << " rows." << endl;
+			Logger::info() << "Output FITS file was resized to " << fitsNRows << " rows.";
 		}
 	}
 
@@ -369,27 +702,25 @@ public:
 			int fitsStatus = 0;
 
 			uint32_t nUnusedRow = fitsNRows - rowIndex;
-			cout << "Closing the current output file." << endl;
-			cout << " rowIndex    = " << dec << rowIndex << " (number of filled rows)" << endl;
-			cout << " fitsNRows   = " << dec << fitsNRows << " (allocated row number)" << endl;
-			cout << " unused rows = " << dec << nUnusedRow << endl;
+			Logger::info() << "Closing the current output file (" << rowIndex << " filled rows, " << fitsNRows
+					<< " allocated rows, " << nUnusedRow << " unused rows).";
 
 			/* Delete unfilled rows. */
 			fits_flush_file(outputFile, &fitsStatus);
 			this->reportErrorThenQuitIfError(fitsStatus, __func__);
 			if (fitsNRows != rowIndex) {
-				cout << "Deleting unused " << nUnusedRow << " rows." << endl;
+				Logger::debug() << "Deleting unused " << nUnusedRow << " rows.";
 				fits_delete_rows(outputFile, rowIndex + 1, nUnusedRow, &fitsStatus);
 				this->reportErrorThenQuitIfError(fitsStatus, __func__);
 			}
 
 			/* Recover unused heap. */
-			cout << "Recovering unused heap." << endl;
+			Logger::debug() << "Recovering unused heap.";
 			fits_compress_heap(outputFile, &fitsStatus);
 			this->reportErrorThenQuitIfError(fitsStatus, __func__);
 
 			/* Write date. */
-			cout << "Writing data to file." << endl;
+			Logger::debug() << "Writing data to file.";
 			fits_write_date(outputFile, &fitsStatus);
 			this->reportErrorThenQuitIfError(fitsStatus, __func__);
 
@@ -398,19 +729,19 @@ public:
 				fits_update_key(outputFile, TULONG, (char*) "NAXIS2", (void*) &rowIndex, (char*) "number of rows in table",
 						&fitsStatus);
 				this->reportErrorThenQuitIfError(fitsStatus, __func__);
-				cout << "This HDU has 0 row." << endl;
+				Logger::info() << "This HDU has 0 row.";
 			}
 
 			/* Update checksum. */
-			cout << "Updating ch ecksum." << endl;
+			Logger::debug() << "Updating checksum.";
 			fits_write_chksum(outputFile, &fitsStatus);
 			this->reportErrorThenQuitIfError(fitsStatus, __func__);
 
 			/* Close FITS File */
-			cout << "Closing file." << endl;
+			Logger::debug() << "Closing file.";
 			fits_close_file(outputFile, &fitsStatus);
 			this->reportErrorThenQuitIfError(fitsStatus, __func__);
-			cout << "Output FITS file closed." << endl;
+			Logger::info() << "Output FITS file closed.";
 
 			fitsAccessMutes.unlock();
 		}
@@ -20,19 +20,17 @@ class EventListFileROOT: public EventListFile {
 public:
 	EventListFileROOT(std::string fileName, std::string detectorID = "empty", std::string configurationYAMLFile = "") :
 			EventListFile(fileName), detectorID(detectorID), configurationYAMLFile(configurationYAMLFile) {
-		eventEntry.waveform = new uint16_t[SpaceFibreADC::MaxWaveformLength];
 		createOutputRootFile();
 	}
 
 	~EventListFileROOT() {
 		close();
-		delete eventEntry.waveform;
 	}
 
-	void fillEvents(std::vector<GROWTH_FY2015_ADC_Type::Event*>& events) {
+	void fillEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) {
 		unixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
-		for (auto& event : events) {
-			copyEventData(event, &eventEntry);
+		for (size_t i = 0; i < events.size(); i++) {
+			copyEventData(events, i, eventEntry);
 			eventTree->Fill();
 		}
 	}
@@ -42,6 +40,9 @@ public:
 	}
 
 	void fillGPSTime(uint8_t* gpsTimeRegisterBuffer) {}
+	void fillGPSFix(const NMEAParser::Fix& fix) {}
+	void fillParameterChange(uint8_t boardIndex, uint64_t timeTag, const std::string& parameter,
+			const std::string& value) {}
 
 	void close() {
 		if (outputFile != NULL) {
@@ -70,36 +71,95 @@ private:
 		// - l : a 64 bit unsigned integer (ULong64_t)
 		// - O : [the letter 'o', not a zero] a boolean (Bool_t)
 
-		eventTree->Branch("boardIndexAndChannel", &eventEntry.ch, "boardIndexAndChannel/b");
+		eventTree->Branch("boardIndexAndChannel", &eventEntry.boardIndexAndChannel, "boardIndexAndChannel/b");
 		eventTree->Branch("timeTag", &eventEntry.timeTag, "timeTag/l");
 		eventTree->Branch("unixTime", &unixTime, "unixTime/i");
 		eventTree->Branch("triggerCount", &eventEntry.triggerCount, "triggerCount/s");
 		eventTree->Branch("nSamples", &eventEntry.nSamples, "nSamples/s");
 		eventTree->Branch("phaMax", &eventEntry.phaMax, "phaMax/s");
-		eventTree->Branch("phaMaxTime", &eventEntry.phaMax, "phaMaxTime/s");
-		eventTree->Branch("phaMin", &eventEntry.phaMax, "phaMin/s");
-		eventTree->Branch("phaFirst", &eventEntry.phaMax, "phaFirst/s");
-		eventTree->Branch("phaLast", &eventEntry.phaMax, "phaLast/s");
-		eventTree->Branch("maxDerivative", &eventEntry.phaMax, "maxDerivative/s");
-		eventTree->Branch("baseline", &eventEntry.phaMax, "baseline/s");
+		eventTree->Branch("phaMaxTime", &eventEntry.phaMaxTime, "phaMaxTime/s");
+		eventTree->Branch("phaMin", &eventEntry.phaMin, "phaMin/s");
+		eventTree->Branch("phaFirst", &eventEntry.phaFirst, "phaFirst/s");
+		eventTree->Branch("phaLast", &eventEntry.phaLast, "phaLast/s");
+		eventTree->Branch("maxDerivative", &eventEntry.maxDerivative, "maxDerivative/s");
+		eventTree->Branch("baseline", &eventEntry.baseline, "baseline/s");
 		eventTree->Branch("waveform", eventEntry.waveform, "waveform[nSamples]/s");
+		eventTree->Branch("burstID", &eventEntry.burstID, "burstID/i");
+		eventTree->Branch("pulseIntegral", &eventEntry.pulseIntegral, "pulseIntegral/I");
+		eventTree->Branch("riseTime", &eventEntry.riseTime, "riseTime/s");
+		eventTree->Branch("fallTime", &eventEntry.fallTime, "fallTime/s");
+		eventTree->Branch("tailTotalRatio", &eventEntry.tailTotalRatio, "tailTotalRatio/F");
+		eventTree->Branch("pileUpFlags", &eventEntry.pileUpFlags, "pileUpFlags/b");
+		eventTree->Branch("filteredPHA", &eventEntry.filteredPHA, "filteredPHA/F");
+		eventTree->Branch("baselineCorrectedPHA", &eventEntry.baselineCorrectedPHA, "baselineCorrectedPHA/F");
+		eventTree->Branch("coincidenceID", &eventEntry.coincidenceID, "coincidenceID/i");
+		eventTree->Branch("multiplicity", &eventEntry.multiplicity, "multiplicity/b");
+		eventTree->Branch("vetoFlag", &eventEntry.vetoFlag, "vetoFlag/b");
+		eventTree->Branch("unwrappedTimeTag", &eventEntry.unwrappedTimeTag, "unwrappedTimeTag/l");
+		eventTree->Branch("utcTime", &eventEntry.utcTime, "utcTime/D");
+		eventTree->Branch("timeQualityFlags", &eventEntry.timeQualityFlags, "timeQualityFlags/b");
 
 		writeHeader();
 	}
 
-	void copyEventData(GROWTH_FY2015_ADC_Type::Event* from, GROWTH_FY2015_ADC_Type::Event* to) {
-		to->ch = from->ch;
-		to->timeTag = from->timeTag;
-		to->triggerCount = from->triggerCount;
-		to->phaMax = from->phaMax;
-		to->phaMaxTime = from->phaMaxTime;
-		to->phaMin = from->phaMin;
-		to->phaFirst = from->phaFirst;
-		to->phaLast = from->phaLast;
-		to->maxDerivative = from->maxDerivative;
-		to->baseline = from->baseline;
-		to->nSamples = from->nSamples;
-		memcpy(to->waveform, from->waveform, sizeof(uint16_t)*from->nSamples);
+	/** One event (a row of EventBatch) pointed by the branches of eventTree.
+	 */
+	struct Entry {
+		uint8_t boardIndexAndChannel;
+		uint64_t timeTag;
+		uint16_t triggerCount;
+		uint16_t phaMax;
+		uint16_t phaMaxTime;
+		uint16_t phaMin;
+		uint16_t phaFirst;
+		uint16_t phaLast;
+		uint16_t maxDerivative;
+		uint16_t baseline;
+		uint16_t nSamples;
+		uint16_t waveform[SpaceFibreADC::MaxWaveformLength];
+		uint32_t burstID;
+		int32_t pulseIntegral;
+		uint16_t riseTime;
+		uint16_t fallTime;
+		float tailTotalRatio;
+		uint8_t pileUpFlags;
+		float filteredPHA;
+		float baselineCorrectedPHA;
+		uint32_t coincidenceID;
+		uint8_t multiplicity;
+		uint8_t vetoFlag;
+		uint64_t unwrappedTimeTag;
+		double utcTime;
+		uint8_t timeQualityFlags;
+	};
+
+	void copyEventData(const GROWTH_FY2015_ADC_Type::EventBatch& from, size_t i, Entry& to) {
+		to.boardIndexAndChannel = from.getBoardIndexAndChannel(i);
+		to.timeTag = from.timeTag[i];
+		to.triggerCount = from.triggerCount[i];
+		to.phaMax = from.phaMax[i];
+		to.phaMaxTime = from.phaMaxTime[i];
+		to.phaMin = from.phaMin[i];
+		to.phaFirst = from.phaFirst[i];
+		to.phaLast = from.phaLast[i];
+		to.maxDerivative = from.maxDerivative[i];
+		to.baseline = from.baseline[i];
+		to.nSamples = from.nSamples[i];
+		memcpy(to.waveform, from.getWaveform(i), sizeof(uint16_t) * from.nSamples[i]);
+		to.burstID = from.burstID[i];
+		to.pulseIntegral = from.pulseIntegral[i];
+		to.riseTime = from.riseTime[i];
+		to.fallTime = from.fallTime[i];
+		to.tailTotalRatio = from.tailTotalRatio[i];
+		to.pileUpFlags = from.pileUpFlags[i];
+		to.filteredPHA = from.filteredPHA[i];
+		to.baselineCorrectedPHA = from.baselineCorrectedPHA[i];
+		to.coincidenceID = from.coincidenceID[i];
+		to.multiplicity = from.multiplicity[i];
+		to.vetoFlag = from.vetoFlag[i];
+		to.unwrappedTimeTag = from.unwrappedTimeTag[i];
+		to.utcTime = from.utcTime[i];
+		to.timeQualityFlags = from.timeQualityFlags[i];
 	}
 
 	void writeHeader(){
@@ -117,7 +177,7 @@ private:
 	TFile* outputFile = nullptr;
 	std::string detectorID;
 	uint32_t unixTime;
-	GROWTH_FY2015_ADC_Type::Event eventEntry;
+	Entry eventEntry;
 	std::string configurationYAMLFile;
 };
 
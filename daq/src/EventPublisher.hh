@@ -0,0 +1,198 @@
+#ifndef SRC_EVENTPUBLISHER_HH_
+#define SRC_EVENTPUBLISHER_HH_
+
+#include <cstring>
+#include <sstream>
+#include <zmq.hpp>
+#include "picojson.h"
+#include "GROWTH_FY2015_ADC.hh"
+
+/** Publishes decoded events and per-second summaries via a ZeroMQ PUB socket
+ * so that quick-look displays and alert systems can subscribe to live data.
+ *
+ * Each message consists of two frames: a topic ("events" or "summary") and a
+ * payload. Subscribers select topics with ZMQ_SUBSCRIBE.
+ * <ul>
+ *   <li> "events": a binary batch (little endian) made of BatchHeader
+ *        followed by nEvents EventRecord's. </li>
+ *   <li> "summary": a JSON object published once per second, e.g.
+ *        {"unixTime": 1500000000, "nEvents": 120, "nPublishedEvents": 12,
+ *         "counts": [30, 30, 30, 30]} (counts are indexed by channel = boardIndex * 4 + ch,
+ *        and include events which were not published). </li>
+ * </ul>
+ * Events can be thinned out per channel (prescale) and restricted to selected
+ * channels. Messages are dropped instead of blocking acquisition when
+ * subscribers are slow (send high-water mark).
+ */
+class EventPublisher {
+public:
+	static const uint32_t FormatVersion = 1;
+
+public:
+	/** Header of an "events" payload.
+	 */
+	struct BatchHeader {
+		uint32_t formatVersion;
+		uint32_t nEvents;
+		uint32_t unixTime; // time of publication
+		uint32_t reserved;
+	} __attribute__((packed));
+
+public:
+	/** Event record of an "events" payload.
+	 */
+	struct EventRecord {
+		uint64_t timeTag; // 40-bit FPGA time tag
+		uint8_t boardIndexAndChannel; // upper 4 bits = board index, lower 4 bits = channel
+		uint8_t flags; // bit 0 = vetoed (see CoincidenceBuilder)
+		uint16_t triggerCount;
+		uint16_t phaMax;
+		uint16_t phaMin;
+		uint16_t baseline;
+		uint16_t maxDerivative;
+	} __attribute__((packed));
+
+public:
+	/** @param[in] portNumber TCP port number of the PUB socket
+	 * @param[in] prescale only one of every prescale events is published per channel (1 = all events)
+	 * @param[in] channels channels to be published (counted over all boards; empty = all channels)
+	 * @param[in] nChannels number of channels counted over all boards
+	 */
+	EventPublisher(uint16_t portNumber, size_t prescale, const std::vector<size_t>& channels, size_t nChannels) :
+			context(1), socket(context, ZMQ_PUB), prescale(prescale > 0 ? prescale : 1), //
+			channelEnabled(nChannels, channels.size() == 0), prescaleCounters(nChannels, 0), counts(nChannels, 0) {
+		for (auto ch : channels) {
+			if (ch < nChannels) {
+				channelEnabled[ch] = true;
+			}
+		}
+		int highWaterMark = SendHighWaterMark;
+		socket.setsockopt(ZMQ_SNDHWM, &highWaterMark, sizeof(highWaterMark));
+		int linger = 0;
+		socket.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+		std::stringstream ss;
+		ss << "tcp://*:" << portNumber;
+		socket.bind(ss.str().c_str());
+		unixTimeOfLastSummary = CxxUtilities::Time::getUNIXTimeAsUInt32();
+	}
+
+public:
+	/** Publishes selected events as one batch, and counts all events for the summary.
+	 * @param[in] events decoded events
+	 */
+	void publish(const GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		records.clear();
+		for (size_t i = 0; i < events.size(); i++) {
+			const size_t ch = events.getGlobalChannelIndex(i);
+			if (ch >= channelEnabled.size()) {
+				continue;
+			}
+			counts[ch]++;
+			nEventsInSummary++;
+			if (!channelEnabled[ch]) {
+				continue;
+			}
+			prescaleCounters[ch]++;
+			if (prescaleCounters[ch] < prescale) {
+				continue;
+			}
+			prescaleCounters[ch] = 0;
+			EventRecord record;
+			record.timeTag = events.timeTag[i];
+			record.boardIndexAndChannel = events.getBoardIndexAndChannel(i);
+			record.flags = events.vetoFlag[i] != 0 ? 0x01 : 0x00;
+			record.triggerCount = events.triggerCount[i];
+			record.phaMax = events.phaMax[i];
+			record.phaMin = events.phaMin[i];
+			record.baseline = events.baseline[i];
+			record.maxDerivative = events.maxDerivative[i];
+			records.push_back(record);
+		}
+		if (records.size() == 0) {
+			return;
+		}
+		const BatchHeader header { FormatVersion, static_cast<uint32_t>(records.size()),
+				CxxUtilities::Time::getUNIXTimeAsUInt32(), 0 };
+		payload.resize(sizeof(BatchHeader) + sizeof(EventRecord) * records.size());
+		memcpy(&payload[0], &header, sizeof(BatchHeader));
+		memcpy(&payload[sizeof(BatchHeader)], records.data(), sizeof(EventRecord) * records.size());
+		if (send("events", payload.data(), payload.size())) {
+			nPublishedEventsInSummary += records.size();
+		}
+	}
+
+public:
+	/** Publishes a summary if one second has passed since the last summary.
+	 */
+	void publishSummaryIfNecessary() {
+		const uint32_t unixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		if (unixTime == unixTimeOfLastSummary) {
+			return;
+		}
+		picojson::array countsArray;
+		for (auto& count : counts) {
+			countsArray.push_back(picojson::value(static_cast<double>(count)));
+			count = 0;
+		}
+		picojson::object summary;
+		summary["unixTime"] = picojson::value(static_cast<double>(unixTime));
+		summary["durationInSec"] = picojson::value(static_cast<double>(unixTime - unixTimeOfLastSummary));
+		summary["nEvents"] = picojson::value(static_cast<double>(nEventsInSummary));
+		summary["nPublishedEvents"] = picojson::value(static_cast<double>(nPublishedEventsInSummary));
+		summary["counts"] = picojson::value(countsArray);
+		const std::string summaryString = picojson::value(summary).serialize();
+		send("summary", summaryString.c_str(), summaryString.size());
+		nEventsInSummary = 0;
+		nPublishedEventsInSummary = 0;
+		unixTimeOfLastSummary = unixTime;
+	}
+
+public:
+	/** Returns the number of messages dropped because subscribers were too slow.
+	 */
+	size_t getNDroppedMessages() const {
+		return nDroppedMessages;
+	}
+
+private:
+	/** Sends a message made of a topic frame and a payload frame without blocking.
+	 * socket_t::send() returns the number of bytes queued, or 0 when the frame
+	 * would block (EAGAIN). If the topic frame is not queued, the payload frame
+	 * is not sent so that no partial message is left on the socket. Once the
+	 * first frame is queued, the socket accepts the rest of the message.
+	 * @return false if the message was dropped
+	 */
+	bool send(const std::string& topic, const void* data, size_t size) {
+		try {
+			if (socket.send(topic.c_str(), topic.size(), ZMQ_SNDMORE | ZMQ_DONTWAIT) != topic.size()) {
+				nDroppedMessages++;
+				return false;
+			}
+			if (socket.send(data, size, ZMQ_DONTWAIT) != size) {
+				nDroppedMessages++;
+				return false;
+			}
+		} catch (zmq::error_t& e) {
+			nDroppedMessages++;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	static const int SendHighWaterMark = 100; // messages
+	zmq::context_t context;
+	zmq::socket_t socket;
+	size_t prescale;
+	std::vector<bool> channelEnabled;
+	std::vector<size_t> prescaleCounters;
+	std::vector<size_t> counts;
+	size_t nEventsInSummary = 0;
+	size_t nPublishedEventsInSummary = 0;
+	uint32_t unixTimeOfLastSummary;
+	std::vector<EventRecord> records;
+	std::vector<uint8_t> payload;
+	size_t nDroppedMessages = 0;
+};
+
+#endif /* SRC_EVENTPUBLISHER_HH_ */
@@ -117,29 +117,27 @@
 
  //---------------------------------------------
  // Read event data
- std::vector<GROWTH_FY2015_ADC_Type::Event*> events;
+ GROWTH_FY2015_ADC_Type::EventBatch events;
 
  cout << "Reading events" << endl;
- events=adc->getEvent();
+ adc->getEvents(events);
  cout << "nEvents = " << events.size() << endl;
 
- size_t i=0;
- for(auto event : events){
+ for(size_t i=0;i<events.size();i++){
  cout << dec;
  cout << "=============================================" << endl;
  cout << "Event " << i << endl;
  cout << "---------------------------------------------" << endl;
- cout << "timeTag = " << event->timeTag << endl;
- cout << "triggerCount = " << event->triggerCount << endl;
- cout << "phaMax = " << (uint32_t)event->phaMax << endl;
- cout << "nSamples = " << (uint32_t)event->nSamples << endl;
+ cout << "timeTag = " << events.timeTag[i] << endl;
+ cout << "triggerCount = " << events.triggerCount[i] << endl;
+ cout << "phaMax = " << (uint32_t)events.phaMax[i] << endl;
+ cout << "nSamples = " << (uint32_t)events.nSamples[i] << endl;
  cout << "waveform = ";
- for(size_t i=0;i<event->nSamples;i++){
- cout << dec << (uint32_t)event->waveform[i] << " ";
+ const uint16_t* waveform=events.getWaveform(i);
+ for(size_t o=0;o<events.nSamples[i];o++){
+ cout << dec << (uint32_t)waveform[o] << " ";
  }
  cout << endl;
- i++;
- adc->freeEvent(event);
  }
 
  //---------------------------------------------
@@ -181,6 +179,8 @@
 #include "GROWTH_FY2015_ADCModules/ChannelModule.hh"
 #include "GROWTH_FY2015_ADCModules/ChannelManager.hh"
 #include "yaml-cpp/yaml.h"
+#include "Logger.hh"
+#include <chrono>
 
 using GROWTH_FY2015_ADC_Type::TriggerMode;
 
@@ -211,11 +211,9 @@ public:
 	class GROWTH_FY2015_ADCDumpThread: public CxxUtilities::StoppableThread {
 	private:
 		GROWTH_FY2015_ADC* parent;
-		EventDecoder* eventDecoder;
 	public:
 		GROWTH_FY2015_ADCDumpThread(GROWTH_FY2015_ADC* parent) {
 			this->parent = parent;
-			this->eventDecoder = parent->getEventDecoder();
 		}
 
 	public:
@@ -233,10 +231,8 @@ public:
 				nReceivedEvents_latch = parent->nReceivedEvents;
 				delta = nReceivedEvents_latch - nReceivedEvents_previous;
 				nReceivedEvents_previous = nReceivedEvents_latch;
-				cout << "GROWTH_FY2015_ADC received " << dec << parent->nReceivedEvents << " events (delta=" << dec
-						<< delta << ")." << endl;
-				cout << "GROWTH_FY2015_ADC_Type::EventDecoder available Event instances = " << dec
-						<< this->eventDecoder->getNAllocatedEventInstances() << endl;
+				Logger::info() << "GROWTH_FY2015_ADC received " << parent->nReceivedEvents << " events (delta="
+						<< delta << ")";
 			}
 		}
 	};
@@ -256,7 +252,7 @@ public:
 	static const uint16_t PHAMaximum = 1023;
 
 private:
-	RMAPHandler* rmapHandler;
+	RMAPHandlerUART* rmapHandler;
 	RMAPTargetNode* adcRMAPTargetNode;
 	RMAPInitiator* rmapIniaitorForGPSRegisterAccess;
 	ChannelManager* channelManager;
@@ -271,13 +267,12 @@ public:
 public:
 	/** Constructor.
 	 * @param deviceName UART-USB device name (e.g. /dev/tty.usb-aaa-bbb)
+	 * @param baudRate UART baud rate (should match that of the FPGA firmware)
 	 */
-	GROWTH_FY2015_ADC(std::string deviceName) {
+	GROWTH_FY2015_ADC(std::string deviceName, size_t baudRate = SpaceWireIFOverUART::BAUD_RATE) {
 		using namespace std;
 
-		cout << "#---------------------------------------------" << endl;
-		cout << "# GROWTH_FY2015_ADC Constructor" << endl;
-		cout << "#---------------------------------------------" << endl;
+		Logger::info() << "Opening ADC board on " << deviceName << " (" << baudRate << " baud).";
 		//construct RMAPTargetNode instance
 		adcRMAPTargetNode = new RMAPTargetNode;
 		adcRMAPTargetNode->setID("ADCBox");
@@ -287,13 +282,13 @@ public:
 		adcRMAPTargetNode->setTargetLogicalAddress(0xFE);
 		adcRMAPTargetNode->setInitiatorLogicalAddress(0xFE);
 
-		this->rmapHandler = new RMAPHandlerUART(deviceName, { adcRMAPTargetNode });
+		this->rmapHandler = new RMAPHandlerUART(deviceName, { adcRMAPTargetNode }, baudRate);
 		bool connected = this->rmapHandler->connectoToSpaceWireToGigabitEther();
 		if (!connected) {
-			cerr << "SpaceWire interface could not be opened." << endl;
+			Logger::error() << "SpaceWire interface could not be opened.";
 			::exit(-1);
 		} else {
-			cout << "Connected to SpaceWire interface." << endl;
+			Logger::info() << "Connected to SpaceWire interface.";
 		}
 
 		//
@@ -310,21 +305,24 @@ public:
 			this->channelModules[i] = new ChannelModule(rmapHandler, adcRMAPTargetNode, i);
 		}
 
-		//event decoder
-		this->eventDecoder = new EventDecoder();
+		//event decoder (packet format depends on the FPGA image)
+		const uint32_t fpgaVersion = this->getFPGAVersion();
+		this->eventDecoder = EventDecoder::create(fpgaVersion);
+		Logger::info() << "FPGA version " << std::hex << fpgaVersion << ", event packet format "
+				<< this->eventDecoder->getFormatVersion() << ".";
 
 		//dump thread
 		/*
 		 this->dumpThread = new GROWTH_FY2015_ADCDumpThread(this);
 		 this->dumpThread->start();
 		 */
-		cout << "Constructor completes." << endl;
+		Logger::debug() << "Constructor completes.";
 	}
 
 public:
 	~GROWTH_FY2015_ADC() {
 		using namespace std;
-		cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deconstructing GROWTH_FY2015_ADC instance." << endl;
+		Logger::debug() << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deconstructing GROWTH_FY2015_ADC instance.";
 		/*
 		 cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Stopping dump thread." << endl;
 		 if (this->dumpThread != NULL && this->dumpThread->isInRunMethod()) {
@@ -332,11 +330,11 @@ public:
 		 delete this->dumpThread;
 		 }*/
 
-		cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting RMAP Handler." << endl;
+		Logger::debug() << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting RMAP Handler.";
 		delete rmapIniaitorForGPSRegisterAccess;
 		delete rmapHandler;
 
-		cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting internal modules." << endl;
+		Logger::debug() << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting internal modules.";
 		delete this->channelManager;
 		delete this->consumerManager;
 		for (size_t i = 0; i < SpaceFibreADC::NumberOfChannels; i++) {
@@ -344,14 +342,19 @@ public:
 		}
 		delete eventDecoder;
 
-		cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting GPS Data FIFO read buffer." << endl;
+		Logger::debug() << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Deleting GPS Data FIFO read buffer.";
 		if (gpsDataFIFOReadBuffer != NULL) {
 			delete gpsDataFIFOReadBuffer;
 		}
 
-		cout << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Completed." << endl;
+		Logger::debug() << "GROWTH_FY2015_ADC::~GROWTH_FY2015_ADC(): Completed.";
 	}
 
+private:
+	uint16_t samplesInEventPacketInUse = 0;
+	uint64_t nSSDTPResyncsOfPreviousLinks = 0;
+	uint64_t nSSDTPDiscardedBytesOfPreviousLinks = 0;
+
 private:
 	uint8_t gpsTimeRegister[LengthOfGPSTimeRegister + 1];
 	const size_t GPSDataFIFODepthInBytes = 1024;
@@ -395,6 +398,105 @@ public:
 		return gpsTimeRegister;
 	}
 
+public:
+	/** Result of measureLinkThroughput().
+	 */
+	struct LinkThroughput {
+		size_t baudRate;
+		size_t nTransactions;
+		double elapsedTimeInSec;
+		double transactionsPerSec;
+		double meanLatencyInMillisec;
+		double payloadBytesPerSec; // RMAP read data only
+		double wireBytesPerSec; // all bytes received over UART (SSDTP and RMAP headers included)
+	};
+
+public:
+	/** Measures effective RMAP throughput over the UART link by repeatedly
+	 * reading the GPS Time Register (no side effect on acquisition).
+	 * @param[in] nTransactions number of RMAP read transactions
+	 */
+	LinkThroughput measureLinkThroughput(size_t nTransactions) {
+		LinkThroughput result { };
+		SpaceWireIFOverUART* spwif = this->rmapHandler->getSpaceWireIF();
+		result.baudRate = spwif->getBaudRate();
+		result.nTransactions = nTransactions;
+		if (nTransactions == 0) {
+			return result;
+		}
+		const uint64_t nReceivedBytesAtStart = spwif->getSerialPort()->getNReceivedBytes();
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < nTransactions; i++) {
+			this->rmapHandler->read(adcRMAPTargetNode, AddressOfGPSTimeRegister, LengthOfGPSTimeRegister,
+					gpsTimeRegister);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		const uint64_t nReceivedBytes = spwif->getSerialPort()->getNReceivedBytes() - nReceivedBytesAtStart;
+		result.elapsedTimeInSec = std::chrono::duration<double>(end - start).count();
+		if (result.elapsedTimeInSec > 0) {
+			result.transactionsPerSec = nTransactions / result.elapsedTimeInSec;
+			result.meanLatencyInMillisec = result.elapsedTimeInSec / nTransactions * 1000;
+			result.payloadBytesPerSec = nTransactions * LengthOfGPSTimeRegister / result.elapsedTimeInSec;
+			result.wireBytesPerSec = nReceivedBytes / result.elapsedTimeInSec;
+		}
+		return result;
+	}
+
+public:
+	/** Returns the number of times the SSDTP deframer lost synchronization
+	 * (i.e. corrupted or dropped bytes on the UART link).
+	 */
+	uint64_t getNSSDTPResyncs() {
+		SpaceWireSSDTPModuleUART* ssdtp = getSSDTPModule();
+		return nSSDTPResyncsOfPreviousLinks + ((ssdtp != NULL) ? ssdtp->getNResyncs() : 0);
+	}
+
+public:
+	/** Returns the number of bytes discarded by the SSDTP deframer during resynchronization.
+	 */
+	uint64_t getNSSDTPDiscardedBytes() {
+		SpaceWireSSDTPModuleUART* ssdtp = getSSDTPModule();
+		return nSSDTPDiscardedBytesOfPreviousLinks + ((ssdtp != NULL) ? ssdtp->getNDiscardedBytes() : 0);
+	}
+
+public:
+	/** Re-establishes the UART link after a failure, and restores the board state.
+	 * The serial port is reopened, the RMAPEngine is restarted, the register
+	 * configuration last written to the board (loadConfigurationFile() and
+	 * setNumberOfSamplesInEventPacket()) is written again, and acquisition is
+	 * restarted. The EventFIFO is not reset so that readout resumes from where
+	 * it was interrupted.
+	 * @return true if the link and the board state were recovered
+	 */
+	bool recoverLink() {
+		using namespace std;
+		const uint16_t samplesInEventPacket = this->samplesInEventPacketInUse;
+		nSSDTPResyncsOfPreviousLinks = getNSSDTPResyncs();
+		nSSDTPDiscardedBytesOfPreviousLinks = getNSSDTPDiscardedBytes();
+		delete rmapIniaitorForGPSRegisterAccess;
+		rmapIniaitorForGPSRegisterAccess = NULL;
+		if (!this->rmapHandler->reconnect()) {
+			Logger::error() << "GROWTH_FY2015_ADC::recoverLink(): SpaceWire interface could not be reopened.";
+			return false;
+		}
+		rmapIniaitorForGPSRegisterAccess = new RMAPInitiator(this->rmapHandler->getRMAPEngine());
+		try {
+			this->stopAcquisition();
+			this->programDigitizer(samplesInEventPacket);
+			this->startAcquisition();
+		} catch (...) {
+			Logger::error() << "GROWTH_FY2015_ADC::recoverLink(): register configuration could not be restored.";
+			return false;
+		}
+		return true;
+	}
+
+private:
+	SpaceWireSSDTPModuleUART* getSSDTPModule() {
+		SpaceWireIFOverUART* spwif = this->rmapHandler->getSpaceWireIF();
+		return (spwif != NULL) ? spwif->getSSDTPModule() : NULL;
+	}
+
 public:
 	/** Clears the GPS Data FIFO.
 	 *  After clear, new data coming from GPS Receiver will be written to GPS Data FIFO.
@@ -429,7 +531,7 @@ public:
 	ChannelModule* getChannelRegister(int chNumber) {
 		using namespace std;
 		if (Debug::adcbox()) {
-			cout << "GROWTH_FY2015_ADC::getChannelRegister(" << chNumber << ")" << endl;
+			Logger::debug() << "GROWTH_FY2015_ADC::getChannelRegister(" << chNumber << ")";
 		}
 		return channelModules[chNumber];
 	}
@@ -441,7 +543,7 @@ public:
 	ChannelManager* getChannelManager() {
 		using namespace std;
 		if (Debug::adcbox()) {
-			cout << "GROWTH_FY2015_ADC::getChannelManager()" << endl;
+			Logger::debug() << "GROWTH_FY2015_ADC::getChannelManager()";
 		}
 		return channelManager;
 	}
@@ -453,7 +555,7 @@ public:
 	ConsumerManagerEventFIFO* getConsumerManager() {
 		using namespace std;
 		if (Debug::adcbox()) {
-			cout << "GROWTH_FY2015_ADC::getConsumerManager()" << endl;
+			Logger::debug() << "GROWTH_FY2015_ADC::getConsumerManager()";
 		}
 		return consumerManager;
 	}
@@ -464,13 +566,10 @@ public:
 	 */
 	void reset() {
 		using namespace std;
-		if (Debug::adcbox()) {
-			cout << "GROWTH_FY2015_ADC::reset()";
-		}
 		this->channelManager->reset();
 		this->consumerManager->reset();
 		if (Debug::adcbox()) {
-			cout << "done" << endl;
+			Logger::debug() << "GROWTH_FY2015_ADC::reset() done";
 		}
 	}
 
@@ -492,16 +591,16 @@ public:
 	void closeDevice() {
 		using namespace std;
 		try {
-			cout << "#stopping event data output" << endl;
+			Logger::debug() << "Stopping event data output";
 			consumerManager->disableEventDataOutput();
 			//cout << "#stopping dump thread" << endl;
 			//consumerManager->stopDumpThread();
 			//if (this->dumpThread != NULL) {
 			//	this->dumpThread->stop();
 			//}
-			cout << "#closing sockets" << endl;
+			Logger::debug() << "Closing sockets";
 			consumerManager->closeSocket();
-			cout << "#disconnecting SpaceWire-to-GigabitEther" << endl;
+			Logger::debug() << "Disconnecting SpaceWire-to-GigabitEther";
 			rmapHandler->disconnectSpWGbE();
 		} catch (...) {
 			throw SpaceFibreADCException::CloseDeviceFailed;
@@ -510,45 +609,27 @@ public:
 
 //=============================================
 private:
-	std::vector<GROWTH_FY2015_ADC_Type::Event*> events;
+	// getEvents() and setNumberOfSamplesInEventPacket() may be called from different threads (see BoardReader)
+	CxxUtilities::Mutex eventDecoderMutex;
 
 public:
-	/** Reads, decodes, and returns event data recorded by the board.
+	/** Reads and decodes event data recorded by the board, and appends them to the specified batch.
 	 * When no event packet is received within a timeout duration,
-	 * this method will return empty vector meaning a time out.
-	 * Each GROWTH_FY2015_ADC_Type::Event instances pointed by the entities
-	 * of the returned vector should be freed after use in the user
-	 * application. A freed GROWTH_FY2015_ADC_Type::Event instance will be
-	 * reused to represent another event data.
-	 * @return a vector containing pointers to decoded event data
-	 */
-	std::vector<GROWTH_FY2015_ADC_Type::Event*> getEvent() {
-		events.clear();
+	 * this method returns 0 meaning a time out.
+	 * @param[out] events decoded events are appended
+	 * @return the number of appended events
+	 */
+	size_t getEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		size_t nEvents = 0;
 		std::vector<uint8_t> data = consumerManager->getEventData();
 		if (data.size() != 0) {
+			eventDecoderMutex.lock();
 			eventDecoder->decodeEvent(&data);
-			events = eventDecoder->getDecodedEvents();
-		}
-		nReceivedEvents += events.size();
-		return events;
-	}
-
-public:
-	/** Frees an event instance so that buffer area can be reused in the following commands.
-	 * @param[in] event event instance to be freed
-	 */
-	void freeEvent(GROWTH_FY2015_ADC_Type::Event* event) {
-		eventDecoder->freeEvent(event);
-	}
-
-public:
-	/** Frees event instances so that buffer area can be reused in the following commands.
-	 * @param[in] events a vector of event instance to be freed
-	 */
-	void freeEvents(std::vector<GROWTH_FY2015_ADC_Type::Event*>& events) {
-		for (auto event : events) {
-			eventDecoder->freeEvent(event);
+			nEvents = eventDecoder->popDecodedEvents(events);
+			eventDecoderMutex.unlock();
 		}
+		nReceivedEvents += nEvents;
+		return nEvents;
 	}
 
 //=============================================
@@ -569,7 +650,7 @@ public:
 			channelModules[chNumber]->setTriggerMode(triggerMode);
 		} else {
 			using namespace std;
-			cerr << "Error in setTriggerMode(): invalid channel number " << chNumber << endl;
+			Logger::error() << "setTriggerMode(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -603,6 +684,10 @@ public:
 	 */
 	void setNumberOfSamplesInEventPacket(uint16_t nSamples) {
 		consumerManager->setEventPacket_NumberOfWaveform(nSamples);
+		samplesInEventPacketInUse = nSamples;
+		eventDecoderMutex.lock();
+		eventDecoder->setNSamplesInEventPacket(nSamples);
+		eventDecoderMutex.unlock();
 	}
 
 public:
@@ -614,7 +699,7 @@ public:
 			channelModules[chNumber]->setStartingThreshold(threshold);
 		} else {
 			using namespace std;
-			cerr << "Error in setStartingThreshold(): invalid channel number " << chNumber << endl;
+			Logger::error() << "setStartingThreshold(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -628,7 +713,7 @@ public:
 			channelModules[chNumber]->setClosingThreshold(threshold);
 		} else {
 			using namespace std;
-			cerr << "Error in setClosingThreshold(): invalid channel number " << chNumber << endl;
+			Logger::error() << "setClosingThreshold(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -642,7 +727,7 @@ public:
 			channelModules[chNumber]->setTriggerBusMask(enabledChannels);
 		} else {
 			using namespace std;
-			cerr << "Error in setTriggerBusMask(): invalid channel number " << chNumber << endl;
+			Logger::error() << "setTriggerBusMask(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -658,7 +743,7 @@ public:
 			channelModules[chNumber]->setDepthOfDelay(depthOfDelay);
 		} else {
 			using namespace std;
-			cerr << "Error in setDepthOfDelay(): invalid channel number " << chNumber << endl;
+			Logger::error() << "setDepthOfDelay(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -672,7 +757,7 @@ public:
 			return channelModules[chNumber]->getLivetime();
 		} else {
 			using namespace std;
-			cerr << "Error in getLivetime(): invalid channel number " << chNumber << endl;
+			Logger::error() << "getLivetime(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -686,7 +771,7 @@ public:
 			return channelModules[chNumber]->getCurrentADCValue();
 		} else {
 			using namespace std;
-			cerr << "Error in getCurrentADCValue(): invalid channel number " << chNumber << endl;
+			Logger::error() << "getCurrentADCValue(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -699,7 +784,7 @@ public:
 			channelModules[chNumber]->turnADCPower(true);
 		} else {
 			using namespace std;
-			cerr << "Error in turnOnADCPower(): invalid channel number " << chNumber << endl;
+			Logger::error() << "turnOnADCPower(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -712,7 +797,7 @@ public:
 			channelModules[chNumber]->turnADCPower(false);
 		} else {
 			using namespace std;
-			cerr << "Error in turnOffADCPower(): invalid channel number " << chNumber << endl;
+			Logger::error() << "turnOffADCPower(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -766,6 +851,25 @@ public:
 		channelManager->stopAcquisition();
 	}
 
+public:
+	/** Pauses data acquisition while keeping the link and the configuration.
+	 * Channels are stopped and event data output to the EventFIFO is disabled.
+	 * Events already in the EventFIFO can still be read.
+	 */
+	void pauseAcquisition() {
+		channelManager->stopAcquisition();
+		consumerManager->disableEventDataOutput();
+	}
+
+public:
+	/** Resumes data acquisition paused by pauseAcquisition().
+	 * Unlike startAcquisition(std::vector<bool>), the EventFIFO is not reset.
+	 */
+	void resumeAcquisition() {
+		consumerManager->enableEventDataOutput();
+		channelManager->startAcquisition(this->ChannelEnable);
+	}
+
 public:
 	/** Sends CPU Trigger to force triggering in the specified channel.
 	 * @param[in] chNumber channel to be CPU-triggered
@@ -775,7 +879,7 @@ public:
 			channelModules[chNumber]->sendCPUTrigger();
 		} else {
 			using namespace std;
-			cerr << "Error in sendCPUTrigger(): invalid channel number " << chNumber << endl;
+			Logger::error() << "sendCPUTrigger(): invalid channel number " << chNumber;
 			throw SpaceFibreADCException::InvalidChannelNumber;
 		}
 	}
@@ -788,7 +892,7 @@ public:
 		using namespace std;
 		for (size_t chNumber = 0; chNumber < SpaceFibreADC::NumberOfChannels; chNumber++) {
 			if (this->ChannelEnable[chNumber] == true) { //if enabled
-				cout << "CPU Trigger to Channel " << chNumber << endl;
+				Logger::info() << "CPU Trigger to Channel " << chNumber;
 				channelModules[chNumber]->sendCPUTrigger();
 			}
 		}
@@ -884,9 +988,55 @@ public:
 	std::vector<bool> ChannelEnable;
 	std::vector<uint16_t> TriggerThresholds;
 	std::vector<uint16_t> TriggerCloseThresholds;
+	// optional parameters
+	double LightCurveBinWidthInSec = 1.0;
+	double LightCurveLengthInSec = 3600.0;
+	std::vector<uint32_t> LightCurveEnergyBandBoundaries { 0, 65536 };
+	bool BurstTriggerEnabled = false;
+	double BurstTriggerShortWindowInSec = 1.0;
+	double BurstTriggerLongWindowInSec = 60.0;
+	double BurstTriggerThresholdInSigma = 5.0;
+	double BurstTriggerHoldTimeInSec = 10.0;
+	size_t BurstSamplesInEventPacket = 0; // 0 = SamplesInEventPacket is not changed during a burst
+	bool PulseShapeAnalysisEnabled = false;
+	size_t PulseShapeTailStartOffset = 10;
+	bool SaveWaveform = true; // false = only features are saved (waveform column is omitted)
+	bool TrapezoidalFilterEnabled = false;
+	size_t TrapezoidalFilterRiseTime = 16;
+	size_t TrapezoidalFilterFlatTop = 8;
+	double TrapezoidalFilterDecayTimeConstant = 0; // in samples; 0 = no pole-zero correction
+	size_t UARTBaudRate = SpaceWireIFOverUART::BAUD_RATE; // used when the board is constructed
+	size_t UARTLinkSelfTestTransactions = 100; // 0 = link self-test is skipped
+	bool BaselineTrackingEnabled = false;
+	double BaselineTrackingTimeConstantInEvents = 1000;
+	size_t BaselineTemperatureSensorChannel = 0; // ADCDAC temperature sensor (0-3) used for the drift fit
+	double TimeOrderedMergeLatencyInSec = 1.0; // 0 = events are written in the EventFIFO order
+	bool CoincidenceEnabled = false;
+	double CoincidenceWindowInSec = 1e-6;
+	std::vector<size_t> VetoChannels; // channel indices counted over all boards (boardIndex * 4 + ch)
+	bool DropVetoedEvents = false;
+	bool TimeReconstructionEnabled = false;
+	double ClockJumpThresholdInSec = 0.01;
+	size_t GPSNMEASamplingIntervalInSec = 0; // 0 = GPS Data FIFO is not sampled
+	size_t EventPublisherPort = 0; // 0 = events are not published via ZeroMQ
+	size_t EventPublisherPrescale = 1; // one of every N events is published per channel
+	std::vector<size_t> EventPublisherChannels; // channel indices counted over all boards; empty = all channels
+	std::string LogLevel = "info"; // debug, info, warning, or error
+
+public:
+	/** Returns true if event packets carry at most one waveform sample
+	 * (PHA-only observation). Packets then have a fixed length, and the
+	 * waveform column is omitted from event list files.
+	 */
+	bool isHeaderOnlyMode() const {
+		return this->SamplesInEventPacket <= 1;
+	}
 
 public:
 	size_t getNSamplesInEventListFile() {
+		if (!this->SaveWaveform || isHeaderOnlyMode()) {
+			return 0;
+		}
 		return (this->SamplesInEventPacket) / this->DownSamplingFactorForSavedWaveform;
 	}
 
@@ -908,6 +1058,21 @@ public:
 				<< "TriggerCloseThresholds: [800, 800, 800, 800]" << endl;
 	}
 
+public:
+	/** Returns the UART baud rate specified in a configuration file
+	 * (UARTBaudRate, optional). Since the baud rate is needed to
+	 * construct an instance, this method reads only this keyword.
+	 * @param[in] inputFileName YAML configuration file
+	 * @return baud rate (default value if not specified)
+	 */
+	static size_t loadUARTBaudRate(std::string inputFileName) {
+		YAML::Node yaml_root = YAML::LoadFile(inputFileName);
+		if (yaml_root["UARTBaudRate"].IsDefined()) {
+			return yaml_root["UARTBaudRate"].as<size_t>();
+		}
+		return SpaceWireIFOverUART::BAUD_RATE;
+	}
+
 private:
 	template<typename T, typename Y>
 	std::map<T, Y> parseYAMLMap(YAML::Node node) {
@@ -931,7 +1096,8 @@ public:
 		//---------------------------------------------
 		for (auto keyword : mustExistKeywords) {
 			if (!yaml_root[keyword].IsDefined()) {
-				cerr << "Error: " << keyword << " is not defined in the configuration file." << endl;
+				Logger::error() << keyword << " is not defined in the configuration file.";
+				Logger::flush();
 				dumpMustExistKeywords();
 				exit(-1);
 			}
@@ -956,64 +1122,271 @@ public:
 		this->TriggerThresholds = yaml_root["TriggerThresholds"].as<std::vector<uint16_t>>();
 		this->TriggerCloseThresholds = yaml_root["TriggerCloseThresholds"].as<std::vector<uint16_t>>();
 
+		//---------------------------------------------
+		//load optional parameter values
+		//---------------------------------------------
+		if (yaml_root["LightCurveBinWidthInSec"].IsDefined()) {
+			this->LightCurveBinWidthInSec = yaml_root["LightCurveBinWidthInSec"].as<double>();
+		}
+		if (yaml_root["LightCurveLengthInSec"].IsDefined()) {
+			this->LightCurveLengthInSec = yaml_root["LightCurveLengthInSec"].as<double>();
+		}
+		if (yaml_root["LightCurveEnergyBandBoundaries"].IsDefined()) {
+			this->LightCurveEnergyBandBoundaries = yaml_root["LightCurveEnergyBandBoundaries"].as<std::vector<uint32_t>>();
+		}
+		if (yaml_root["BurstTriggerEnabled"].IsDefined()) {
+			this->BurstTriggerEnabled = yaml_root["BurstTriggerEnabled"].as<bool>();
+		}
+		if (yaml_root["BurstTriggerShortWindowInSec"].IsDefined()) {
+			this->BurstTriggerShortWindowInSec = yaml_root["BurstTriggerShortWindowInSec"].as<double>();
+		}
+		if (yaml_root["BurstTriggerLongWindowInSec"].IsDefined()) {
+			this->BurstTriggerLongWindowInSec = yaml_root["BurstTriggerLongWindowInSec"].as<double>();
+		}
+		if (yaml_root["BurstTriggerThresholdInSigma"].IsDefined()) {
+			this->BurstTriggerThresholdInSigma = yaml_root["BurstTriggerThresholdInSigma"].as<double>();
+		}
+		if (yaml_root["BurstTriggerHoldTimeInSec"].IsDefined()) {
+			this->BurstTriggerHoldTimeInSec = yaml_root["BurstTriggerHoldTimeInSec"].as<double>();
+		}
+		if (yaml_root["BurstSamplesInEventPacket"].IsDefined()) {
+			this->BurstSamplesInEventPacket = yaml_root["BurstSamplesInEventPacket"].as<size_t>();
+			// cannot exceed the number of samples recorded per trigger
+			this->BurstSamplesInEventPacket = std::min(this->BurstSamplesInEventPacket,
+					this->PreTriggerSamples + this->PostTriggerSamples);
+		}
+		if (yaml_root["PulseShapeAnalysisEnabled"].IsDefined()) {
+			this->PulseShapeAnalysisEnabled = yaml_root["PulseShapeAnalysisEnabled"].as<bool>();
+		}
+		if (yaml_root["PulseShapeTailStartOffset"].IsDefined()) {
+			this->PulseShapeTailStartOffset = yaml_root["PulseShapeTailStartOffset"].as<size_t>();
+		}
+		if (yaml_root["SaveWaveform"].IsDefined()) {
+			this->SaveWaveform = yaml_root["SaveWaveform"].as<bool>();
+		}
+		if (yaml_root["TrapezoidalFilterEnabled"].IsDefined()) {
+			this->TrapezoidalFilterEnabled = yaml_root["TrapezoidalFilterEnabled"].as<bool>();
+		}
+		if (yaml_root["TrapezoidalFilterRiseTime"].IsDefined()) {
+			this->TrapezoidalFilterRiseTime = yaml_root["TrapezoidalFilterRiseTime"].as<size_t>();
+		}
+		if (yaml_root["TrapezoidalFilterFlatTop"].IsDefined()) {
+			this->TrapezoidalFilterFlatTop = yaml_root["TrapezoidalFilterFlatTop"].as<size_t>();
+		}
+		if (yaml_root["TrapezoidalFilterDecayTimeConstant"].IsDefined()) {
+			this->TrapezoidalFilterDecayTimeConstant = yaml_root["TrapezoidalFilterDecayTimeConstant"].as<double>();
+		}
+		if (yaml_root["UARTBaudRate"].IsDefined()) {
+			this->UARTBaudRate = yaml_root["UARTBaudRate"].as<size_t>();
+		}
+		if (yaml_root["UARTLinkSelfTestTransactions"].IsDefined()) {
+			this->UARTLinkSelfTestTransactions = yaml_root["UARTLinkSelfTestTransactions"].as<size_t>();
+		}
+		if (yaml_root["BaselineTrackingEnabled"].IsDefined()) {
+			this->BaselineTrackingEnabled = yaml_root["BaselineTrackingEnabled"].as<bool>();
+		}
+		if (yaml_root["BaselineTrackingTimeConstantInEvents"].IsDefined()) {
+			this->BaselineTrackingTimeConstantInEvents = yaml_root["BaselineTrackingTimeConstantInEvents"].as<double>();
+		}
+		if (yaml_root["BaselineTemperatureSensorChannel"].IsDefined()) {
+			this->BaselineTemperatureSensorChannel = yaml_root["BaselineTemperatureSensorChannel"].as<size_t>();
+			if (this->BaselineTemperatureSensorChannel > 3) {
+				Logger::error() << "BaselineTemperatureSensorChannel should be 0-3 (specified "
+						<< this->BaselineTemperatureSensorChannel << ").";
+				exit(-1);
+			}
+		}
+		if (yaml_root["TimeOrderedMergeLatencyInSec"].IsDefined()) {
+			this->TimeOrderedMergeLatencyInSec = yaml_root["TimeOrderedMergeLatencyInSec"].as<double>();
+		}
+		if (yaml_root["CoincidenceEnabled"].IsDefined()) {
+			this->CoincidenceEnabled = yaml_root["CoincidenceEnabled"].as<bool>();
+		}
+		if (yaml_root["CoincidenceWindowInSec"].IsDefined()) {
+			this->CoincidenceWindowInSec = yaml_root["CoincidenceWindowInSec"].as<double>();
+		}
+		if (yaml_root["VetoChannels"].IsDefined()) {
+			this->VetoChannels = yaml_root["VetoChannels"].as<std::vector<size_t>>();
+		}
+		if (yaml_root["DropVetoedEvents"].IsDefined()) {
+			this->DropVetoedEvents = yaml_root["DropVetoedEvents"].as<bool>();
+		}
+		if (yaml_root["TimeReconstructionEnabled"].IsDefined()) {
+			this->TimeReconstructionEnabled = yaml_root["TimeReconstructionEnabled"].as<bool>();
+		}
+		if (yaml_root["ClockJumpThresholdInSec"].IsDefined()) {
+			this->ClockJumpThresholdInSec = yaml_root["ClockJumpThresholdInSec"].as<double>();
+		}
+		if (yaml_root["GPSNMEASamplingIntervalInSec"].IsDefined()) {
+			this->GPSNMEASamplingIntervalInSec = yaml_root["GPSNMEASamplingIntervalInSec"].as<size_t>();
+		}
+		if (yaml_root["EventPublisherPort"].IsDefined()) {
+			this->EventPublisherPort = yaml_root["EventPublisherPort"].as<size_t>();
+		}
+		if (yaml_root["EventPublisherPrescale"].IsDefined()) {
+			this->EventPublisherPrescale = yaml_root["EventPublisherPrescale"].as<size_t>();
+		}
+		if (yaml_root["EventPublisherChannels"].IsDefined()) {
+			this->EventPublisherChannels = yaml_root["EventPublisherChannels"].as<std::vector<size_t>>();
+		}
+		if (yaml_root["LogLevel"].IsDefined()) {
+			Logger::Level level;
+			if (Logger::parseLevel(yaml_root["LogLevel"].as<std::string>(), level)) {
+				this->LogLevel = yaml_root["LogLevel"].as<std::string>();
+				Logger::setLevel(level);
+			} else {
+				Logger::warning() << "Invalid LogLevel " << yaml_root["LogLevel"].as<std::string>() << " (ignored).";
+			}
+		}
+
 		//---------------------------------------------
 		//dump setting
 		//---------------------------------------------
-		cout << "#---------------------------------------------" << endl;
-		cout << "# Configuration" << endl;
-		cout << "#---------------------------------------------" << endl;
-		cout << "DetectorID                        : " << this->DetectorID << endl;
-		cout << "PreTriggerSamples                 : " << this->PreTriggerSamples << endl;
-		cout << "PostTriggerSamples                : " << this->PostTriggerSamples << endl;
+		Logger::info() << "Configuration (" << inputFileName << ")";
+		Logger::info() << "DetectorID                        : " << this->DetectorID;
+		Logger::info() << "PreTriggerSamples                 : " << this->PreTriggerSamples;
+		Logger::info() << "PostTriggerSamples                : " << this->PostTriggerSamples;
 		{
-			cout << "TriggerModes                      : [";
 			std::vector<size_t> triggerModeInt { };
 			for (const auto mode : this->TriggerModes) {
 				triggerModeInt.push_back(static_cast<size_t>(mode));
 			}
-			cout << CxxUtilities::String::join(triggerModeInt, ", ") << "]" << endl;
-		}
-		cout << "SamplesInEventPacket              : " << this->SamplesInEventPacket << endl;
-		cout << "DownSamplingFactorForSavedWaveform: " << this->DownSamplingFactorForSavedWaveform << endl;
-		cout << "ChannelEnable                     : [" << CxxUtilities::String::join(this->ChannelEnable, ", ") << "]"
-				<< endl;
-		cout << "TriggerThresholds                 : [" << CxxUtilities::String::join(this->TriggerThresholds, ", ")
-				<< "]" << endl;
-		cout << "TriggerCloseThresholds            : ["
-				<< CxxUtilities::String::join(this->TriggerCloseThresholds, ", ") << "]" << endl;
-		cout << endl;
+			Logger::info() << "TriggerModes                      : [" << CxxUtilities::String::join(triggerModeInt, ", ")
+					<< "]";
+		}
+		Logger::info() << "SamplesInEventPacket              : " << this->SamplesInEventPacket
+				<< (isHeaderOnlyMode() ? " (header-only packets; no waveform column)" : "");
+		Logger::info() << "DownSamplingFactorForSavedWaveform: " << this->DownSamplingFactorForSavedWaveform;
+		Logger::info() << "ChannelEnable                     : [" << CxxUtilities::String::join(this->ChannelEnable, ", ")
+				<< "]";
+		Logger::info() << "TriggerThresholds                 : [" << CxxUtilities::String::join(this->TriggerThresholds, ", ")
+				<< "]";
+		Logger::info() << "TriggerCloseThresholds            : ["
+				<< CxxUtilities::String::join(this->TriggerCloseThresholds, ", ") << "]";
+		Logger::info() << "LightCurveBinWidthInSec           : " << this->LightCurveBinWidthInSec;
+		Logger::info() << "LightCurveLengthInSec             : " << this->LightCurveLengthInSec;
+		Logger::info() << "LightCurveEnergyBandBoundaries    : ["
+				<< CxxUtilities::String::join(this->LightCurveEnergyBandBoundaries, ", ") << "]";
+		Logger::info() << "BurstTriggerEnabled               : " << (this->BurstTriggerEnabled ? "true" : "false");
+		if (this->BurstTriggerEnabled) {
+			Logger::info() << "BurstTriggerShortWindowInSec      : " << this->BurstTriggerShortWindowInSec;
+			Logger::info() << "BurstTriggerLongWindowInSec       : " << this->BurstTriggerLongWindowInSec;
+			Logger::info() << "BurstTriggerThresholdInSigma      : " << this->BurstTriggerThresholdInSigma;
+			Logger::info() << "BurstTriggerHoldTimeInSec         : " << this->BurstTriggerHoldTimeInSec;
+			Logger::info() << "BurstSamplesInEventPacket         : " << this->BurstSamplesInEventPacket;
+		}
+		Logger::info() << "PulseShapeAnalysisEnabled         : " << (this->PulseShapeAnalysisEnabled ? "true" : "false");
+		if (this->PulseShapeAnalysisEnabled) {
+			Logger::info() << "PulseShapeTailStartOffset         : " << this->PulseShapeTailStartOffset;
+		}
+		Logger::info() << "SaveWaveform                      : " << (this->SaveWaveform ? "true" : "false");
+		Logger::info() << "TrapezoidalFilterEnabled          : " << (this->TrapezoidalFilterEnabled ? "true" : "false");
+		if (this->TrapezoidalFilterEnabled) {
+			Logger::info() << "TrapezoidalFilterRiseTime         : " << this->TrapezoidalFilterRiseTime;
+			Logger::info() << "TrapezoidalFilterFlatTop          : " << this->TrapezoidalFilterFlatTop;
+			Logger::info() << "TrapezoidalFilterDecayTimeConstant: " << this->TrapezoidalFilterDecayTimeConstant;
+		}
+		Logger::info() << "UARTBaudRate                      : " << this->UARTBaudRate;
+		Logger::info() << "UARTLinkSelfTestTransactions      : " << this->UARTLinkSelfTestTransactions;
+		Logger::info() << "BaselineTrackingEnabled           : " << (this->BaselineTrackingEnabled ? "true" : "false");
+		if (this->BaselineTrackingEnabled) {
+			Logger::info() << "BaselineTrackingTimeConstant      : " << this->BaselineTrackingTimeConstantInEvents << " events";
+			Logger::info() << "BaselineTemperatureSensorChannel  : " << this->BaselineTemperatureSensorChannel;
+		}
+		Logger::info() << "TimeOrderedMergeLatencyInSec      : " << this->TimeOrderedMergeLatencyInSec;
+		Logger::info() << "CoincidenceEnabled                : " << (this->CoincidenceEnabled ? "true" : "false");
+		if (this->CoincidenceEnabled) {
+			Logger::info() << "CoincidenceWindowInSec            : " << this->CoincidenceWindowInSec;
+			Logger::info() << "VetoChannels                      : [" << CxxUtilities::String::join(this->VetoChannels, ", ")
+					<< "]";
+			Logger::info() << "DropVetoedEvents                  : " << (this->DropVetoedEvents ? "true" : "false");
+		}
+		Logger::info() << "TimeReconstructionEnabled         : " << (this->TimeReconstructionEnabled ? "true" : "false");
+		if (this->TimeReconstructionEnabled) {
+			Logger::info() << "ClockJumpThresholdInSec           : " << this->ClockJumpThresholdInSec;
+		}
+		Logger::info() << "GPSNMEASamplingIntervalInSec      : " << this->GPSNMEASamplingIntervalInSec;
+		Logger::info() << "EventPublisherPort                : " << this->EventPublisherPort;
+		if (this->EventPublisherPort != 0) {
+			Logger::info() << "EventPublisherPrescale            : " << this->EventPublisherPrescale;
+			Logger::info() << "EventPublisherChannels            : ["
+					<< CxxUtilities::String::join(this->EventPublisherChannels, ", ") << "]";
+		}
+		Logger::info() << "LogLevel                          : " << this->LogLevel;
 
-		cout << "//---------------------------------------------" << endl;
-		cout << "// Programing the digitizer" << endl;
-		cout << "//---------------------------------------------" << endl;
+		Logger::info() << "Programming the digitizer";
 		try {
-			//record length
-			this->setNumberOfSamples(PreTriggerSamples + PostTriggerSamples);
-			this->setNumberOfSamplesInEventPacket(SamplesInEventPacket);
-			for (size_t ch = 0; ch < nChannels; ch++) {
+			this->programDigitizer(SamplesInEventPacket);
+			Logger::info() << "Device configuration done.";
+		} catch (...) {
+			Logger::error() << "Device configuration failed.";
+			::exit(-1);
+		}
+	}
 
-				//pre-trigger (delay)
-				this->setDepthOfDelay(ch, PreTriggerSamples);
+public:
+	/** Subset of the configuration which can be changed during acquisition.
+	 * An empty vector means that the parameter is not changed.
+	 */
+	struct HotParameters {
+		std::vector<uint16_t> triggerThresholds;
+		std::vector<uint16_t> triggerCloseThresholds;
+	};
 
-				//trigger mode
-				const auto triggerMode = this->TriggerModes.at(ch);
-				this->setTriggerMode(ch, triggerMode);
+public:
+	/** Writes changed thresholds to the channel registers without stopping acquisition.
+	 * Only channels whose value differs from the current configuration are
+	 * written. The configuration is updated so that the new values are also
+	 * used when the board is reprogrammed (e.g. after link recovery).
+	 * @param[in] parameters new values (each vector should be empty or have nChannels entries)
+	 * @return the number of registers written
+	 */
+	size_t applyHotParameters(const HotParameters& parameters) {
+		size_t nWrites = 0;
+		for (size_t ch = 0; ch < nChannels; ch++) {
+			if (ch < parameters.triggerThresholds.size() && parameters.triggerThresholds[ch] != TriggerThresholds[ch]) {
+				this->setStartingThreshold(ch, parameters.triggerThresholds[ch]);
+				TriggerThresholds[ch] = parameters.triggerThresholds[ch];
+				nWrites++;
+			}
+			if (ch < parameters.triggerCloseThresholds.size()
+					&& parameters.triggerCloseThresholds[ch] != TriggerCloseThresholds[ch]) {
+				this->setClosingThreshold(ch, parameters.triggerCloseThresholds[ch]);
+				TriggerCloseThresholds[ch] = parameters.triggerCloseThresholds[ch];
+				nWrites++;
+			}
+		}
+		return nWrites;
+	}
 
-				//threshold
-				this->setStartingThreshold(ch, TriggerThresholds[ch]);
-				this->setClosingThreshold(ch, TriggerCloseThresholds[ch]);
+private:
+	/** Writes the loaded configuration to the registers of the board.
+	 * This is also used to restore the board state after link recovery.
+	 * @param[in] samplesInEventPacket number of ADC samples in the event packet
+	 */
+	void programDigitizer(uint16_t samplesInEventPacket) {
+		//record length
+		this->setNumberOfSamples(PreTriggerSamples + PostTriggerSamples);
+		this->setNumberOfSamplesInEventPacket(samplesInEventPacket);
+		for (size_t ch = 0; ch < nChannels; ch++) {
 
-				//adc clock 50MHz
-				this->setAdcClock(SpaceFibreADC::ADCClockFrequency::ADCClock50MHz);
+			//pre-trigger (delay)
+			this->setDepthOfDelay(ch, PreTriggerSamples);
 
-				//turn on ADC
-				this->turnOnADCPower(ch);
+			//trigger mode
+			const auto triggerMode = this->TriggerModes.at(ch);
+			this->setTriggerMode(ch, triggerMode);
+
+			//threshold
+			this->setStartingThreshold(ch, TriggerThresholds[ch]);
+			this->setClosingThreshold(ch, TriggerCloseThresholds[ch]);
+
+			//adc clock 50MHz
+			this->setAdcClock(SpaceFibreADC::ADCClockFrequency::ADCClock50MHz);
+
+			//turn on ADC
+			this->turnOnADCPower(ch);
 
-			}
-			cout << "Device configurtion done." << endl;
-		} catch (...) {
-			cerr << "Device configuration failed." << endl;
-			::exit(-1);
 		}
 	}
 };
@@ -108,7 +108,8 @@ class ConsumerManagerEventFIFO {
 
  private:
   std::vector<uint8_t> receiveBuffer;
-  static const size_t ReceiveBufferSize = 3000;
+  static const size_t ReceiveBufferSize         = 3000;
+  static const size_t MaxNFailuresOfOddByteRead = 3;
 
  public:
   /** Retrieve data stored in the EventFIFO.
@@ -150,11 +151,14 @@ class ConsumerManagerEventFIFO {
       if (receivedSize % 2 == 1) {
         cout << "ConsumerManagerEventFIFO::getEventData(): odd bytes. wait for another byte." << endl;
         size_t receivedSizeOneByte = 0;
+        size_t nFailures           = 0;
         while (receivedSizeOneByte == 0) {
           try {
             receivedSizeOneByte = this->readEventFIFO(&(receiveBuffer[receivedSize]), 1);
           } catch (...) {
             cerr << "ConsumerManagerEventFIFO::getEventData(): receive 1 byte timeout. continues." << endl;
+            // let the caller handle link failure
+            if (++nFailures == MaxNFailuresOfOddByteRead) { throw; }
           }
         }
         // increment by 1 to make receivedSize even
@@ -8,43 +8,78 @@
 #ifndef DEBUG_HH_
 #define DEBUG_HH_
 
+#include <cstdint>
+
+/** Bit mask of blocks whose debug traces are compiled in (see Debug).
+ * Set by the growth_daq_traced target; 0 (no trace) otherwise.
+ */
+#ifndef GROWTH_DAQ_TRACE
+#define GROWTH_DAQ_TRACE 0
+#endif
+
 /** An internal class which represents Debug configuration.
- *
+ * Debug mode of each block is fixed at compile time by GROWTH_DAQ_TRACE
+ * (e.g. -DGROWTH_DAQ_TRACE=0x80 traces EventDecoder only). All functions
+ * are constexpr, so that traces guarded by them are removed from normal
+ * builds.
  */
 class Debug {
  public:
+  static constexpr uint32_t SemaphoreBlock       = 0x001;
+  static constexpr uint32_t ChannelModuleBlock   = 0x002;
+  static constexpr uint32_t ConsumerManagerBlock = 0x004;
+  static constexpr uint32_t RingBufferBlock      = 0x008;
+  static constexpr uint32_t ChannelManagerBlock  = 0x010;
+  static constexpr uint32_t ADCBoxBlock          = 0x020;
+  static constexpr uint32_t DataRecorderBlock    = 0x040;
+  static constexpr uint32_t EventDecoderBlock    = 0x080;
+  static constexpr uint32_t MessageServerBlock   = 0x100;
+
+ public:
+  /** Returns if a block is in debug mode.
+   * @param block one of the *Block constants
+   */
+  static constexpr bool enabled(uint32_t block) { return (static_cast<uint32_t>(GROWTH_DAQ_TRACE) & block) != 0; }
   /** Returns if semaphore block is in debug mode.
    * @return true if semaphore block is in debug mode.
    */
-  static bool semaphore() { return false; }
+  static constexpr bool semaphore() { return enabled(SemaphoreBlock); }
   /** Returns if channelmodule block is in debug mode.
    * @return true if channelmodule block is in debug mode.
    */
-  static bool channelmodule() { return false; }
+  static constexpr bool channelmodule() { return enabled(ChannelModuleBlock); }
   /** Returns if consumermanager block is in debug mode.
    * @return true if consumermanager block is in debug mode.
    */
-  static bool consumermanager() { return false; }
+  static constexpr bool consumermanager() { return enabled(ConsumerManagerBlock); }
   /** Returns if ring buffer block is in debug mode.
    * @return true if ring buffer block is in debug mode.
    */
-  static bool ringbuffer() { return false; }
+  static constexpr bool ringbuffer() { return enabled(RingBufferBlock); }
   /** Returns if channelmanager block is in debug mode.
    * @return true if channelmanager block is in debug mode.
    */
-  static bool channelmanager() { return false; }
+  static constexpr bool channelmanager() { return enabled(ChannelManagerBlock); }
   /** Returns if SpaceWire ADC Box is in debug mode.
    * @return true if adc box is in debug mode.
    */
-  static bool adcbox() { return false; }
+  static constexpr bool adcbox() { return enabled(ADCBoxBlock); }
   /** Returns if DataRecorder is in debug mode.
    * @return true if DataRecorder is in debug mode.
    */
-  static bool datarecorder() { return false; }
+  static constexpr bool datarecorder() { return enabled(DataRecorderBlock); }
   /** Returns if EventDecoder is in debug mode.
-   * @return true if DataRecorder is in debug mode.
+   * @return true if EventDecoder is in debug mode.
+   */
+  static constexpr bool eventdecoder() { return enabled(EventDecoderBlock); }
+  /** Returns if MessageServer is in debug mode (received messages are dumped).
+   * @return true if MessageServer is in debug mode.
+   */
+  static constexpr bool messageserver() { return enabled(MessageServerBlock); }
+  /** Returns if any block is in debug mode (i.e. this is a traced build).
+   * @return true if any block is in debug mode.
    */
-  static bool eventdecoder() { return false; }
+  static constexpr bool any() { return static_cast<uint32_t>(GROWTH_DAQ_TRACE) != 0; }
 };
 
 #endif /* DEBUG_HH_ */
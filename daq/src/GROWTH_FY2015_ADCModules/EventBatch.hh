@@ -0,0 +1,295 @@
+/*
+ * EventBatch.hh
+ */
+
+#ifndef EVENTBATCH_HH_
+#define EVENTBATCH_HH_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "GROWTH_FY2015_ADCModules/Constants.hh"
+
+namespace GROWTH_FY2015_ADC_Type {
+
+/** Events stored as a struct of arrays.
+ * Each field is a contiguous column indexed by event (e.g. phaMax[i] is the
+ * pulse height of the i-th event), and waveforms are stored in one matrix of
+ * size() rows x getWaveformStride() samples (rows are zero-padded after
+ * nSamples[i]). A batch is produced by EventDecoder, and passed through
+ * MainThread to filters, writers, and histograms, which work column-wise.
+ *
+ * Instances are reused; clear() keeps the allocated memory.
+ */
+class EventBatch {
+ public:
+  // set by EventDecoder
+  std::vector<uint8_t> boardIndex;  // index of the ADC board in a multi-board setup (0 for single board)
+  std::vector<uint8_t> ch;
+  std::vector<uint64_t> timeTag;
+  std::vector<uint16_t> triggerCount;
+  std::vector<uint16_t> phaMax;
+  std::vector<uint16_t> phaMaxTime;
+  std::vector<uint16_t> phaMin;
+  std::vector<uint16_t> phaFirst;
+  std::vector<uint16_t> phaLast;
+  std::vector<uint16_t> maxDerivative;
+  std::vector<uint16_t> baseline;
+  std::vector<uint16_t> nSamples;
+  // set by BurstDetector (0 = not in a burst)
+  std::vector<uint32_t> burstID;
+  // pulse-shape features set by PulseShapeAnalyzer
+  std::vector<int32_t> pulseIntegral;
+  std::vector<uint16_t> riseTime;
+  std::vector<uint16_t> fallTime;
+  std::vector<float> tailTotalRatio;
+  std::vector<uint8_t> pileUpFlags;
+  // filtered pulse height set by TrapezoidalFilter (ADC unit, baseline subtracted)
+  std::vector<float> filteredPHA;
+  // phaMax minus baseline tracked by BaselineEstimator
+  std::vector<float> baselineCorrectedPHA;
+  // grouping set by CoincidenceBuilder
+  std::vector<uint32_t> coincidenceID;  // 0 = not in a coincidence
+  std::vector<uint8_t> multiplicity;    // number of channels hit within the coincidence window
+  std::vector<uint8_t> vetoFlag;        // 1 = a veto channel was hit within the coincidence window
+  // absolute time set by TimeReconstructor
+  std::vector<uint64_t> unwrappedTimeTag;  // timeTag extended to 64 bit (does not wrap around)
+  std::vector<double> utcTime;             // UNIX time in sec (0 = not available)
+  std::vector<uint8_t> timeQualityFlags;   // see TimeReconstructor::TimeQuality
+
+ public:
+  size_t size() const { return timeTag.size(); }
+
+ public:
+  bool empty() const { return timeTag.empty(); }
+
+ public:
+  /** Removes all events. Allocated memory is kept for reuse.
+   */
+  void clear() {
+    Clear f;
+    forEachColumn(*this, f);
+    waveforms.clear();
+    waveformStride = 0;
+  }
+
+ public:
+  void reserve(size_t nEvents) {
+    Reserve f{nEvents};
+    forEachColumn(*this, f);
+  }
+
+ public:
+  /** Exchanges contents (and allocated memory) with another batch.
+   */
+  void swap(EventBatch& other) { std::swap(*this, other); }
+
+ public:
+  /** Appends an event whose fields are 0 (multiplicity = 1) and which has no waveform.
+   * @return index of the appended event
+   */
+  size_t appendEvent() {
+    const size_t i = size();
+    Resize f{i + 1};
+    forEachColumn(*this, f);
+    multiplicity[i] = 1;
+    waveforms.resize(waveforms.size() + waveformStride, 0);
+    return i;
+  }
+
+ public:
+  /** Appends all events of another batch.
+   */
+  void append(const EventBatch& other) { append(other, 0, other.size()); }
+
+ public:
+  /** Appends events [first, last) of another batch.
+   */
+  void append(const EventBatch& other, size_t first, size_t last) {
+    if (first >= last) { return; }
+    const size_t offset = size();
+    reserveWaveformStride(other.waveformStride);
+    AppendRange f{first, last};
+    forEachColumn(other, f);
+    waveforms.resize(size() * waveformStride, 0);
+    for (size_t i = first; i < last; i++) { copyWaveform(other, i, offset + i - first); }
+  }
+
+ public:
+  /** Appends events of another batch in the order of indices.
+   */
+  void append(const EventBatch& other, const std::vector<size_t>& indices) {
+    if (indices.empty()) { return; }
+    const size_t offset = size();
+    reserveWaveformStride(other.waveformStride);
+    AppendIndices f{indices};
+    forEachColumn(other, f);
+    waveforms.resize(size() * waveformStride, 0);
+    for (size_t k = 0; k < indices.size(); k++) { copyWaveform(other, indices[k], offset + k); }
+  }
+
+ public:
+  /** Keeps only the events at indices (in increasing order), and removes the others.
+   */
+  void keep(const std::vector<size_t>& indices) {
+    Keep f{indices};
+    forEachColumn(*this, f);
+    for (size_t k = 0; k < indices.size(); k++) {
+      if (indices[k] != k) {
+        std::copy_n(waveforms.begin() + indices[k] * waveformStride, waveformStride,
+                    waveforms.begin() + k * waveformStride);
+      }
+    }
+    waveforms.resize(indices.size() * waveformStride);
+  }
+
+ public:
+  /** Sets the waveform of an event (and nSamples[i]).
+   * The matrix is widened when the waveform is longer than the current stride.
+   */
+  void setWaveform(size_t i, const uint16_t* samples, size_t n) {
+    reserveWaveformStride(n);
+    uint16_t* row = getWaveform(i);
+    std::copy(samples, samples + n, row);
+    std::fill(row + n, row + waveformStride, 0);
+    nSamples[i] = static_cast<uint16_t>(n);
+  }
+
+ public:
+  /** Returns the number of samples per row of the waveform matrix (maximum of nSamples in this batch).
+   */
+  size_t getWaveformStride() const { return waveformStride; }
+
+ public:
+  /** Returns the waveform of the i-th event (nSamples[i] valid samples).
+   */
+  uint16_t* getWaveform(size_t i) { return waveforms.data() + i * waveformStride; }
+
+ public:
+  const uint16_t* getWaveform(size_t i) const { return waveforms.data() + i * waveformStride; }
+
+ public:
+  /** Returns the waveform matrix (size() x getWaveformStride(), row-major).
+   */
+  uint16_t* getWaveforms() { return waveforms.data(); }
+
+ public:
+  /** Returns the value of the boardIndexAndChannel column of event list files
+   * (upper 4 bits = board index, lower 4 bits = channel).
+   */
+  uint8_t getBoardIndexAndChannel(size_t i) const {
+    return static_cast<uint8_t>((boardIndex[i] << 4) | (ch[i] & 0x0F));
+  }
+
+ public:
+  /** Returns the channel index counted over all boards (boardIndex * NumberOfChannels + ch). */
+  size_t getGlobalChannelIndex(size_t i) const {
+    return boardIndex[i] * SpaceFibreADC::NumberOfChannels + ch[i];
+  }
+
+ private:
+  /** Widens the rows of the waveform matrix to at least stride samples.
+   */
+  void reserveWaveformStride(size_t stride) {
+    if (stride <= waveformStride) { return; }
+    std::vector<uint16_t> widened(size() * stride, 0);
+    for (size_t i = 0; i < size() && waveformStride != 0; i++) {
+      std::copy_n(waveforms.begin() + i * waveformStride, waveformStride, widened.begin() + i * stride);
+    }
+    waveforms.swap(widened);
+    waveformStride = stride;
+  }
+
+ private:
+  void copyWaveform(const EventBatch& from, size_t i, size_t to) {
+    std::copy_n(from.getWaveform(i), from.waveformStride, getWaveform(to));
+  }
+
+ private:
+  /** Calls f(column of this, same column of other) for all columns except waveforms.
+   */
+  template <typename Function>
+  void forEachColumn(const EventBatch& other, Function& f) {
+    f(boardIndex, other.boardIndex);
+    f(ch, other.ch);
+    f(timeTag, other.timeTag);
+    f(triggerCount, other.triggerCount);
+    f(phaMax, other.phaMax);
+    f(phaMaxTime, other.phaMaxTime);
+    f(phaMin, other.phaMin);
+    f(phaFirst, other.phaFirst);
+    f(phaLast, other.phaLast);
+    f(maxDerivative, other.maxDerivative);
+    f(baseline, other.baseline);
+    f(nSamples, other.nSamples);
+    f(burstID, other.burstID);
+    f(pulseIntegral, other.pulseIntegral);
+    f(riseTime, other.riseTime);
+    f(fallTime, other.fallTime);
+    f(tailTotalRatio, other.tailTotalRatio);
+    f(pileUpFlags, other.pileUpFlags);
+    f(filteredPHA, other.filteredPHA);
+    f(baselineCorrectedPHA, other.baselineCorrectedPHA);
+    f(coincidenceID, other.coincidenceID);
+    f(multiplicity, other.multiplicity);
+    f(vetoFlag, other.vetoFlag);
+    f(unwrappedTimeTag, other.unwrappedTimeTag);
+    f(utcTime, other.utcTime);
+    f(timeQualityFlags, other.timeQualityFlags);
+  }
+
+ private:
+  // column operations used with forEachColumn()
+  struct Clear {
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>&) {
+      column.clear();
+    }
+  };
+  struct Reserve {
+    size_t n;
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>&) {
+      column.reserve(n);
+    }
+  };
+  struct Resize {
+    size_t n;
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>&) {
+      column.resize(n, 0);
+    }
+  };
+  struct AppendRange {
+    size_t first;
+    size_t last;
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>& other) {
+      column.insert(column.end(), other.begin() + first, other.begin() + last);
+    }
+  };
+  struct AppendIndices {
+    const std::vector<size_t>& indices;
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>& other) {
+      for (auto i : indices) { column.push_back(other[i]); }
+    }
+  };
+  struct Keep {
+    const std::vector<size_t>& indices;
+    template <typename T>
+    void operator()(std::vector<T>& column, const std::vector<T>&) {
+      for (size_t k = 0; k < indices.size(); k++) { column[k] = column[indices[k]]; }
+      column.resize(indices.size());
+    }
+  };
+
+ private:
+  std::vector<uint16_t> waveforms;  // size() x waveformStride
+  size_t waveformStride = 0;
+};
+
+}  // namespace GROWTH_FY2015_ADC_Type
+
+#endif /* EVENTBATCH_HH_ */
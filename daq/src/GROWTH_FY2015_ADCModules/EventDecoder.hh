@@ -8,303 +8,279 @@
 #ifndef EVENTDECODER_HH_
 #define EVENTDECODER_HH_
 
-#include <queue>
-#include <stack>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "GROWTH_FY2015_ADCModules/EventBatch.hh"
 #include "GROWTH_FY2015_ADCModules/Types.hh"
+#include "GROWTH_FY2015_ADCModules/EventPacketFormat.hh"
+#include "GROWTH_FY2015_ADCModules/Debug.hh"
+#include "Logger.hh"
 
 /** Decodes event data received from the SpaceFibre ADC Board.
- * Decoded event instances will be stored in a queue.
+ * Decoded events are appended to an EventBatch, and taken with popDecodedEvents().
+ * Packets are decoded by EventDecoderForFormat<Format>, which is selected
+ * by create() according to the FPGA version of the board.
  */
 class EventDecoder {
- private:
-  struct RawEvent {
-    uint8_t ch;
-    uint8_t timeH;
-    uint16_t timeM;
-    uint16_t timeL;
-    uint16_t triggerCount;
-    uint16_t phaMax;
-    uint16_t phaMaxTime;
-    uint16_t phaMin;
-    uint16_t phaFirst;
-    uint16_t phaLast;
-    uint16_t maxDerivative;
-    uint16_t baseline;
-    uint16_t* waveform;
-  } rawEvent;
-
- private:
-  enum class EventDecoderState {
-    state_flag_FFF0,
-    state_ch_realtimeH,
-    state_realtimeM,
-    state_realtimeL,
-    state_reserved,
-    state_triggerCount,
-    state_phaMax,
-    state_phaMaxTime,
-    state_phaMin,
-    state_phaFirst,
-    state_phaLast,
-    state_maxDerivative,
-    state_baseline,
-    state_pha_list
-  };
-
- private:
-  EventDecoderState state;
-  std::vector<GROWTH_FY2015_ADC_Type::Event*> eventQueue;
+ protected:
+  GROWTH_FY2015_ADC_Type::EventBatch decodedEvents;
   std::vector<uint16_t> readDataUint16Array;
-  std::stack<GROWTH_FY2015_ADC_Type::Event*> eventInstanceResavoir;
-  size_t waveformLength;
+  // errors repeat for every word until the decoder resynchronizes
+  Logger::RateLimit invalidStartFlagRateLimit{ErrorLogIntervalInSec};
+  Logger::RateLimit waveformTooLongRateLimit{ErrorLogIntervalInSec};
+  static constexpr double ErrorLogIntervalInSec = 10.0;
 
  public:
   /** Constructor.
    */
-  EventDecoder() {
-    state             = EventDecoderState::state_flag_FFF0;
-    rawEvent.waveform = new uint16_t[SpaceFibreADC::MaxWaveformLength];
-    prepareEventInstances();
-  }
+  EventDecoder() { decodedEvents.reserve(InitialEventBatchCapacity); }
 
  public:
-  virtual ~EventDecoder() {
-    while (eventInstanceResavoir.size() != 0) {
-      GROWTH_FY2015_ADC_Type::Event* event = eventInstanceResavoir.top();
-      eventInstanceResavoir.pop();
-      delete event->waveform;
-      delete event;
-    }
-    delete rawEvent.waveform;
-  }
+  virtual ~EventDecoder() {}
 
  public:
-  void decodeEvent(std::vector<uint8_t>* readDataUint8Array) {
-    using namespace std;
+  /** Creates a decoder of the event packet format sent by an FPGA image.
+   * @param[in] fpgaVersion value of the FPGA Version register (GROWTH_FY2015_ADC::getFPGAVersion())
+   * @return decoder instance (to be deleted by the caller)
+   */
+  static EventDecoder* create(uint32_t fpgaVersion);
 
+ public:
+  void decodeEvent(std::vector<uint8_t>* readDataUint8Array) {
     size_t size = readDataUint8Array->size();
     if (size % 2 == 1) {
-      cerr << "EventDecoder::decodeEvent(): odd data length " << size << " bytes" << endl;
+      Logger::error() << "EventDecoder::decodeEvent(): odd data length " << size << " bytes";
+      Logger::flush();
       exit(-1);
     }
 
     size_t size_half = size / 2;
 
     if (Debug::eventdecoder()) {
-      cout << "EventDecoder::decodeEvent() read " << size << " bytes (state = " << stateToString() << ")" << endl;
+      Logger::debug() << "EventDecoder::decodeEvent() read " << size << " bytes (state = " << stateToString() << ")";
     }
 
     // resize if necessary
     if (size_half > readDataUint16Array.size()) { readDataUint16Array.resize(size_half); }
 
-    // fill data
+    // fill data (big endian)
+    const uint8_t* bytes = readDataUint8Array->data();
     for (size_t i = 0; i < size_half; i++) {
-      readDataUint16Array[i] = (readDataUint8Array->at((i << 1)) << 8) + readDataUint8Array->at((i << 1) + 1);
+      readDataUint16Array[i] = (bytes[(i << 1)] << 8) + bytes[(i << 1) + 1];
     }
 
     // decode the data
-    // event packet format version 20151016
-    for (size_t i = 0; i < size_half; i++) {
+    decodeWords(readDataUint16Array.data(), size_half);
+  }
+
+ protected:
+  /** Decodes 16-bit words. A packet may continue over calls.
+   */
+  virtual void decodeWords(const uint16_t* words, size_t nWords) = 0;
+
+ public:
+  /** Returns the event packet format version decoded by this instance.
+   */
+  virtual uint32_t getFormatVersion() const = 0;
+
+ public:
+  /** Tells the number of waveform samples per packet set to the board
+   * (SamplesInEventPacket). Packets of this length are decoded by stride
+   * without the state machine; packets of other lengths (e.g. still in
+   * the EventFIFO after the setting was changed) are decoded as usual.
+   */
+  virtual void setNSamplesInEventPacket(size_t nSamples) = 0;
+
+ public:
+  static const size_t InitialEventBatchCapacity = 10000;
+
+ protected:
+  void pushEventToQueue(const EventPacketFormat::RawHeader& rawEvent, const uint16_t* waveform, size_t waveformLength) {
+    GROWTH_FY2015_ADC_Type::EventBatch& events = decodedEvents;
+    const size_t i                              = events.appendEvent();
+    events.ch[i]                                = rawEvent.ch;
+    events.timeTag[i] = (static_cast<uint64_t>(rawEvent.timeH) << 32) +
+                        (static_cast<uint64_t>(rawEvent.timeM) << 16) + (rawEvent.timeL);
+    events.phaMax[i]           = rawEvent.phaMax;
+    events.phaMaxTime[i]       = rawEvent.phaMaxTime;
+    events.phaMin[i]           = rawEvent.phaMin;
+    events.phaFirst[i]         = rawEvent.phaFirst;
+    events.phaLast[i]          = rawEvent.phaLast;
+    events.maxDerivative[i]    = rawEvent.maxDerivative;
+    events.baseline[i]         = rawEvent.baseline;
+    events.triggerCount[i]     = rawEvent.triggerCount;
+    events.unwrappedTimeTag[i] = events.timeTag[i];
+    events.setWaveform(i, waveform, waveformLength);
+  }
+
+ public:
+  /** Moves decoded events to the end of the specified batch.
+   * @param[out] events decoded events are appended
+   * @return the number of moved events
+   */
+  size_t popDecodedEvents(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+    const size_t nEvents = decodedEvents.size();
+    if (events.empty()) {
+      events.swap(decodedEvents);
+    } else {
+      events.append(decodedEvents);
+    }
+    decodedEvents.clear();
+    return nEvents;
+  }
+
+ public:
+  virtual std::string stateToString() const = 0;
+};
+
+/** Decodes event packets of a format described by Format (see EventPacketFormat.hh).
+ * The header is parsed with Format::Header::parse(), which is unrolled at
+ * compile time. Only a header split over two reads is copied to a buffer first.
+ */
+template <typename Format>
+class EventDecoderForFormat : public EventDecoder {
+ private:
+  enum class EventDecoderState { state_flag_start, state_header, state_pha_list, state_flag_terminator };
+
+ private:
+  static const size_t NHeaderWords = Format::Header::NWords;
+
+ private:
+  EventDecoderState state = EventDecoderState::state_flag_start;
+  EventPacketFormat::RawHeader rawEvent{};
+  uint16_t headerWords[NHeaderWords];
+  size_t nHeaderWords = 0;
+  std::vector<uint16_t> waveform = std::vector<uint16_t>(SpaceFibreADC::MaxWaveformLength);
+  size_t waveformLength = 0;
+  size_t packetLength   = 0;  // words per packet including flags (0 = unknown)
+
+ public:
+  uint32_t getFormatVersion() const override { return Format::Version; }
+
+ public:
+  void setNSamplesInEventPacket(size_t nSamples) override {
+    packetLength = 1 + NHeaderWords + (Format::HasWaveform ? nSamples : 0) + 1;
+  }
+
+ protected:
+  void decodeWords(const uint16_t* words, size_t nWords) override {
+    using namespace std;
+    size_t i = 0;
+    while (i < nWords) {
+      if (state == EventDecoderState::state_flag_start && packetLength != 0) {
+        i = decodeFixedLengthPackets(words, i, nWords);
+        if (i == nWords) { break; }
+      }
       switch (state) {
-        case EventDecoderState::state_flag_FFF0:
+        case EventDecoderState::state_flag_start:
           waveformLength = 0;
-          if (readDataUint16Array[i] == 0xfff0) {
-            state = EventDecoderState::state_ch_realtimeH;
+          nHeaderWords   = 0;
+          if (words[i] == Format::StartFlag) {
+            i++;
+            if (nWords - i >= NHeaderWords) {
+              Format::Header::parse(words + i, rawEvent);
+              i += NHeaderWords;
+              state = afterHeader();
+            } else {
+              state = EventDecoderState::state_header;
+            }
           } else {
-            cerr << "EventDecoder::decodeEvent(): invalid start flag ("
-                 << "0x" << hex << right << setw(4) << setfill('0') << (uint32_t)readDataUint16Array[i] << ")" << endl;
+            Logger::warning(invalidStartFlagRateLimit)
+                << "EventDecoder::decodeEvent(): invalid start flag ("
+                << "0x" << hex << right << setw(4) << setfill('0') << (uint32_t)words[i] << ")";
+            i++;
           }
           break;
-        case EventDecoderState::state_ch_realtimeH:
-          rawEvent.ch    = (readDataUint16Array[i] & 0xFF00) >> 8;
-          rawEvent.timeH = readDataUint16Array[i] & 0xFF;
-          state          = EventDecoderState::state_realtimeM;
-          break;
-        case EventDecoderState::state_realtimeM:
-          rawEvent.timeM = readDataUint16Array[i];
-          state          = EventDecoderState::state_realtimeL;
-          break;
-        case EventDecoderState::state_realtimeL:
-          rawEvent.timeL = readDataUint16Array[i];
-          state          = EventDecoderState::state_reserved;
-          break;
-        case EventDecoderState::state_reserved:
-          state = EventDecoderState::state_triggerCount;
-          break;
-        case EventDecoderState::state_triggerCount:
-          rawEvent.triggerCount = readDataUint16Array[i];
-          state                 = EventDecoderState::state_phaMax;
-          break;
-        case EventDecoderState::state_phaMax:
-          rawEvent.phaMax = readDataUint16Array[i];
-          state           = EventDecoderState::state_phaMaxTime;
-          break;
-        case EventDecoderState::state_phaMaxTime:
-          rawEvent.phaMaxTime = readDataUint16Array[i];
-          state               = EventDecoderState::state_phaMin;
-          break;
-        case EventDecoderState::state_phaMin:
-          rawEvent.phaMin = readDataUint16Array[i];
-          state           = EventDecoderState::state_phaFirst;
-          break;
-        case EventDecoderState::state_phaFirst:
-          rawEvent.phaFirst = readDataUint16Array[i];
-          state             = EventDecoderState::state_phaLast;
-          break;
-        case EventDecoderState::state_phaLast:
-          rawEvent.phaLast = readDataUint16Array[i];
-          state            = EventDecoderState::state_maxDerivative;
-          break;
-        case EventDecoderState::state_maxDerivative:
-          rawEvent.maxDerivative = readDataUint16Array[i];
-          state                  = EventDecoderState::state_baseline;
-          break;
-        case EventDecoderState::state_baseline:
-          rawEvent.baseline = readDataUint16Array[i];
-          state             = EventDecoderState::state_pha_list;
+        case EventDecoderState::state_header:
+          // header split over reads
+          while (i < nWords && nHeaderWords < NHeaderWords) { headerWords[nHeaderWords++] = words[i++]; }
+          if (nHeaderWords == NHeaderWords) {
+            Format::Header::parse(headerWords, rawEvent);
+            state = afterHeader();
+          }
           break;
-        case EventDecoderState::state_pha_list:
-          if (readDataUint16Array[i] == 0xFFFF) {
-            // push GROWTH_FY2015_ADC_Type::Event to a queue
-            pushEventToQueue();
-            // move to the idle state
-            state = EventDecoderState::state_flag_FFF0;
+        case EventDecoderState::state_pha_list: {
+          size_t end = i;
+          while (end < nWords && words[end] != Format::Terminator) { end++; }
+          const size_t nSamples = end - i;
+          if (SpaceFibreADC::MaxWaveformLength < waveformLength + nSamples) {
+            Logger::warning(waveformTooLongRateLimit)
+                << "EventDecoder::decodeEvent(): waveform too long. something is wrong with data transfer. Return "
+                   "to the idle state.";
+            // drop the word which overflowed
+            i += SpaceFibreADC::MaxWaveformLength - waveformLength + 1;
+            state = EventDecoderState::state_flag_start;
             break;
+          }
+          std::copy(words + i, words + end, waveform.begin() + waveformLength);
+          waveformLength += nSamples;
+          i = end;
+          if (i < nWords) {
+            // terminator
+            pushEventToQueue(rawEvent, waveform.data(), waveformLength);
+            i++;
+            state = EventDecoderState::state_flag_start;
+          }
+          break;
+        }
+        case EventDecoderState::state_flag_terminator:
+          if (words[i] == Format::Terminator) {
+            pushEventToQueue(rawEvent, waveform.data(), 0);
           } else {
-            if (SpaceFibreADC::MaxWaveformLength <= waveformLength) {
-              cerr << "EventDecoder::decodeEvent(): waveform too long. something is wrong with data transfer. Return "
-                      "to the idle state."
-                   << endl;
-              state = EventDecoderState::state_flag_FFF0;
-            } else {
-              rawEvent.waveform[waveformLength] = readDataUint16Array[i];
-              waveformLength++;
-            }
+            Logger::warning(waveformTooLongRateLimit)
+                << "EventDecoder::decodeEvent(): terminator expected after the header. Return to the idle state.";
           }
+          i++;
+          state = EventDecoderState::state_flag_start;
           break;
       }
     }
   }
 
- public:
-  static const size_t InitialEventInstanceNumber = 10000;
-
  private:
-  void prepareEventInstances() {
-    for (size_t i = 0; i < InitialEventInstanceNumber; i++) {
-      GROWTH_FY2015_ADC_Type::Event* event = new GROWTH_FY2015_ADC_Type::Event;
-      event->waveform                      = new uint16_t[SpaceFibreADC::MaxWaveformLength];
-      eventInstanceResavoir.push(event);
-    }
-  }
-
- public:
-  void pushEventToQueue() {
-    GROWTH_FY2015_ADC_Type::Event* event;
-    if (eventInstanceResavoir.size() == 0) {
-      event = new GROWTH_FY2015_ADC_Type::Event;
-      // debug dump
-      if (Debug::eventdecoder()) {
-        using namespace std;
-        cerr << "EventDecoder::pushEventToQueue() new Event instance was created." << endl;
+  /** Decodes consecutive whole packets of packetLength words starting at words[i].
+   * Stops at a packet whose flags do not match (resynchronized by the state
+   * machine) or at a packet which continues to the next read.
+   * @return index of the first word not decoded
+   */
+  size_t decodeFixedLengthPackets(const uint16_t* words, size_t i, size_t nWords) {
+    const size_t nSamples     = packetLength - NHeaderWords - 2;
+    const uint16_t terminator = Format::Terminator;
+    while (nWords - i >= packetLength && words[i] == Format::StartFlag && words[i + packetLength - 1] == terminator) {
+      const uint16_t* samples = words + i + 1 + NHeaderWords;
+      if (std::find(samples, samples + nSamples, terminator) != samples + nSamples) {
+        break;  // shorter packet
       }
-      event->waveform = new uint16_t[SpaceFibreADC::MaxWaveformLength];
-    } else {
-      // reuse already created instance
-      event = eventInstanceResavoir.top();
-      eventInstanceResavoir.pop();
+      Format::Header::parse(words + i + 1, rawEvent);
+      pushEventToQueue(rawEvent, samples, nSamples);
+      i += packetLength;
     }
-    event->ch      = rawEvent.ch;
-    event->timeTag = (static_cast<uint64_t>(rawEvent.timeH) << 32) + (static_cast<uint64_t>(rawEvent.timeM) << 16) +
-                     (rawEvent.timeL);
-    event->phaMax        = rawEvent.phaMax;
-    event->phaMaxTime    = rawEvent.phaMaxTime;
-    event->phaMin        = rawEvent.phaMin;
-    event->phaFirst      = rawEvent.phaFirst;
-    event->phaLast       = rawEvent.phaLast;
-    event->maxDerivative = rawEvent.maxDerivative;
-    event->baseline      = rawEvent.baseline;
-    event->nSamples      = waveformLength;
-    event->triggerCount  = rawEvent.triggerCount;
-
-    // copy waveform
-    for (size_t i = 0; i < waveformLength; i++) { event->waveform[i] = rawEvent.waveform[i]; }
-
-    eventQueue.push_back(event);
+    return i;
   }
 
- public:
-  /** Returns decoded event queue (as std::vecotr).
-   * After used in user application, decoded events should be freed
-   * via EventDecoder::freeEvent(GROWTH_FY2015_ADC_Type::Event* event).
-   * @return std::queue containing pointers to decoded events
-   */
-  std::vector<GROWTH_FY2015_ADC_Type::Event*> getDecodedEvents() {
-    std::vector<GROWTH_FY2015_ADC_Type::Event*> eventQueueCopied = eventQueue;
-    eventQueue.clear();
-    return eventQueueCopied;
+ private:
+  static EventDecoderState afterHeader() {
+    return Format::HasWaveform ? EventDecoderState::state_pha_list : EventDecoderState::state_flag_terminator;
   }
 
  public:
-  /** Frees event instance so that buffer area can be reused in the following commands.
-   * @param event event instance to be freed
-   */
-  void freeEvent(GROWTH_FY2015_ADC_Type::Event* event) { eventInstanceResavoir.push(event); }
-
- public:
-  /** Returns the number of available (allocated) Event instances.
-   * @return the number of Event instances
-   */
-  size_t getNAllocatedEventInstances() { return eventInstanceResavoir.size(); }
-
- public:
- public:
-  std::string stateToString() {
+  std::string stateToString() const override {
     std::string result;
     switch (state) {
-      case EventDecoderState::state_flag_FFF0:
-        result = "state_flag_FFF0";
-        break;
-      case EventDecoderState::state_ch_realtimeH:
-        result = "state_ch_realtimeH";
-        break;
-      case EventDecoderState::state_realtimeM:
-        result = "state_realtimeM";
+      case EventDecoderState::state_flag_start:
+        result = "state_flag_start";
         break;
-      case EventDecoderState::state_realtimeL:
-        result = "state_realtimeL";
-        break;
-      case EventDecoderState::state_reserved:
-        result = "state_reserved";
-        break;
-      case EventDecoderState::state_triggerCount:
-        result = "state_triggerCount";
-        break;
-      case EventDecoderState::state_phaMax:
-        result = "state_phaMax";
-        break;
-      case EventDecoderState::state_phaMaxTime:
-        result = "state_phaMaxTime";
-        break;
-      case EventDecoderState::state_phaMin:
-        result = "state_phaMin";
-        break;
-      case EventDecoderState::state_phaFirst:
-        result = "state_phaFirst";
-        break;
-      case EventDecoderState::state_phaLast:
-        result = "state_phaLast";
-        break;
-      case EventDecoderState::state_maxDerivative:
-        result = "state_maxDerivative";
-        break;
-      case EventDecoderState::state_baseline:
-        result = "state_baseline";
+      case EventDecoderState::state_header:
+        result = "state_header (" + std::to_string(nHeaderWords) + " words)";
         break;
       case EventDecoderState::state_pha_list:
         result = "state_pha_list";
         break;
-
+      case EventDecoderState::state_flag_terminator:
+        result = "state_flag_terminator";
+        break;
       default:
         result = "Undefined status";
         break;
@@ -313,4 +289,13 @@ class EventDecoder {
   }
 };
 
+inline EventDecoder* EventDecoder::create(uint32_t fpgaVersion) {
+  const uint32_t formatVersion = EventPacketFormat::getFormatVersion(fpgaVersion);
+  switch (formatVersion) {
+    case EventPacketFormat::Format20151016::Version:
+    default:
+      return new EventDecoderForFormat<EventPacketFormat::Format20151016>();
+  }
+}
+
 #endif /* EVENTDECODER_HH_ */
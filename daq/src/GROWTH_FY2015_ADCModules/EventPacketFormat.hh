@@ -0,0 +1,150 @@
+/*
+ * EventPacketFormat.hh
+ */
+
+#ifndef EVENTPACKETFORMAT_HH_
+#define EVENTPACKETFORMAT_HH_
+
+#include <cstdint>
+#include <stddef.h>
+
+/** Compile-time descriptions of event packet formats sent by the FPGA.
+ * A format is a struct which defines:
+ * <ul>
+ *   <li> Version: format version (date of the VHDL change)
+ *   <li> StartFlag: first word of a packet
+ *   <li> Header: EventPacketFormat::Header<...> listing header words after the start flag
+ *   <li> HasWaveform: true if waveform samples follow the header
+ *   <li> Terminator: last word of a packet
+ * </ul>
+ * EventDecoderForFormat<Format> (EventDecoder.hh) decodes packets of a format.
+ * To support a new format, add a struct here, add its Version to
+ * getFormatVersion(), and add a case to EventDecoder::create().
+ */
+namespace EventPacketFormat {
+
+/** Header fields of an event packet (values of one 16-bit word each). */
+enum class Field : uint8_t {
+  ChannelAndTimeH,  // (ch << 8) | time tag bits 39-32
+  TimeM,            // time tag bits 31-16
+  TimeL,            // time tag bits 15-0
+  Reserved,         // ignored
+  TriggerCount,
+  PhaMax,
+  PhaMaxTime,
+  PhaMin,
+  PhaFirst,
+  PhaLast,
+  MaxDerivative,
+  Baseline
+};
+
+/** Header values of one event packet. */
+struct RawHeader {
+  uint8_t ch;
+  uint8_t timeH;
+  uint16_t timeM;
+  uint16_t timeL;
+  uint16_t triggerCount;
+  uint16_t phaMax;
+  uint16_t phaMaxTime;
+  uint16_t phaMin;
+  uint16_t phaFirst;
+  uint16_t phaLast;
+  uint16_t maxDerivative;
+  uint16_t baseline;
+};
+
+/** Stores a header word to RawHeader. F is a template parameter, so that
+ * the switch is resolved at compile time.
+ */
+template <Field F>
+inline void setField(RawHeader& header, uint16_t word) {
+  switch (F) {
+    case Field::ChannelAndTimeH:
+      header.ch    = (word & 0xFF00) >> 8;
+      header.timeH = word & 0xFF;
+      break;
+    case Field::TimeM:
+      header.timeM = word;
+      break;
+    case Field::TimeL:
+      header.timeL = word;
+      break;
+    case Field::Reserved:
+      break;
+    case Field::TriggerCount:
+      header.triggerCount = word;
+      break;
+    case Field::PhaMax:
+      header.phaMax = word;
+      break;
+    case Field::PhaMaxTime:
+      header.phaMaxTime = word;
+      break;
+    case Field::PhaMin:
+      header.phaMin = word;
+      break;
+    case Field::PhaFirst:
+      header.phaFirst = word;
+      break;
+    case Field::PhaLast:
+      header.phaLast = word;
+      break;
+    case Field::MaxDerivative:
+      header.maxDerivative = word;
+      break;
+    case Field::Baseline:
+      header.baseline = word;
+      break;
+  }
+}
+
+/** List of header words (after the start flag) in the packet order.
+ * parse() is expanded to one store per word at compile time.
+ */
+template <Field... Fields>
+struct Header;
+
+template <>
+struct Header<> {
+  static const size_t NWords = 0;
+  static void parse(const uint16_t*, RawHeader&) {}
+};
+
+template <Field F, Field... Rest>
+struct Header<F, Rest...> {
+  static const size_t NWords = 1 + Header<Rest...>::NWords;
+  static void parse(const uint16_t* words, RawHeader& header) {
+    setField<F>(header, words[0]);
+    Header<Rest...>::parse(words + 1, header);
+  }
+};
+
+/** Event packet format version 20151016 (see UserModule_ChannelModule_PulseProcessor.vhdl).
+ * FFF0, 12 header words, waveform (SamplesInEventPacket words), FFFF.
+ */
+struct Format20151016 {
+  static const uint32_t Version      = 0x20151016;
+  static const uint16_t StartFlag    = 0xFFF0;
+  static const uint16_t Terminator   = 0xFFFF;
+  static const bool HasWaveform      = true;
+  using Header = EventPacketFormat::Header<Field::ChannelAndTimeH, Field::TimeM, Field::TimeL, Field::Reserved,
+                                           Field::TriggerCount, Field::PhaMax, Field::PhaMaxTime, Field::PhaMin,
+                                           Field::PhaFirst, Field::PhaLast, Field::MaxDerivative, Field::Baseline>;
+};
+
+/** Returns the event packet format version sent by an FPGA image.
+ * @param[in] fpgaVersion value of the FPGA Version register
+ * @return format version (Version of one of the format structs)
+ */
+inline uint32_t getFormatVersion(uint32_t fpgaVersion) {
+  // all released images (up to FPGA version 20171031) send format 20151016;
+  // add a branch here when the VHDL changes the packet layout
+  (void)fpgaVersion;
+  return Format20151016::Version;
+}
+
+}  // namespace EventPacketFormat
+
+#endif /* EVENTPACKETFORMAT_HH_ */
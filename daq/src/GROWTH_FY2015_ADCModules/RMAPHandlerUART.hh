@@ -8,17 +8,24 @@
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <vector>
 
 class RMAPHandlerUART : public RMAPHandler {
  private:
   SpaceWireIFOverUART* spwif;
   std::string deviceName;
+  size_t baudRate;
+  // serializes RMAP transactions issued from multiple threads (e.g. event reader and main thread)
+  std::mutex transactionMutex;
 
  public:
-  RMAPHandlerUART(std::string deviceName, std::vector<RMAPTargetNode*> rmapTargetNodes) : RMAPHandler() {
+  RMAPHandlerUART(std::string deviceName, std::vector<RMAPTargetNode*> rmapTargetNodes,
+                  size_t baudRate = SpaceWireIFOverUART::BAUD_RATE)
+      : RMAPHandler() {
     using namespace std;
     this->deviceName      = deviceName;
+    this->baudRate        = baudRate;
     this->timeOutDuration = 2000.0;
     this->maxNTrials      = 10;
     this->useDraftECRC    = false;
@@ -40,13 +47,16 @@ class RMAPHandlerUART : public RMAPHandler {
  public:
   virtual ~RMAPHandlerUART() {}
 
+ public:
+  SpaceWireIFOverUART* getSpaceWireIF() { return spwif; }
+
  public:
   bool connectoToSpaceWireToGigabitEther() {
     using namespace std;
     if (spwif != NULL) { delete spwif; }
 
     // connect to UART-USB-SpaceWire interface
-    spwif = new SpaceWireIFOverUART(this->deviceName);
+    spwif = new SpaceWireIFOverUART(this->deviceName, this->baudRate);
     try {
       spwif->open();
       _isConnectedToSpWGbE = true;
@@ -101,6 +111,48 @@ class RMAPHandlerUART : public RMAPHandler {
     cout << "RMAPHandler::disconnectSpWGbE(): Completed" << endl;
   }
 
+ public:
+  /** Re-establishes the link after a failure of the UART-USB device.
+   * Unlike disconnectSpWGbE(), this method does not assume that the current
+   * SpaceWire interface and RMAPEngine still work. The interface is closed
+   * first so that the RMAPEngine thread blocked in receive() returns, and the
+   * wait for the RMAPEngine to stop is bounded. Then the serial port is
+   * reopened, and a new RMAPEngine/RMAPInitiator pair is started.
+   * RMAPTargetNodes and the settings of this instance are kept.
+   * @return true if the link was re-established
+   */
+  bool reconnect() {
+    using namespace std;
+    _isConnectedToSpWGbE = false;
+    if (spwif != NULL) {
+      try {
+        spwif->close();
+      } catch (...) {}
+    }
+    bool engineStopped = true;
+    if (rmapEngine != NULL) {
+      rmapEngine->stop();
+      CxxUtilities::Condition c;
+      for (size_t i = 0; i < MaxNWaitsForRMAPEngineStop && !rmapEngine->hasStopped; i++) { c.wait(100); }
+      engineStopped = rmapEngine->hasStopped;
+    }
+    delete rmapInitiator;
+    rmapInitiator = NULL;
+    if (engineStopped) {
+      delete rmapEngine;
+      delete spwif;
+    } else {
+      // the thread may still touch these instances; abandon them rather than deleting
+      cerr << "RMAPHandlerUART::reconnect(): RMAPEngine did not stop; old instances are abandoned" << endl;
+    }
+    rmapEngine = NULL;
+    spwif      = NULL;
+    return connectoToSpaceWireToGigabitEther();
+  }
+
+ private:
+  static const size_t MaxNWaitsForRMAPEngineStop = 50;  // x 100 ms
+
  public:
   void read(std::string rmapTargetNodeID, uint32_t memoryAddress, uint32_t length, uint8_t* buffer) {
     RMAPTargetNode* targetNode;
@@ -125,6 +177,7 @@ class RMAPHandlerUART : public RMAPHandler {
  public:
   void read(RMAPTargetNode* rmapTargetNode, uint32_t memoryAddress, uint32_t length, uint8_t* buffer) {
     using namespace std;
+    std::lock_guard<std::mutex> lock(transactionMutex);
     if (rmapInitiator == NULL) { return; }
     for (size_t i = 0; i < maxNTrials; i++) {
       try {
@@ -152,6 +205,7 @@ class RMAPHandlerUART : public RMAPHandler {
  public:
   void read(RMAPTargetNode* rmapTargetNode, std::string memoryObjectID, uint8_t* buffer) {
     using namespace std;
+    std::lock_guard<std::mutex> lock(transactionMutex);
     if (rmapInitiator == NULL) { return; }
     for (size_t i = 0; i < maxNTrials; i++) {
       try {
@@ -196,6 +250,7 @@ class RMAPHandlerUART : public RMAPHandler {
  public:
   void write(RMAPTargetNode* rmapTargetNode, uint32_t memoryAddress, uint8_t* data, uint32_t length) {
     using namespace std;
+    std::lock_guard<std::mutex> lock(transactionMutex);
     if (rmapInitiator == NULL) { return; }
     for (size_t i = 0; i < maxNTrials; i++) {
       try {
@@ -224,6 +279,7 @@ class RMAPHandlerUART : public RMAPHandler {
  public:
   void write(RMAPTargetNode* rmapTargetNode, std::string memoryObjectID, uint8_t* data) {
     using namespace std;
+    std::lock_guard<std::mutex> lock(transactionMutex);
     if (rmapInitiator == NULL) { return; }
     for (size_t i = 0; i < maxNTrials; i++) {
       try {
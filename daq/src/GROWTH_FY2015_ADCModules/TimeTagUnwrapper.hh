@@ -0,0 +1,101 @@
+/*
+ * TimeTagUnwrapper.hh
+ */
+
+#ifndef TIMETAGUNWRAPPER_HH_
+#define TIMETAGUNWRAPPER_HH_
+
+#include <cstdint>
+
+/** Extends the 40-bit FPGA time tag to a monotonic 64-bit counter.
+ * The FPGA time tag wraps around every 2^40 clocks (about 3 hours at 100 MHz).
+ * Wraparound is detected when a time tag is smaller than the previous one
+ * by more than a half of the counter range. Events that arrive slightly out
+ * of order across a wraparound are assigned to the epoch they belong to.
+ */
+class TimeTagUnwrapper {
+ public:
+  static const uint64_t TimeTagModulo = static_cast<uint64_t>(1) << 40;
+  static const uint64_t TimeTagMask   = TimeTagModulo - 1;
+
+ private:
+  bool initialized     = false;
+  uint64_t offset      = 0;
+  uint64_t lastTimeTag = 0;
+  size_t nWraparounds  = 0;
+  uint64_t base        = 0;  // added to unwrapped time tags (see restartFrom())
+  bool originPending   = false;
+  uint64_t origin      = 0;
+
+ public:
+  /** Converts a 40-bit time tag to a 64-bit unwrapped time tag.
+   * @param[in] timeTag 40-bit time tag as recorded in EventBatch::timeTag
+   * @return unwrapped time tag in the unit of FPGA clock
+   */
+  uint64_t unwrap(uint64_t timeTag) {
+    timeTag &= TimeTagMask;
+    if (!initialized) {
+      initialized = true;
+      lastTimeTag = timeTag;
+      if (originPending) {
+        base          = origin - timeTag;  // modulo 2^64
+        originPending = false;
+      }
+      return base + timeTag;
+    }
+    if (timeTag < lastTimeTag && lastTimeTag - timeTag > TimeTagModulo / 2) {
+      // wrapped around
+      offset += TimeTagModulo;
+      nWraparounds++;
+      lastTimeTag = timeTag;
+    } else if (timeTag > lastTimeTag && timeTag - lastTimeTag > TimeTagModulo / 2) {
+      // late event from the previous epoch
+      if (offset >= TimeTagModulo) { return base + offset - TimeTagModulo + timeTag; }
+      return base + timeTag;
+    } else if (timeTag > lastTimeTag) {
+      lastTimeTag = timeTag;
+    }
+    return base + offset + timeTag;
+  }
+
+ public:
+  /** Returns the most recent unwrapped time tag.
+   */
+  uint64_t getLatestUnwrappedTimeTag() const { return base + offset + lastTimeTag; }
+
+ public:
+  /** Returns true if a time tag has been unwrapped since construction or the last reset.
+   */
+  bool isInitialized() const { return initialized; }
+
+ public:
+  /** Returns the number of detected wraparounds.
+   */
+  size_t getNWraparounds() const { return nWraparounds; }
+
+ public:
+  /** Forgets the history so that the next time tag starts a new sequence.
+   */
+  void reset() {
+    initialized   = false;
+    offset        = 0;
+    lastTimeTag   = 0;
+    nWraparounds  = 0;
+    base          = 0;
+    originPending = false;
+  }
+
+ public:
+  /** Forgets the history, and maps the next time tag to origin. Used when the
+   * FPGA counter has been restarted (e.g. the board was reprogrammed after
+   * link recovery) so that the unwrapped time continues from origin instead
+   * of jumping backward.
+   */
+  void restartFrom(uint64_t origin) {
+    reset();
+    this->origin  = origin;
+    originPending = true;
+  }
+};
+
+#endif /* TIMETAGUNWRAPPER_HH_ */
@@ -33,20 +33,8 @@ struct HouseKeepingData {
   bool acquisitionStarted[SpaceFibreADC::NumberOfChannels];
 };
 
-struct Event {
-  uint8_t ch;
-  uint64_t timeTag;
-  uint16_t triggerCount;
-  uint16_t phaMax;
-  uint16_t phaMaxTime;
-  uint16_t phaMin;
-  uint16_t phaFirst;
-  uint16_t phaLast;
-  uint16_t maxDerivative;
-  uint16_t baseline;
-  uint16_t nSamples;
-  uint16_t* waveform;
-};
+/** Maximum number of ADC boards driven by one process (board index is stored in 4 bits). */
+static const size_t MaxNumberOfBoards = 16;
 
 enum class ADCClockFrequency : uint16_t { ADCClock200MHz = 20000, ADCClock100MHz = 10000, ADCClock50MHz = 5000 };
 }  // namespace GROWTH_FY2015_ADC_Type
@@ -0,0 +1,214 @@
+#ifndef SRC_LIGHTCURVE_HH_
+#define SRC_LIGHTCURVE_HH_
+
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+
+/** Count-rate light curve held in memory.
+ * Events are counted in fixed-width time bins per channel and per energy (PHA)
+ * band. Bins are arranged as a ring buffer, so the memory usage is bounded by
+ * the number of bins, and filling a single event is O(1). Time is taken from
+ * EventBatch::timeTag, extended to 64 bit, and converted to second using
+ * GROWTH_FY2015_ADC::ClockInterval. Time tags of all boards have to be on a
+ * common time base (BoardTimeAligner); otherwise only the first board should
+ * be counted (setNBoardsInUse()).
+ */
+class LightCurve {
+public:
+	/** Snapshot of the most recent bins returned by getLightCurve().
+	 * counts is arranged as counts[(ch * nBands + band) * nBins + bin].
+	 */
+	struct Data {
+		double binWidthInSec;
+		double startTimeInSec; // FPGA time of the first bin
+		size_t nBins;
+		size_t nChannels;
+		size_t nBands;
+		std::vector<uint32_t> energyBandBoundaries;
+		std::vector<uint32_t> counts;
+	};
+
+public:
+	/** @param[in] binWidthInSec width of a time bin
+	 * @param[in] lengthInSec time span held in the ring buffer
+	 * @param[in] energyBandBoundaries PHA boundaries; band i covers [boundaries[i], boundaries[i+1])
+	 * @param[in] nChannels number of channels (counted over all boards, see GROWTH_FY2015_ADC_Type::getGlobalChannelIndex())
+	 */
+	LightCurve(double binWidthInSec, double lengthInSec, std::vector<uint32_t> energyBandBoundaries,
+			size_t nChannels = SpaceFibreADC::NumberOfChannels) :
+			energyBandBoundaries(energyBandBoundaries), nChannels(nChannels), //
+			nBoards(std::max<size_t>(nChannels / SpaceFibreADC::NumberOfChannels, 1)), nBoardsInUse(nBoards) {
+		if (this->energyBandBoundaries.size() < 2) {
+			this->energyBandBoundaries = { 0, DefaultUpperPHABoundary };
+		}
+		nBands = this->energyBandBoundaries.size() - 1;
+		binWidthInClock = static_cast<uint64_t>(binWidthInSec / GROWTH_FY2015_ADC::ClockInterval + 0.5);
+		if (binWidthInClock == 0) {
+			binWidthInClock = 1;
+		}
+		nBins = static_cast<size_t>(lengthInSec / binWidthInSec + 0.5);
+		if (nBins == 0) {
+			nBins = 1;
+		}
+		binNumbers.assign(nBins, static_cast<uint64_t>(EmptyBin));
+		counts.assign(nBins * nChannels * nBands, 0);
+	}
+
+public:
+	static const uint32_t DefaultUpperPHABoundary = 65536;
+
+public:
+	/** Adds events to the light curve.
+	 * @param[in] events decoded events
+	 */
+	void fill(const GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		mutex.lock();
+		for (size_t i = 0; i < events.size(); i++) {
+			if (events.boardIndex[i] >= nBoardsInUse) {
+				continue;
+			}
+			const uint64_t time = unwrapper.unwrap(events.timeTag[i]);
+			fillEvent(events.getGlobalChannelIndex(i), time, events.phaMax[i]);
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Returns the most recent bins covering the specified duration.
+	 * @param[in] durationInSec duration to be returned (at least one bin, at most the ring buffer length)
+	 */
+	Data getLightCurve(double durationInSec) {
+		Data data;
+		data.binWidthInSec = binWidthInClock * GROWTH_FY2015_ADC::ClockInterval;
+		data.nChannels = nChannels;
+		data.nBands = nBands;
+		data.energyBandBoundaries = energyBandBoundaries;
+		// clamped before the conversion (static_cast of a negative, NaN or too large value is undefined)
+		const double nRequestedBinsInDouble = durationInSec / data.binWidthInSec + 0.5;
+		size_t nRequestedBins = 1;
+		if (nRequestedBinsInDouble >= nBins) {
+			nRequestedBins = nBins;
+		} else if (nRequestedBinsInDouble >= 1) {
+			nRequestedBins = static_cast<size_t>(nRequestedBinsInDouble);
+		}
+		mutex.lock();
+		if (latestBinNumber == EmptyBin) {
+			data.nBins = 0;
+			data.startTimeInSec = 0;
+			mutex.unlock();
+			return data;
+		}
+		data.nBins = std::min( { nRequestedBins, nBins, static_cast<size_t>(latestBinNumber + 1) });
+		const uint64_t firstBinNumber = latestBinNumber + 1 - data.nBins;
+		data.startTimeInSec = firstBinNumber * data.binWidthInSec;
+		data.counts.assign(data.nBins * nChannels * nBands, 0);
+		for (size_t i = 0; i < data.nBins; i++) {
+			const uint64_t binNumber = firstBinNumber + i;
+			const size_t slot = binNumber % nBins;
+			if (binNumbers[slot] != binNumber) {
+				continue; // no event in this bin
+			}
+			for (size_t ch = 0; ch < nChannels; ch++) {
+				for (size_t band = 0; band < nBands; band++) {
+					data.counts[(ch * nBands + band) * data.nBins + i] = counts[(slot * nChannels + ch) * nBands + band];
+				}
+			}
+		}
+		mutex.unlock();
+		return data;
+	}
+
+public:
+	/** Called when the time tag counter has been restarted (start of a run, or
+	 * the board was reprogrammed after link recovery and time tags are not
+	 * mapped to a common time base). The next event is placed at the latest
+	 * time filled so far, so that the light curve continues instead of going
+	 * back to past bins (the time the board was stopped is not represented).
+	 * @param[in] boardIndex index of the board
+	 */
+	void restartTimeTag(size_t boardIndex) {
+		mutex.lock();
+		if (boardIndex < nBoardsInUse) {
+			if (latestBinNumber == EmptyBin) {
+				unwrapper.reset();
+			} else {
+				unwrapper.restartFrom(latestTime);
+			}
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Counts events of the first nBoards boards only (e.g. when the time tags
+	 * of the boards do not share a common time base). Events of the other
+	 * boards are ignored.
+	 */
+	void setNBoardsInUse(size_t nBoards) {
+		mutex.lock();
+		nBoardsInUse = std::min(nBoards, this->nBoards);
+		mutex.unlock();
+	}
+
+public:
+	double getBinWidthInSec() const {
+		return binWidthInClock * GROWTH_FY2015_ADC::ClockInterval;
+	}
+
+private:
+	void fillEvent(size_t ch, uint64_t time, uint16_t phaMax) {
+		if (ch >= nChannels) {
+			return;
+		}
+		const uint64_t binNumber = time / binWidthInClock;
+		const size_t slot = binNumber % nBins;
+		if (binNumbers[slot] != binNumber) {
+			if (binNumbers[slot] != EmptyBin && binNumbers[slot] > binNumber) {
+				return; // older than the time span of the ring buffer
+			}
+			// recycle the slot
+			binNumbers[slot] = binNumber;
+			std::fill_n(counts.begin() + slot * nChannels * nBands, nChannels * nBands, 0);
+		}
+		if (latestBinNumber == EmptyBin || latestBinNumber < binNumber) {
+			latestBinNumber = binNumber;
+		}
+		if (latestTime < time) {
+			latestTime = time;
+		}
+		const size_t band = findBand(phaMax);
+		if (band < nBands) {
+			counts[(slot * nChannels + ch) * nBands + band]++;
+		}
+	}
+
+private:
+	size_t findBand(uint16_t pha) const {
+		if (pha < energyBandBoundaries[0]) {
+			return nBands;
+		}
+		for (size_t band = 0; band < nBands; band++) {
+			if (pha < energyBandBoundaries[band + 1]) {
+				return band;
+			}
+		}
+		return nBands;
+	}
+
+private:
+	static const uint64_t EmptyBin = UINT64_MAX;
+	std::vector<uint32_t> energyBandBoundaries;
+	size_t nChannels;
+	size_t nBands;
+	size_t nBins;
+	uint64_t binWidthInClock;
+	uint64_t latestBinNumber = EmptyBin;
+	uint64_t latestTime = 0; // latest unwrapped time tag filled
+	std::vector<uint64_t> binNumbers;
+	std::vector<uint32_t> counts;
+	size_t nBoards;
+	size_t nBoardsInUse;
+	TimeTagUnwrapper unwrapper; // common to all boards
+	CxxUtilities::Mutex mutex;
+};
+
+#endif /* SRC_LIGHTCURVE_HH_ */
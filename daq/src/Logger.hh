@@ -0,0 +1,391 @@
+#ifndef SRC_LOGGER_HH_
+#define SRC_LOGGER_HH_
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include "GROWTH_FY2015_ADCModules/Debug.hh"
+
+/** Leveled, asynchronous logger of the DAQ program.
+ * A message is composed by the calling thread, and pushed to a bounded
+ * lock-free queue. A background thread writes queued messages to stdout
+ * (Debug, Info) or stderr (Warning, Error) every FlushIntervalInMillisec, so
+ * that threads reading events never wait for the terminal, the SD card, or
+ * the log capture of the process supervisor. When the queue is full, messages
+ * are dropped and the number of dropped messages is reported later.
+ * Messages logged in a loop should be limited with RateLimit.
+ *
+ * Usage:
+ * <pre>
+ * Logger::info() << "Received " << n << " events";
+ * Logger::warning(rateLimit) << "Invalid start flag";
+ * </pre>
+ * Each message is written as one line: "YYYY-MM-DDTHH:MM:SS.mmmZ LEVEL message".
+ */
+class Logger {
+public:
+	enum class Level : uint8_t {
+		Debug = 0, Info = 1, Warning = 2, Error = 3
+	};
+
+private:
+	static const size_t QueueSize = 1024; // power of 2
+	static const size_t MaximumMessageLength = 255; // longer messages are truncated
+	static const uint32_t FlushIntervalInMillisec = 100;
+
+public:
+	/** Limits a repeated message to one per interval.
+	 * An instance is owned by the thread which logs the message (not thread safe).
+	 */
+	class RateLimit {
+	public:
+		RateLimit(double intervalInSec) :
+				interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double>(intervalInSec))) {
+		}
+
+	public:
+		/** Returns true if a message can be logged now. Otherwise, the message is counted as suppressed.
+		 */
+		bool allow() {
+			const auto now = std::chrono::steady_clock::now();
+			if (logged && now - timeOfLastMessage < interval) {
+				nSuppressed++;
+				return false;
+			}
+			logged = true;
+			timeOfLastMessage = now;
+			return true;
+		}
+
+	public:
+		/** Returns and clears the number of messages suppressed since the last logged one.
+		 */
+		size_t takeNSuppressed() {
+			const size_t n = nSuppressed;
+			nSuppressed = 0;
+			return n;
+		}
+
+	private:
+		std::chrono::steady_clock::duration interval;
+		std::chrono::steady_clock::time_point timeOfLastMessage;
+		bool logged = false;
+		size_t nSuppressed = 0;
+	};
+
+public:
+	/** A message being composed. It is queued when destructed.
+	 */
+	class Line {
+	public:
+		Line(Level level, bool enabled, size_t nSuppressed = 0) :
+				level(level), nSuppressed(nSuppressed) {
+			if (enabled) {
+				stream.reset(new std::ostringstream());
+			}
+		}
+
+	public:
+		Line(Line&& other) = default;
+
+	public:
+		~Line() {
+			if (stream) {
+				if (nSuppressed != 0) {
+					*stream << " (" << nSuppressed << " similar message(s) suppressed)";
+				}
+				getInstance().push(level, stream->str());
+			}
+		}
+
+	public:
+		/** Numbers are taken by value (static const members can be logged without definitions). */
+		template<typename T>
+		typename std::enable_if<std::is_arithmetic<T>::value, Line&>::type operator<<(T value) {
+			if (stream) {
+				*stream << value;
+			}
+			return *this;
+		}
+
+	public:
+		template<typename T>
+		typename std::enable_if<!std::is_arithmetic<T>::value, Line&>::type operator<<(const T& value) {
+			if (stream) {
+				*stream << value;
+			}
+			return *this;
+		}
+
+	public:
+		/** Accepts manipulators such as std::hex. */
+		Line& operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {
+			if (stream) {
+				*stream << manipulator;
+			}
+			return *this;
+		}
+
+	public:
+		/** Accepts std::endl (ignored; one message is one line). */
+		Line& operator<<(std::ostream& (*)(std::ostream&)) {
+			return *this;
+		}
+
+	private:
+		Level level;
+		size_t nSuppressed;
+		std::unique_ptr<std::ostringstream> stream; // nullptr if the level is disabled
+	};
+
+public:
+	static Line debug() {
+		return log(Level::Debug);
+	}
+
+public:
+	static Line info() {
+		return log(Level::Info);
+	}
+
+public:
+	static Line warning() {
+		return log(Level::Warning);
+	}
+
+public:
+	static Line error() {
+		return log(Level::Error);
+	}
+
+public:
+	static Line debug(RateLimit& rateLimit) {
+		return log(Level::Debug, rateLimit);
+	}
+
+public:
+	static Line info(RateLimit& rateLimit) {
+		return log(Level::Info, rateLimit);
+	}
+
+public:
+	static Line warning(RateLimit& rateLimit) {
+		return log(Level::Warning, rateLimit);
+	}
+
+public:
+	static Line error(RateLimit& rateLimit) {
+		return log(Level::Error, rateLimit);
+	}
+
+public:
+	static Line log(Level level) {
+		return Line(level, isEnabled(level));
+	}
+
+public:
+	static Line log(Level level, RateLimit& rateLimit) {
+		if (!isEnabled(level) || !rateLimit.allow()) {
+			return Line(level, false);
+		}
+		return Line(level, true, rateLimit.takeNSuppressed());
+	}
+
+public:
+	/** Returns true if messages of the level are output (e.g. to skip preparing a costly message).
+	 */
+	static bool isEnabled(Level level) {
+		return static_cast<uint8_t>(level) >= getInstance().minimumLevel.load(std::memory_order_relaxed);
+	}
+
+public:
+	/** Sets the minimum level of output messages (default Info; Debug in traced builds).
+	 */
+	static void setLevel(Level level) {
+		getInstance().minimumLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+	}
+
+public:
+	/** Converts "debug", "info", "warning", or "error" to a level.
+	 * @return false if the string is not a valid level
+	 */
+	static bool parseLevel(const std::string& name, Level& level) {
+		for (const Level candidate : { Level::Debug, Level::Info, Level::Warning, Level::Error }) {
+			std::string label = toString(candidate);
+			if (name == label) {
+				level = candidate;
+				return true;
+			}
+			for (auto& c : label) {
+				c = tolower(c);
+			}
+			if (name == label) {
+				level = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+public:
+	static const char* toString(Level level) {
+		switch (level) {
+		case Level::Debug:
+			return "DEBUG";
+		case Level::Info:
+			return "INFO";
+		case Level::Warning:
+			return "WARNING";
+		default:
+			return "ERROR";
+		}
+	}
+
+public:
+	/** Writes all queued messages now (e.g. before the process exits).
+	 */
+	static void flush() {
+		getInstance().writeQueuedMessages();
+	}
+
+public:
+	~Logger() {
+		stopped.store(true);
+		flushThread.join();
+		writeQueuedMessages();
+	}
+
+private:
+	Logger() :
+			minimumLevel(static_cast<uint8_t>(GROWTH_DAQ_TRACE != 0 ? Level::Debug : Level::Info)), enqueuePosition(0), dequeuePosition(0), nDroppedMessages(0), //
+			stopped(false) {
+		for (size_t i = 0; i < QueueSize; i++) {
+			queue[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		flushThread = std::thread([this]() {
+			while (!stopped.load()) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<uint32_t>(FlushIntervalInMillisec)));
+				writeQueuedMessages();
+			}
+		});
+	}
+
+private:
+	static Logger& getInstance() {
+		static Logger instance;
+		return instance;
+	}
+
+private:
+	struct Entry {
+		Level level;
+		std::chrono::system_clock::time_point time;
+		char text[MaximumMessageLength + 1];
+	};
+
+private:
+	/** Slot of the bounded multi-producer queue (sequence-numbered ring buffer).
+	 */
+	struct Cell {
+		std::atomic<size_t> sequence;
+		Entry entry;
+	};
+
+private:
+	void push(Level level, const std::string& message) {
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true) {
+			cell = &queue[position & (QueueSize - 1)];
+			const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (difference < 0) {
+				nDroppedMessages.fetch_add(1, std::memory_order_relaxed); // full
+				return;
+			} else {
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		cell->entry.level = level;
+		cell->entry.time = std::chrono::system_clock::now();
+		const size_t length = (message.size() < MaximumMessageLength) ? message.size() : MaximumMessageLength;
+		memcpy(cell->entry.text, message.data(), length);
+		cell->entry.text[length] = '\0';
+		cell->sequence.store(position + 1, std::memory_order_release);
+	}
+
+private:
+	/** Pops and writes messages (only one thread at a time; see writing).
+	 */
+	void writeQueuedMessages() {
+		if (writing.exchange(true)) {
+			return; // the other thread is writing
+		}
+		bool written[2] = { false, false };
+		while (true) {
+			const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			Cell& cell = queue[position & (QueueSize - 1)];
+			if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+				break; // empty, or the producer has not finished writing
+			}
+			FILE* output = (cell.entry.level >= Level::Warning) ? stderr : stdout;
+			writeLine(output, cell.entry);
+			written[output == stderr ? 1 : 0] = true;
+			cell.sequence.store(position + QueueSize, std::memory_order_release);
+			dequeuePosition.store(position + 1, std::memory_order_relaxed);
+		}
+		const size_t nDropped = nDroppedMessages.exchange(0);
+		if (nDropped != 0) {
+			fprintf(stderr, "Logger: %zu message(s) dropped (queue full)\n", nDropped);
+			written[1] = true;
+		}
+		if (written[0]) {
+			fflush(stdout);
+		}
+		if (written[1]) {
+			fflush(stderr);
+		}
+		writing.store(false);
+	}
+
+private:
+	static void writeLine(FILE* output, const Entry& entry) {
+		const auto sinceEpoch = entry.time.time_since_epoch();
+		const time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count();
+		const long milliseconds = static_cast<long>(
+				std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count() % 1000);
+		struct tm t;
+		gmtime_r(&seconds, &t);
+		char timeString[32];
+		strftime(timeString, sizeof(timeString), "%Y-%m-%dT%H:%M:%S", &t);
+		fprintf(output, "%s.%03ldZ %-7s %s\n", timeString, milliseconds,
+				toString(entry.level), entry.text);
+	}
+
+private:
+	std::atomic<uint8_t> minimumLevel;
+	Cell queue[QueueSize];
+	std::atomic<size_t> enqueuePosition;
+	std::atomic<size_t> dequeuePosition;
+	std::atomic<size_t> nDroppedMessages;
+	std::atomic<bool> writing { false };
+	std::atomic<bool> stopped;
+	std::thread flushThread;
+};
+
+#endif /* SRC_LOGGER_HH_ */
@@ -18,6 +18,24 @@ TApplication* app;
 #include <cstdlib>
 #include "GROWTH_FY2015_ADC.hh"
 #include "EventListFileFITS.hh"
+#include "LightCurve.hh"
+#include "BurstDetector.hh"
+#include "PulseShapeAnalyzer.hh"
+#include "TrapezoidalFilter.hh"
+#include "BaselineEstimator.hh"
+#include "BoardReader.hh"
+#include "TimeOrderedEventMerger.hh"
+#include "CoincidenceBuilder.hh"
+#include "TimeReconstructor.hh"
+#include "BoardTimeAligner.hh"
+#include "EventPublisher.hh"
+#include "Logger.hh"
+#include <sstream>
+#include <map>
+#include <memory>
+#ifdef RASPBERRY_PI
+#include "ADCDAC.hh"
+#endif
 
 //#define DRAW_CANVAS 0
 
@@ -28,7 +46,7 @@ enum class DAQStatus {
 
 class MainThread: public CxxUtilities::StoppableThread {
 public:
-	std::string deviceName;
+	std::string deviceName; // comma-separated list of UART devices (one per ADC board)
 	std::string configurationFile;
 	double exposureInSec;
 
@@ -39,6 +57,7 @@ public:
 		this->configurationFile = configurationFile;
 		this->switchOutputFile = false;
 		setDAQStatus(DAQStatus::Paused);
+		publishStatusSnapshot();
 	}
 
 public:
@@ -46,7 +65,22 @@ public:
 		using namespace std;
 		setDAQStatus(DAQStatus::Running);
 		switchOutputFile = false;
-		adcBoard = new GROWTH_FY2015_ADC(deviceName);
+		if (!CxxUtilities::File::exists(configurationFile)) {
+			Logger::error() << "YAML configuration file " << configurationFile << " not found.";
+			::exit(-1);
+		}
+		const std::vector<std::string> deviceNames = splitDeviceNames(deviceName);
+		if (deviceNames.size() == 0 || deviceNames.size() > GROWTH_FY2015_ADC_Type::MaxNumberOfBoards) {
+			Logger::error() << "1 to " << GROWTH_FY2015_ADC_Type::MaxNumberOfBoards << " UART devices should be provided ("
+					<< deviceName << ").";
+			::exit(-1);
+		}
+		const size_t baudRate = getUARTBaudRate();
+		for (auto& name : deviceNames) {
+			adcBoards.push_back(new GROWTH_FY2015_ADC(name, baudRate));
+		}
+		// the first board provides GPS time and temperature, and is used for the link self-test
+		adcBoard = adcBoards[0];
 
 		fpgaType = adcBoard->getFPGAType();
 		fpgaVersion = adcBoard->getFPGAVersion();
@@ -64,20 +98,136 @@ public:
 		//---------------------------------------------
 		// Load configuration file
 		//---------------------------------------------
-		if (!CxxUtilities::File::exists(configurationFile)) {
-			cerr << "Error: YAML configuration file " << configurationFile << " not found." << endl;
-			::exit(-1);
+		for (auto board : adcBoards) {
+			board->loadConfigurationFile(configurationFile);
+		}
+
+		//---------------------------------------------
+		// Measure UART link throughput
+		//---------------------------------------------
+		if (adcBoard->UARTLinkSelfTestTransactions != 0) {
+			linkThroughput = adcBoard->measureLinkThroughput(adcBoard->UARTLinkSelfTestTransactions);
+			Logger::info() << "UART link self-test (" << linkThroughput.baudRate << " baud): " //
+					<< linkThroughput.transactionsPerSec << " RMAP transactions/s, " //
+					<< linkThroughput.meanLatencyInMillisec << " ms/transaction, " //
+					<< linkThroughput.wireBytesPerSec << " bytes/s received";
+		}
+
+		//---------------------------------------------
+		// Align time tags of boards (latched at the same PPS)
+		//---------------------------------------------
+		bool hasCommonTimeBase = true;
+		if (adcBoards.size() > 1) {
+			boardTimeAligner = new BoardTimeAligner(adcBoards.size());
+			try {
+				hasCommonTimeBase = latchTimeTagOffsets(adcBoard->getGPSRegisterUInt8());
+			} catch (RMAPHandler::RMAPHandlerException& e) {
+				hasCommonTimeBase = false;
+			} catch (CxxUtilities::Exception& e) {
+				hasCommonTimeBase = false;
+			}
+			if (hasCommonTimeBase) {
+				Logger::info() << "Time tags of " << adcBoards.size() << " boards aligned at the PPS.";
+			} else {
+				Logger::error() << "Failed to align time tags of the boards (PPS not connected to all boards?); "
+						<< "events are not merged in time order, and the light curve, coincidence and burst trigger "
+						<< "use the first board only.";
+				delete boardTimeAligner;
+				boardTimeAligner = nullptr;
+			}
+		}
+		// boards whose time tags can be compared
+		const size_t nBoardsOnCommonTimeBase = hasCommonTimeBase ? adcBoards.size() : 1;
+
+		//---------------------------------------------
+		// Prepare light curve (kept across pause/resume)
+		//---------------------------------------------
+		if (lightCurve == nullptr) {
+			lightCurve = new LightCurve(adcBoard->LightCurveBinWidthInSec, adcBoard->LightCurveLengthInSec,
+					adcBoard->LightCurveEnergyBandBoundaries, getNChannelsOfAllBoards());
 		}
-		adcBoard->loadConfigurationFile(configurationFile);
+		lightCurve->setNBoardsInUse(nBoardsOnCommonTimeBase);
+		// time tag counters restart when the boards are programmed
+		lightCurve->restartTimeTag(0);
 
-		cout << "//---------------------------------------------" << endl //
-				<< "// Start acquisition" << endl //
-				<< "//---------------------------------------------" << endl;
+		//---------------------------------------------
+		// Prepare pulse-shape analysis
+		//---------------------------------------------
+		if (adcBoard->PulseShapeAnalysisEnabled) {
+			pulseShapeAnalyzer = new PulseShapeAnalyzer(adcBoard->PreTriggerSamples,
+					adcBoard->PulseShapeTailStartOffset);
+		}
+
+		//---------------------------------------------
+		// Prepare trapezoidal filter
+		//---------------------------------------------
+		if (adcBoard->TrapezoidalFilterEnabled) {
+			trapezoidalFilter = new TrapezoidalFilter(adcBoard->TrapezoidalFilterRiseTime,
+					adcBoard->TrapezoidalFilterFlatTop, adcBoard->TrapezoidalFilterDecayTimeConstant,
+					adcBoard->PreTriggerSamples);
+		}
+
+		//---------------------------------------------
+		// Prepare baseline tracking (kept across pause/resume)
+		//---------------------------------------------
+		if (adcBoard->BaselineTrackingEnabled && baselineEstimator == nullptr) {
+			baselineEstimator = new BaselineEstimator(adcBoard->BaselineTrackingTimeConstantInEvents,
+					adcBoard->PreTriggerSamples, getNChannelsOfAllBoards());
+		}
+
+		//---------------------------------------------
+		// Prepare time-ordered merge of channels/boards
+		//---------------------------------------------
+		if (adcBoard->TimeOrderedMergeLatencyInSec > 0 && hasCommonTimeBase) {
+			eventMerger = new TimeOrderedEventMerger(adcBoards.size(), adcBoard->TimeOrderedMergeLatencyInSec);
+		}
+
+		//---------------------------------------------
+		// Prepare coincidence/veto builder
+		//---------------------------------------------
+		if (adcBoard->CoincidenceEnabled) {
+			if (eventMerger == nullptr) {
+				Logger::warning() << "Coincidence is evaluated on events in the EventFIFO order because "
+						<< "TimeOrderedMergeLatencyInSec is 0.";
+			}
+			const double holdTimeInSec =
+					(adcBoard->TimeOrderedMergeLatencyInSec > MinimumCoincidenceHoldTimeInSec) ?
+							adcBoard->TimeOrderedMergeLatencyInSec : MinimumCoincidenceHoldTimeInSec;
+			coincidenceBuilder = new CoincidenceBuilder(nBoardsOnCommonTimeBase, adcBoard->CoincidenceWindowInSec,
+					adcBoard->VetoChannels, adcBoard->DropVetoedEvents, holdTimeInSec);
+		}
+
+		//---------------------------------------------
+		// Prepare event stream (kept across pause/resume; the port is bound once)
+		//---------------------------------------------
+		if (adcBoard->EventPublisherPort != 0 && eventPublisher == nullptr) {
+			try {
+				eventPublisher = new EventPublisher(adcBoard->EventPublisherPort, adcBoard->EventPublisherPrescale,
+						adcBoard->EventPublisherChannels, getNChannelsOfAllBoards());
+				Logger::info() << "Publishing events on port " << adcBoard->EventPublisherPort << ".";
+			} catch (zmq::error_t& e) {
+				Logger::warning() << "Failed to open the event stream (" << e.what() << ").";
+			}
+		}
+
+		//---------------------------------------------
+		// Prepare burst trigger
+		//---------------------------------------------
+		burstActive = false;
+		if (adcBoard->BurstTriggerEnabled) {
+			burstDetector = new BurstDetector(adcBoard->BurstTriggerShortWindowInSec,
+					adcBoard->BurstTriggerLongWindowInSec, adcBoard->BurstTriggerThresholdInSigma,
+					adcBoard->BurstTriggerHoldTimeInSec, nBoardsOnCommonTimeBase);
+		}
+
+		Logger::info() << "Starting acquisition (" << adcBoards.size() << " board(s)).";
 		try {
-			adcBoard->startAcquisition();
-			cout << "Acquisition started." << endl;
+			for (auto board : adcBoards) {
+				board->startAcquisition();
+			}
+			Logger::info() << "Acquisition started.";
 		} catch (...) {
-			cerr << "Failed to start acquisition." << endl;
+			Logger::error() << "Failed to start acquisition.";
 			::exit(-1);
 		}
 
@@ -89,24 +239,33 @@ public:
 		//---------------------------------------------
 		// Send CPU Trigger
 		//---------------------------------------------
-		cout << "Sending CPU Trigger" << endl;
-		adcBoard->sendCPUTrigger();
+		Logger::info() << "Sending CPU Trigger";
+		for (auto board : adcBoards) {
+			board->sendCPUTrigger();
+		}
 
 		//---------------------------------------------
 		// Read raw ADC values
 		//---------------------------------------------
 		for (size_t i = 0; i < 4; i++) {
-			cout << "Ch." << i << " ADC ";
+			auto line = Logger::info();
+			line << "Ch." << i << " ADC";
 			for (size_t o = 0; o < 5; o++) {
-				cout << (uint32_t) adcBoard->getCurrentADCValue(i) << " " << endl;
+				line << " " << (uint32_t) adcBoard->getCurrentADCValue(i);
 			}
 		}
 
+		//---------------------------------------------
+		// Prepare absolute-time reconstruction (anchored by GPS Time Register reads)
+		//---------------------------------------------
+		if (adcBoard->TimeReconstructionEnabled) {
+			timeReconstructor = new TimeReconstructor(adcBoards.size(), adcBoard->ClockJumpThresholdInSec);
+		}
+
 		//---------------------------------------------
 		// Read GPS Register
 		//---------------------------------------------
-		cout << "Reading GPS Register" << endl;
-		cout << adcBoard->getGPSRegister() << endl;
+		Logger::info() << "GPS Register: " << adcBoard->getGPSRegister();
 		readAnsSaveGPSRegister();
 
 		//---------------------------------------------
@@ -127,30 +286,72 @@ public:
 		canvasUpdateCounter = 0;
 #endif
 
+		for (size_t i = 0; i < adcBoards.size(); i++) {
+			boardReaders.push_back(new BoardReader(i, adcBoards[i], eventReadWaitDuration));
+			boardReaders.back()->start();
+		}
+		linkRecoveries.assign(boardReaders.size(), LinkRecovery { });
+		latestTimeTags.assign(boardReaders.size(), 0);
+
 		uint32_t elapsedTime = 0;
 		size_t nReceivedEvents = 0;
 		stopped = false;
+		pausedDurationInSec = 0;
+		commandMutex.lock();
+		runLoopActive = true;
+		commandMutex.unlock();
+		publishStatusSnapshot();
 		while (!stopped) {
-			nReceivedEvents = readAndThenSaveEvents();
-			if (nReceivedEvents == 0) {
-				c.wait(eventReadWaitDuration);
-			}
-			// Get current UNIX time
-			uint32_t currentUnixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
-			// Read GPS register if necessary
-			if (currentUnixTime - unixTimeOfLastGPSRegisterRead > GPSRegisterReadWaitInSec) {
-				readAnsSaveGPSRegister();
-			}
-			// Update elapsed time
-			elapsedTime = currentUnixTime - startUnixTime;
-			// Check whether specified exposure has been completed
-			if(exposureInSec > 0 && elapsedTime >= exposureInSec){
-				break;
+			try {
+				processCommands();
+				nReceivedEvents = readAndThenSaveEvents();
+				if (nReceivedEvents == 0) {
+					c.wait(eventReadWaitDuration);
+				}
+				// Recover boards whose reader stopped due to link failure (one trial per board and pass)
+				recoverLinks();
+				// Get current UNIX time
+				uint32_t currentUnixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+				// GPS registers are accessed via the first board
+				const bool firstBoardLinkUp = !boardReaders[0]->hasLinkFailed();
+				// Read GPS register if necessary
+				if (firstBoardLinkUp && currentUnixTime - unixTimeOfLastGPSRegisterRead > GPSRegisterReadWaitInSec) {
+					readAnsSaveGPSRegister();
+				}
+				// Sample NMEA sentences from the GPS Data FIFO
+				if (firstBoardLinkUp && adcBoard->GPSNMEASamplingIntervalInSec != 0) {
+					sampleGPSDataFIFO(currentUnixTime);
+				}
+				// Publish per-second summary of the event stream
+				if (eventPublisher != nullptr) {
+					eventPublisher->publishSummaryIfNecessary();
+				}
+				// Sample temperature for baseline drift monitoring
+				if (currentUnixTime - unixTimeOfLastTemperatureRead > TemperatureReadWaitInSec) {
+					readTemperatureForBaselineTracking();
+				}
+				// Copy link error counters (adcBoard is deleted when paused)
+				updateSSDTPErrorCounters();
+				// Update elapsed time (paused time is excluded)
+				elapsedTime = getElapsedTime();
+				// Publish status for MessageServer once per second
+				if (currentUnixTime != unixTimeOfLastStatusSnapshot) {
+					publishStatusSnapshot();
+				}
+				// Check whether specified exposure has been completed
+				if(exposureInSec > 0 && elapsedTime >= exposureInSec){
+					break;
+				}
+			} catch (RMAPHandler::RMAPHandlerException& e) {
+				// failed in an access from this thread (GPS register of the first board)
+				boardReaders[0]->reportLinkFailure();
+			} catch (CxxUtilities::Exception& e) {
+				boardReaders[0]->reportLinkFailure();
 			}
 		}
 
 #ifdef DRAW_CANVAS
-		cout << "Saving histogram" << endl;
+		Logger::info() << "Saving histogram";
 		TFile* file = new TFile("histogram.root", "recreate");
 		file->cd();
 		hist->Write();
@@ -160,26 +361,100 @@ public:
 		//---------------------------------------------
 		// Finalize observation run
 		//---------------------------------------------
+		commandMutex.lock();
+		runLoopActive = false;
+		commandMutex.unlock();
+		rejectQueuedCommands("observation run ended");
 
 		// Stop acquisition first
-		adcBoard->stopAcquisition();
+		for (auto reader : boardReaders) {
+			if (reader->hasLinkFailed()) {
+				continue;
+			}
+			try {
+				reader->getADCBoard()->stopAcquisition();
+			} catch (...) {
+				Logger::error() << "Failed to stop acquisition of board " << reader->getBoardIndex() << ".";
+			}
+		}
 
 		// Completely read the EventFIFO
+		for (size_t i = 0; i < 3; i++) {
+			c.wait(eventReadWaitDuration);
+			readAndThenSaveEvents();
+		}
+		for (auto reader : boardReaders) {
+			reader->stop();
+			reader->join();
+		}
+		flushEventMerger = true;
 		readAndThenSaveEvents();
-		readAndThenSaveEvents();
-		readAndThenSaveEvents();
-		cout << "Saving event list" << endl;
+		flushEventMerger = false;
+		for (auto reader : boardReaders) {
+			delete reader;
+		}
+		boardReaders.clear();
+		linkRecoveries.clear();
+		Logger::info() << "Saving event list";
 
 		// Close output file
 		closeOutputEventListFile();
 
+		// Restore normal recording mode if stopped during a burst
+		if (burstActive) {
+			setBurstRecordingMode(false);
+		}
+		delete burstDetector;
+		burstDetector = nullptr;
+		delete pulseShapeAnalyzer;
+		pulseShapeAnalyzer = nullptr;
+		delete trapezoidalFilter;
+		trapezoidalFilter = nullptr;
+		delete eventMerger;
+		eventMerger = nullptr;
+		nLateEventsOfPreviousRuns = nLateEvents;
+		delete coincidenceBuilder;
+		coincidenceBuilder = nullptr;
+		delete timeReconstructor;
+		timeReconstructor = nullptr;
+		delete boardTimeAligner;
+		boardTimeAligner = nullptr;
+		nClockJumpsOfPreviousRuns = nClockJumps;
+		coincidenceStatisticsOfPreviousRuns = coincidenceStatistics;
+
+		// Accumulate link error counters of this run
+		updateSSDTPErrorCounters();
+		nSSDTPResyncsOfPreviousRuns = nSSDTPResyncs;
+		nSSDTPDiscardedBytesOfPreviousRuns = nSSDTPDiscardedBytes;
+
 		// FIanlize the board
-		adcBoard->closeDevice();
-		cout << "Waiting child threads to be finalized..." << endl;
+		for (auto board : adcBoards) {
+			try {
+				board->closeDevice();
+			} catch (...) {
+				Logger::error() << "Failed to close the device.";
+			}
+		}
+		Logger::info() << "Waiting child threads to be finalized...";
 		c.wait(1000);
-		cout << "Deleting ADCBoard instance." << endl;
-		delete adcBoard;
+		Logger::info() << "Deleting ADCBoard instance.";
+		for (auto board : adcBoards) {
+			delete board;
+		}
+		adcBoards.clear();
+		adcBoard = nullptr;
 		setDAQStatus(DAQStatus::Paused);
+		publishStatusSnapshot();
+	}
+
+public:
+	~MainThread() {
+		delete lightCurve;
+		delete baselineEstimator;
+		delete eventPublisher;
+#ifdef RASPBERRY_PI
+		delete adcdac;
+#endif
 	}
 
 public:
@@ -200,7 +475,18 @@ public:
 public:
 	const size_t getElapsedTime() const {
 		uint32_t currentUnixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
-		return currentUnixTime - startUnixTime;
+		uint32_t pausedTime = pausedDurationInSec;
+		if (runLoopActive && daqStatus == DAQStatus::Paused) {
+			pausedTime += currentUnixTime - pauseStartUnixTime;
+		}
+		return currentUnixTime - startUnixTime - pausedTime;
+	}
+
+public:
+	/** Returns true while an observation run is ongoing (the boards are connected), including a paused state.
+	 */
+	bool isRunLoopActive() const {
+		return runLoopActive;
 	}
 
 public:
@@ -222,6 +508,263 @@ public:
 		}
 	}
 
+public:
+	/** Returns the in-memory light curve, or nullptr if acquisition has never been started.
+	 */
+	LightCurve* getLightCurve() const {
+		return lightCurve;
+	}
+
+public:
+	/** Returns the baseline estimator, or nullptr if baseline tracking is disabled.
+	 */
+	BaselineEstimator* getBaselineEstimator() const {
+		return baselineEstimator;
+	}
+
+public:
+	/** Returns the result of the UART link self-test performed at the start of acquisition.
+	 */
+	GROWTH_FY2015_ADC::LinkThroughput getLinkThroughput() const {
+		return linkThroughput;
+	}
+
+public:
+	/** Returns the number of SSDTP resynchronizations since the process started.
+	 */
+	uint64_t getNSSDTPResyncs() const {
+		return nSSDTPResyncs;
+	}
+
+public:
+	/** Returns the number of bytes discarded by the SSDTP deframer since the process started.
+	 */
+	uint64_t getNSSDTPDiscardedBytes() const {
+		return nSSDTPDiscardedBytes;
+	}
+
+public:
+	/** Statistics of automatic link recovery (see recoverLinks()).
+	 */
+	struct LinkRecoveryStatistics {
+		size_t nFailures; // number of detected link failures
+		size_t nRecoveries; // number of successful recoveries
+		size_t nTrials; // number of recovery attempts (including failed ones)
+		double lastRecoveryTimeInSec; // time from detection to resumption of the last recovery
+		double maxRecoveryTimeInSec;
+		double totalRecoveryTimeInSec; // total readout downtime due to link failures
+		uint32_t lastFailureUnixTime;
+	};
+
+public:
+	/** Returns statistics of automatic link recovery since the process started.
+	 */
+	LinkRecoveryStatistics getLinkRecoveryStatistics() const {
+		return linkRecoveryStatistics;
+	}
+
+public:
+	/** Returns the number of events released out of time order by the time-ordered merge.
+	 */
+	uint64_t getNLateEvents() const {
+		return nLateEvents;
+	}
+
+public:
+	/** Statistics of the coincidence/veto builder (see CoincidenceBuilder).
+	 */
+	struct CoincidenceStatistics {
+		uint64_t nCoincidences; // number of groups which hit two or more channels
+		uint64_t nVetoedEvents; // number of events flagged as vetoed
+		uint64_t nDroppedEvents; // number of vetoed events which were not written
+	};
+
+public:
+	/** Returns statistics of the coincidence/veto builder since the process started.
+	 */
+	CoincidenceStatistics getCoincidenceStatistics() const {
+		return coincidenceStatistics;
+	}
+
+public:
+	/** Returns the number of FPGA clock jumps detected by the time reconstruction since the process started.
+	 */
+	size_t getNClockJumps() const {
+		return nClockJumps;
+	}
+
+public:
+	/** Returns the ratio of the measured FPGA clock interval to the nominal one (1 if not measured).
+	 */
+	double getClockRateRatio() const {
+		return clockRateRatio;
+	}
+
+public:
+	/** Parameter change during acquisition (see ControlCommand::Type::SetParameters).
+	 */
+	struct ParameterChangeRequest {
+		size_t boardIndex;
+		GROWTH_FY2015_ADC::HotParameters parameters;
+	};
+
+public:
+	/** Command which changes the state of acquisition (see submitCommand()).
+	 */
+	struct ControlCommand {
+		enum class Type {
+			Stop, //
+			Pause, // stops only the channels and the event data output (the board connection and the output file are kept)
+			Resume, // resumes paused acquisition, or starts a new run if no run is ongoing
+			StartNewOutputFile, //
+			SetParameters // changes registers, and records the change in the PARAMETERS HDU
+		};
+		Type type;
+		ParameterChangeRequest parameterChange; // for SetParameters
+	};
+
+public:
+	/** Result of a ControlCommand.
+	 */
+	struct CommandResult {
+		bool succeeded;
+		std::string errorMessage;
+	};
+
+public:
+	/** Queues a command. Commands are executed in order by this thread at a
+	 * safe point of the run loop (between two readouts), so the caller never
+	 * waits for acquisition. If no observation run is ongoing, the command is
+	 * executed (or rejected) immediately. Stop is always executed immediately
+	 * (it only requests the run loop to exit), so that it takes effect even if
+	 * the run loop is busy, e.g. with link recovery.
+	 * @return sequence number used to take the result with takeCommandResult()
+	 */
+	uint64_t submitCommand(const ControlCommand& command) {
+		commandMutex.lock();
+		nSubmittedCommands++;
+		const uint64_t sequence = nSubmittedCommands;
+		if (runLoopActive && command.type != ControlCommand::Type::Stop) {
+			commandQueue.push_back(std::make_pair(sequence, command));
+			commandMutex.unlock();
+			return sequence;
+		}
+		commandMutex.unlock();
+		// no run loop drains the queue, or Stop
+		CommandResult result { true, "" };
+		switch (command.type) {
+		case ControlCommand::Type::Stop:
+			this->stop();
+			break;
+		case ControlCommand::Type::Resume:
+			if (daqStatus == DAQStatus::Paused) {
+				this->start();
+			}
+			break;
+		case ControlCommand::Type::StartNewOutputFile:
+			switchOutputFile = true;
+			break;
+		default:
+			result = CommandResult { false, "DAQ is not running" };
+			break;
+		}
+		setCommandResult(sequence, result);
+		return sequence;
+	}
+
+public:
+	/** Takes the result of a command submitted with submitCommand().
+	 * Results which are not taken are discarded after MaximumNCommandResults later commands.
+	 * @return false if the command has not been executed yet
+	 */
+	bool takeCommandResult(uint64_t sequence, CommandResult& result) {
+		commandMutex.lock();
+		auto entry = commandResults.find(sequence);
+		if (entry == commandResults.end()) {
+			commandMutex.unlock();
+			return false;
+		}
+		result = entry->second;
+		commandResults.erase(entry);
+		commandMutex.unlock();
+		return true;
+	}
+
+public:
+	/** Status published by this thread once per second (and when the state changes).
+	 * Readers get a consistent copy without touching objects owned by this thread.
+	 */
+	struct StatusSnapshot {
+		uint32_t unixTime; // time of publication
+		DAQStatus daqStatus;
+		bool boardConnected; // see isRunLoopActive()
+		std::string outputFileName;
+		size_t elapsedTime;
+		size_t nEvents;
+		size_t elapsedTimeOfCurrentOutputFile;
+		size_t nEventsOfCurrentOutputFile;
+		bool burstActive;
+		size_t nBursts;
+		GROWTH_FY2015_ADC::LinkThroughput linkThroughput;
+		LinkRecoveryStatistics linkRecovery;
+		uint64_t nLateEvents;
+		CoincidenceStatistics coincidence;
+		size_t nClockJumps;
+		double clockRateRatio;
+		bool gpsFixValid;
+		NMEAParser::Fix gpsFix;
+		size_t nNMEASentences;
+		size_t nDiscardedNMEASentences;
+		uint64_t nSSDTPResyncs;
+		uint64_t nSSDTPDiscardedBytes;
+		std::vector<BaselineEstimator::Status> baselines; // per channel; empty if baseline tracking is disabled
+	};
+
+public:
+	/** Returns the latest status snapshot (never nullptr).
+	 */
+	std::shared_ptr<const StatusSnapshot> getStatusSnapshot() const {
+		statusSnapshotMutex.lock();
+		std::shared_ptr<const StatusSnapshot> snapshot = statusSnapshot;
+		statusSnapshotMutex.unlock();
+		return snapshot;
+	}
+
+public:
+	/** Returns the latest GPS solution decoded from NMEA sentences.
+	 */
+	NMEAParser::Fix getGPSFix() const {
+		return gpsFix;
+	}
+
+public:
+	/** Returns true if the latest GPS Data FIFO sample contained a valid fix.
+	 */
+	bool isGPSFixValid() const {
+		return gpsFixValid;
+	}
+
+public:
+	/** Returns the number of NMEA sentences received (valid, discarded).
+	 */
+	std::pair<size_t, size_t> getNNMEASentences() const {
+		return std::make_pair(nmeaParser.getNSentences(), nmeaParser.getNDiscardedSentences());
+	}
+
+public:
+	/** Returns true if a burst detected by the burst trigger is ongoing.
+	 */
+	bool isBurstActive() const {
+		return burstActive;
+	}
+
+public:
+	/** Returns the number of bursts detected since the process started.
+	 */
+	size_t getNBursts() const {
+		return nBursts;
+	}
+
 public:
 	/** This method is called to close the current output event list file,
 	 * and create a new file with a new time stamp. This method is called by
@@ -229,7 +772,7 @@ public:
 	 * A new file is created when the next event(s) is(are) read from the board.
 	 */
 	void startNewOutputFile() {
-		switchOutputFile = true;
+		submitCommand(ControlCommand { ControlCommand::Type::StartNewOutputFile, ParameterChangeRequest { } });
 	}
 
 private:
@@ -239,15 +782,13 @@ private:
 		// Read status
 		//---------------------------------------------
 		ChannelModule* channelModule = adcBoard->getChannelRegister(debugChannel);
-		printf("Debugging Ch.%d\n", debugChannel);
-		printf("ADC          = %d\n", channelModule->getCurrentADCValue());
-		printf("Livetime     = %d\n", channelModule->getLivetime());
-		cout << channelModule->getStatus() << endl;
+		Logger::info() << "Debugging Ch." << debugChannel << ": ADC = " << channelModule->getCurrentADCValue()
+				<< ", Livetime = " << channelModule->getLivetime();
+		Logger::info() << channelModule->getStatus();
 		size_t eventFIFODataCount = adcBoard->getRMAPHandler()->getRegister(		//
 				ConsumerManagerEventFIFO::AddressOf_EventFIFO_DataCount_Register);
-		printf("EventFIFO Count = %zu\n", eventFIFODataCount);
-		printf("TriggerCount = %zu\n", channelModule->getTriggerCount());
-		printf("ADC          = %d\n", channelModule->getCurrentADCValue());
+		Logger::info() << "EventFIFO Count = " << eventFIFODataCount << ", TriggerCount = "
+				<< channelModule->getTriggerCount() << ", ADC = " << channelModule->getCurrentADCValue();
 	}
 
 private:
@@ -259,10 +800,361 @@ private:
 
 private:
 	void readAnsSaveGPSRegister() {
-		eventListFile->fillGPSTime(adcBoard->getGPSRegisterUInt8());
+		uint8_t* gpsTimeRegister = adcBoard->getGPSRegisterUInt8();
+		eventListFile->fillGPSTime(gpsTimeRegister);
+		// when NMEA sentences are sampled, the register is used only while the receiver reports a fix
+		const bool gpsLocked = (adcBoard->GPSNMEASamplingIntervalInSec == 0) || gpsFixValid;
+		// follow the drift between the clocks of the boards
+		if (boardTimeAligner != nullptr && gpsLocked && !latchTimeTagOffsets(gpsTimeRegister)) {
+			Logger::warning(boardTimeRateLimit) << "Failed to latch time tag offsets of the boards; "
+					<< "the previous offsets are kept.";
+		}
+		const uint64_t timeTagOffset = (boardTimeAligner != nullptr) ? boardTimeAligner->getOffset(0) : 0;
+		if (timeReconstructor != nullptr && gpsLocked
+				&& !timeReconstructor->addGPSTimeRegister(gpsTimeRegister, timeTagOffset)) {
+			Logger::warning(gpsTimeRateLimit) << "GPS Time Register does not contain a valid time (GPS not locked?)";
+		}
 		unixTimeOfLastGPSRegisterRead = CxxUtilities::Time::getUNIXTimeAsUInt32();
 	}
 
+private:
+	/** Latches time tag offsets of all boards (see BoardTimeAligner).
+	 * @param[in] gpsTimeRegisterOfFirstBoard GPS Time Register just read from the first board
+	 * @return false if the first board, or any board whose link is up, could not be latched
+	 */
+	bool latchTimeTagOffsets(const uint8_t* gpsTimeRegisterOfFirstBoard) {
+		if (!boardTimeAligner->latchGPSTimeRegister(0, gpsTimeRegisterOfFirstBoard)) {
+			return false;
+		}
+		bool succeeded = true;
+		for (size_t i = 1; i < adcBoards.size(); i++) {
+			if (i < boardReaders.size() && boardReaders[i]->hasLinkFailed()) {
+				continue;
+			}
+			if (!latchTimeTagOffset(i)) {
+				succeeded = false;
+			}
+		}
+		return succeeded;
+	}
+
+private:
+	/** Latches the time tag offset of a board. The registers of the boards are
+	 * read one after another, so the first board is read again if a PPS came
+	 * in between. A failed access to another board is reported as its link
+	 * failure (while the readers run); that to the first board is thrown.
+	 */
+	bool latchTimeTagOffset(size_t boardIndex) {
+		const size_t nTrials = 2;
+		for (size_t trial = 0; trial < nTrials; trial++) {
+			uint8_t* gpsTimeRegister;
+			try {
+				gpsTimeRegister = adcBoards[boardIndex]->getGPSRegisterUInt8();
+			} catch (...) {
+				if (boardIndex == 0) {
+					throw;
+				}
+				if (boardIndex < boardReaders.size()) {
+					boardReaders[boardIndex]->reportLinkFailure();
+				}
+				return false;
+			}
+			if (boardTimeAligner->latchGPSTimeRegister(boardIndex, gpsTimeRegister)) {
+				return true;
+			}
+			if (boardIndex == 0 || !boardTimeAligner->latchGPSTimeRegister(0, adcBoard->getGPSRegisterUInt8())) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+private:
+	/** Pops events read by BoardReader threads, and maps their time tags to
+	 * the common time base of the boards.
+	 */
+	void popEventsOfBoards(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		const size_t firstRow = events.size();
+		for (auto reader : boardReaders) {
+			reader->popEvents(events);
+		}
+		if (boardTimeAligner != nullptr) {
+			boardTimeAligner->align(events, firstRow);
+		}
+	}
+
+private:
+	/** Executes commands queued with submitCommand().
+	 */
+	void processCommands() {
+		commandMutex.lock();
+		if (commandQueue.size() == 0) {
+			commandMutex.unlock();
+			return;
+		}
+		std::vector<std::pair<uint64_t, ControlCommand>> commands;
+		commands.swap(commandQueue);
+		commandMutex.unlock();
+
+		for (auto& entry : commands) {
+			CommandResult result { true, "" };
+			switch (entry.second.type) {
+			case ControlCommand::Type::Stop: // executed by submitCommand()
+				stopped = true;
+				break;
+			case ControlCommand::Type::Pause:
+				pauseAcquisition();
+				break;
+			case ControlCommand::Type::Resume:
+				resumeAcquisition();
+				break;
+			case ControlCommand::Type::StartNewOutputFile:
+				switchOutputFile = true;
+				break;
+			case ControlCommand::Type::SetParameters:
+				result.succeeded = applyParameterChange(entry.second.parameterChange, result.errorMessage);
+				break;
+			}
+			setCommandResult(entry.first, result);
+		}
+		publishStatusSnapshot();
+	}
+
+private:
+	/** Rejects commands which were queued but not executed.
+	 */
+	void rejectQueuedCommands(const std::string& reason) {
+		commandMutex.lock();
+		std::vector<std::pair<uint64_t, ControlCommand>> commands;
+		commands.swap(commandQueue);
+		commandMutex.unlock();
+		for (auto& entry : commands) {
+			setCommandResult(entry.first, CommandResult { false, reason });
+		}
+	}
+
+private:
+	void setCommandResult(uint64_t sequence, const CommandResult& result) {
+		commandMutex.lock();
+		commandResults[sequence] = result;
+		while (commandResults.size() > MaximumNCommandResults) {
+			commandResults.erase(commandResults.begin()); // the oldest one
+		}
+		commandMutex.unlock();
+	}
+
+private:
+	void pauseAcquisition() {
+		using namespace std;
+		if (daqStatus != DAQStatus::Running) {
+			return;
+		}
+		for (auto reader : boardReaders) {
+			if (!reader->hasLinkFailed()) {
+				reader->getADCBoard()->pauseAcquisition();
+			}
+		}
+		pauseStartUnixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		setDAQStatus(DAQStatus::Paused);
+		Logger::info() << "Acquisition paused.";
+	}
+
+private:
+	void resumeAcquisition() {
+		using namespace std;
+		if (daqStatus != DAQStatus::Paused) {
+			return;
+		}
+		for (auto reader : boardReaders) {
+			if (!reader->hasLinkFailed()) {
+				reader->getADCBoard()->resumeAcquisition();
+			}
+		}
+		pausedDurationInSec += CxxUtilities::Time::getUNIXTimeAsUInt32() - pauseStartUnixTime;
+		setDAQStatus(DAQStatus::Running);
+		Logger::info() << "Acquisition resumed.";
+	}
+
+private:
+	/** Changes parameters of a board. The reader of the board is suspended
+	 * while the registers are written, and the events read before the change
+	 * (including those held for time ordering) are written before the marker
+	 * row of the PARAMETERS HDU, which also records the time tag of the last
+	 * of them (see EventListFileFITS::fillParameterChange()).
+	 */
+	bool applyParameterChange(const ParameterChangeRequest& request, std::string& errorMessage) {
+		using namespace std;
+		if (request.boardIndex >= boardReaders.size()) {
+			errorMessage = "invalid board index";
+			return false;
+		}
+		BoardReader* reader = boardReaders[request.boardIndex];
+		bool succeeded = true;
+		size_t nWrites = 0;
+		reader->suspend();
+		if (reader->hasLinkFailed()) {
+			// left suspended; resumed by recoverLinks()
+			errorMessage = "link of the board is down";
+			return false;
+		}
+		flushEventMerger = true;
+		readAndThenSaveEvents();
+		flushEventMerger = false;
+		const uint64_t timeTagOfChange = latestTimeTags[request.boardIndex];
+		try {
+			nWrites = reader->getADCBoard()->applyHotParameters(request.parameters);
+		} catch (RMAPHandler::RMAPHandlerException& e) {
+			succeeded = false;
+		} catch (CxxUtilities::Exception& e) {
+			succeeded = false;
+		}
+		// a link failure is detected again (and recovered) by the reader
+		reader->resume();
+		if (!succeeded) {
+			Logger::error() << "Failed to change parameters of board " << request.boardIndex << ".";
+			errorMessage = "failed to write registers";
+			return false;
+		}
+		Logger::info() << "Parameters of board " << request.boardIndex << " changed (" << nWrites
+				<< " register(s) written).";
+		const uint8_t boardIndex = static_cast<uint8_t>(request.boardIndex);
+		const GROWTH_FY2015_ADC::HotParameters& parameters = request.parameters;
+		if (parameters.triggerThresholds.size() != 0) {
+			eventListFile->fillParameterChange(boardIndex, timeTagOfChange, "TriggerThresholds",
+					"[" + CxxUtilities::String::join(parameters.triggerThresholds, ", ") + "]");
+		}
+		if (parameters.triggerCloseThresholds.size() != 0) {
+			eventListFile->fillParameterChange(boardIndex, timeTagOfChange, "TriggerCloseThresholds",
+					"[" + CxxUtilities::String::join(parameters.triggerCloseThresholds, ", ") + "]");
+		}
+		return true;
+	}
+
+private:
+	/** Publishes a copy of the current status (see getStatusSnapshot()). Called only by this thread
+	 * (and the constructor).
+	 */
+	void publishStatusSnapshot() {
+		std::shared_ptr<StatusSnapshot> snapshot = std::make_shared<StatusSnapshot>();
+		snapshot->unixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		snapshot->daqStatus = daqStatus;
+		snapshot->boardConnected = runLoopActive;
+		snapshot->outputFileName = getOutputFileName();
+		snapshot->elapsedTime = (startUnixTime != 0) ? getElapsedTime() : 0;
+		snapshot->nEvents = nEvents;
+		snapshot->elapsedTimeOfCurrentOutputFile = getElapsedTimeOfCurrentOutputFile();
+		snapshot->nEventsOfCurrentOutputFile = nEventsOfCurrentOutputFile;
+		snapshot->burstActive = burstActive;
+		snapshot->nBursts = nBursts;
+		snapshot->linkThroughput = linkThroughput;
+		snapshot->linkRecovery = linkRecoveryStatistics;
+		snapshot->nLateEvents = nLateEvents;
+		snapshot->coincidence = coincidenceStatistics;
+		snapshot->nClockJumps = nClockJumps;
+		snapshot->clockRateRatio = clockRateRatio;
+		snapshot->gpsFixValid = gpsFixValid;
+		snapshot->gpsFix = gpsFix;
+		snapshot->nNMEASentences = nmeaParser.getNSentences();
+		snapshot->nDiscardedNMEASentences = nmeaParser.getNDiscardedSentences();
+		snapshot->nSSDTPResyncs = nSSDTPResyncs;
+		snapshot->nSSDTPDiscardedBytes = nSSDTPDiscardedBytes;
+		if (baselineEstimator != nullptr) {
+			for (size_t ch = 0; ch < baselineEstimator->getNChannels(); ch++) {
+				snapshot->baselines.push_back(baselineEstimator->getStatus(ch));
+			}
+		}
+		statusSnapshotMutex.lock();
+		statusSnapshot = snapshot;
+		statusSnapshotMutex.unlock();
+		unixTimeOfLastStatusSnapshot = snapshot->unixTime;
+	}
+
+private:
+	/** Samples NMEA sentences from the GPS Data FIFO of the first board.
+	 * The FIFO is cleared, and read in a later call after it has been filled for
+	 * GPSDataFIFOFillWaitInMillisec, so that this thread never waits for the GPS
+	 * receiver (BoardReader threads keep reading events in the meantime).
+	 * The decoded solution is written to the GPSNMEA HDU, and a valid fix
+	 * triggers an anchor of the time reconstruction from the GPS Time Register
+	 * (the FPGA time tag latched at the latest PPS).
+	 */
+	void sampleGPSDataFIFO(uint32_t currentUnixTime) {
+		using namespace std;
+		if (!gpsDataFIFOCleared) {
+			if (currentUnixTime - unixTimeOfLastGPSNMEASample >= adcBoard->GPSNMEASamplingIntervalInSec) {
+				adcBoard->clearGPSDataFIFO();
+				nmeaParser.discardPartialSentence();
+				gpsDataFIFOCleared = true;
+				timeOfGPSDataFIFOClear = std::chrono::steady_clock::now();
+			}
+			return;
+		}
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - timeOfGPSDataFIFOClear).count();
+		if (elapsed < GPSDataFIFOFillWaitInMillisec) {
+			return;
+		}
+		gpsDataFIFOCleared = false;
+		unixTimeOfLastGPSNMEASample = currentUnixTime;
+		const std::vector<uint8_t> data = adcBoard->readGPSDataFIFO();
+		size_t length = 0;
+		while (length < data.size() && data[length] != 0x00) { // unfilled part is zero
+			length++;
+		}
+		const size_t nSentences = nmeaParser.feed(data.data(), length);
+		gpsFixValid = (nSentences != 0) && nmeaParser.hasValidFix();
+		if (nSentences == 0) {
+			Logger::warning(gpsNMEARateLimit) << "No NMEA sentence received from the GPS receiver.";
+			return;
+		}
+		gpsFix = nmeaParser.getFix();
+		eventListFile->fillGPSFix(gpsFix);
+		if (gpsFixValid && timeReconstructor != nullptr) {
+			readAnsSaveGPSRegister();
+		}
+	}
+
+private:
+	/** Feeds the ADC board temperature to the baseline estimator.
+	 * Temperature is available only on Raspberry Pi (via ADCDAC).
+	 */
+	void readTemperatureForBaselineTracking() {
+		unixTimeOfLastTemperatureRead = CxxUtilities::Time::getUNIXTimeAsUInt32();
+		if (baselineEstimator == nullptr) {
+			return;
+		}
+#ifdef RASPBERRY_PI
+		if (adcdac == nullptr) {
+			adcdac = new ADCDAC(true);
+		}
+		// read the raw value so that negative temperature is not confused with error status
+		// (a failed SPI transfer returns a negative status, and the sample is skipped)
+		const int16_t adcValue = adcdac->readADC(adcBoard->BaselineTemperatureSensorChannel);
+		if (adcValue >= 0) {
+			baselineEstimator->addTemperatureSample(adcdac->convertToTemperature(adcValue));
+		} else {
+			Logger::warning(temperatureRateLimit) << "Failed to read the temperature for baseline tracking (status "
+					<< adcValue << ")";
+		}
+#endif
+	}
+
+private:
+	/** Returns the UART baud rate. If the GROWTH_DAQ_UART_BAUD_RATE environment
+	 * variable is set, its value is used. Otherwise, UARTBaudRate in the
+	 * configuration file (or the default value) is used.
+	 */
+	size_t getUARTBaudRate() {
+		const char* envPointer = std::getenv("GROWTH_DAQ_UART_BAUD_RATE");
+		if (envPointer != NULL) {
+			const size_t baudRate = atoi(envPointer);
+			if (baudRate != 0) {
+				return baudRate;
+			}
+		}
+		return GROWTH_FY2015_ADC::loadUARTBaudRate(configurationFile);
+	}
+
 private:
 	/** Sets a wait time duration in millisecond.
 	 * If the GROWTH_DAQ_WAIT_DURATION environment variable is
@@ -289,11 +1181,33 @@ private:
 		eventListFile=new EventListFileROOT(outputFileName,adcBoard->DetectorID, configurationFile);
 #else
 		outputFileName = CxxUtilities::Time::getCurrentTimeYYYYMMDD_HHMMSS() + ".fits";
+		size_t nSamples = adcBoard->getNSamplesInEventListFile();
+		if (burstActive && adcBoard->BurstSamplesInEventPacket != 0) {
+			nSamples = adcBoard->BurstSamplesInEventPacket / adcBoard->DownSamplingFactorForSavedWaveform;
+		}
 		eventListFile = new EventListFileFITS(outputFileName, adcBoard->DetectorID, configurationFile, //
-				adcBoard->getNSamplesInEventListFile(), exposureInSec, //
+				nSamples, exposureInSec, //
 				fpgaType, fpgaVersion);
+		if (burstDetector != nullptr) {
+			eventListFile->enableBurstIDColumn();
+		}
+		if (pulseShapeAnalyzer != nullptr) {
+			eventListFile->enablePulseShapeColumns();
+		}
+		if (trapezoidalFilter != nullptr) {
+			eventListFile->enableFilteredPHAColumn();
+		}
+		if (baselineEstimator != nullptr) {
+			eventListFile->enableBaselineCorrectedPHAColumn();
+		}
+		if (coincidenceBuilder != nullptr) {
+			eventListFile->enableCoincidenceColumns();
+		}
+		if (timeReconstructor != nullptr) {
+			eventListFile->enableTimeReconstructionColumns();
+		}
 #endif
-		std::cout << "Output file name: " << outputFileName << std::endl;
+		Logger::info() << "Output file name: " << outputFileName;
 	}
 
 private:
@@ -318,27 +1232,92 @@ private:
 			switchOutputFile = false;
 		}
 
-		std::vector<GROWTH_FY2015_ADC_Type::Event*> events = adcBoard->getEvent();
-		cout << "Received " << events.size() << " events" << endl;
+		// Merge events read by BoardReader threads
+		GROWTH_FY2015_ADC_Type::EventBatch& events = mergedEvents;
+		events.clear();
+		if (eventMerger != nullptr) {
+			receivedEvents.clear();
+			popEventsOfBoards(receivedEvents);
+			eventMerger->push(receivedEvents);
+			if (flushEventMerger) {
+				eventMerger->flush(events);
+			} else {
+				eventMerger->pop(events);
+			}
+		} else {
+			popEventsOfBoards(events);
+		}
+		if (coincidenceBuilder != nullptr) {
+			coincidenceBuilder->process(events, flushEventMerger);
+			coincidenceStatistics.nCoincidences = coincidenceStatisticsOfPreviousRuns.nCoincidences
+					+ coincidenceBuilder->getNCoincidences();
+			coincidenceStatistics.nVetoedEvents = coincidenceStatisticsOfPreviousRuns.nVetoedEvents
+					+ coincidenceBuilder->getNVetoedEvents();
+			coincidenceStatistics.nDroppedEvents = coincidenceStatisticsOfPreviousRuns.nDroppedEvents
+					+ coincidenceBuilder->getNDroppedEvents();
+		}
+		if (timeReconstructor != nullptr) {
+			timeReconstructor->process(events);
+			nClockJumps = nClockJumpsOfPreviousRuns + timeReconstructor->getNClockJumps();
+			clockRateRatio = timeReconstructor->getClockRateRatio();
+		}
+		if (pulseShapeAnalyzer != nullptr) {
+			pulseShapeAnalyzer->process(events);
+		}
+		if (trapezoidalFilter != nullptr) {
+			trapezoidalFilter->process(events);
+		}
+		if (baselineEstimator != nullptr) {
+			baselineEstimator->process(events);
+		}
+		BurstDetector::Transition burstTransition = BurstDetector::Transition::None;
+		if (burstDetector != nullptr) {
+			burstTransition = burstDetector->process(events);
+		}
 		eventListFile->fillEvents(events);
+		for (size_t i = 0; i < events.size(); i++) {
+			if (events.boardIndex[i] < latestTimeTags.size()) {
+				latestTimeTags[events.boardIndex[i]] = events.timeTag[i];
+			}
+		}
+		lightCurve->fill(events);
+		if (eventPublisher != nullptr) {
+			eventPublisher->publish(events);
+		}
+
+		// Record a burst in separate output file(s)
+		if (burstTransition != BurstDetector::Transition::None) {
+			const bool started = (burstTransition == BurstDetector::Transition::Started);
+			if (started) {
+				nBursts++;
+				Logger::info() << "Burst " << burstDetector->getLatestBurstID() << " started (background rate = "
+						<< burstDetector->getBackgroundRate() << " counts/s).";
+			} else {
+				Logger::info() << "Burst " << burstDetector->getLatestBurstID() << " ended.";
+			}
+			setBurstRecordingMode(started);
+			startNewOutputFile();
+		}
 
 #ifdef DRAW_CANVAS
-		cout << "Filling to histogram" << endl;
-		for (auto event : events) {
-			hist->Fill(event->phaMax);
+		Logger::debug() << "Filling to histogram";
+		for (auto phaMax : events.phaMax) {
+			hist->Fill(phaMax);
 		}
 #endif
 
 		size_t nReceivedEvents = events.size();
 		nEvents += nReceivedEvents;
+		if (eventMerger != nullptr) {
+			nLateEvents = nLateEventsOfPreviousRuns + eventMerger->getNLateEvents();
+		}
 		nEventsOfCurrentOutputFile += nReceivedEvents;
-		cout << events.size() << " events (" << nEvents << ")" << endl;
-		adcBoard->freeEvents(events);
+		Logger::info(readoutRateLimit) << "Received " << nReceivedEvents << " events (" << nEvents << " in total)";
 
 #ifdef DRAW_CANVAS
 		canvasUpdateCounter++;
 		if (canvasUpdateCounter == canvasUpdateCounterMax) {
-			cout << "Update canvas." << endl;
+			Logger::debug() << "Update canvas.";
 			canvasUpdateCounter = 0;
 			hist->Draw();
 			canvas->Update();
@@ -348,19 +1327,253 @@ private:
 		return nReceivedEvents;
 	}
 
+private:
+	/** Switches the number of waveform samples in event packets between
+	 * BurstSamplesInEventPacket (during a burst) and SamplesInEventPacket.
+	 * Events already in the EventFIFO keep the previous length.
+	 */
+	void setBurstRecordingMode(bool burstActive) {
+		using namespace std;
+		this->burstActive = burstActive;
+		if (adcBoard->BurstSamplesInEventPacket == 0) {
+			return;
+		}
+		const size_t nSamples = burstActive ? adcBoard->BurstSamplesInEventPacket : adcBoard->SamplesInEventPacket;
+		for (auto board : adcBoards) {
+			try {
+				board->setNumberOfSamplesInEventPacket(nSamples);
+				Logger::info() << "SamplesInEventPacket was set to " << nSamples << ".";
+			} catch (...) {
+				Logger::error() << "Failed to change SamplesInEventPacket to " << nSamples << ".";
+			}
+		}
+	}
+
+private:
+	/** Recovers boards whose reader stopped because an RMAP transaction failed
+	 * after retries (e.g. the UART-USB adapter glitched). Called in every pass
+	 * of the run loop, and makes at most one trial per board, so that the
+	 * other boards keep being read out, merged, and written while a board is
+	 * down. A trial reopens the link and restores the board state via
+	 * GROWTH_FY2015_ADC::recoverLink(); a failed trial is repeated after
+	 * LinkRecoveryRetryIntervalInMillisec. The output file is kept open so
+	 * that readout resumes into the same file.
+	 */
+	void recoverLinks() {
+		using namespace std;
+		const auto now = std::chrono::steady_clock::now();
+		for (auto reader : boardReaders) {
+			if (!reader->hasLinkFailed()) {
+				continue;
+			}
+			LinkRecovery& recovery = linkRecoveries[reader->getBoardIndex()];
+			if (!recovery.ongoing) {
+				recovery.ongoing = true;
+				recovery.failureTime = now;
+				recovery.nextTrialTime = now;
+				linkRecoveryStatistics.nFailures++;
+				linkRecoveryStatistics.lastFailureUnixTime = CxxUtilities::Time::getUNIXTimeAsUInt32();
+				Logger::error() << "Link failure detected on board " << reader->getBoardIndex()
+						<< "; trying to recover the link.";
+			}
+			if (now < recovery.nextTrialTime) {
+				continue;
+			}
+			linkRecoveryStatistics.nTrials++;
+			if (!reader->getADCBoard()->recoverLink()) {
+				recovery.nextTrialTime = std::chrono::steady_clock::now()
+						+ std::chrono::milliseconds(LinkRecoveryRetryIntervalInMillisec);
+				Logger::warning(linkRecoveryRateLimit) << "Link recovery of board " << reader->getBoardIndex()
+						<< " failed; retrying in " << LinkRecoveryRetryIntervalInMillisec << " ms.";
+				continue;
+			}
+			if (daqStatus == DAQStatus::Paused) {
+				// recoverLink() restarts acquisition
+				try {
+					reader->getADCBoard()->pauseAcquisition();
+				} catch (...) {
+					Logger::error() << "Failed to keep board " << reader->getBoardIndex() << " paused after link recovery.";
+				}
+			}
+			// the time tag counter restarted when the board was reprogrammed; events taken before the
+			// failure are processed with the previous time base first
+			flushEventMerger = true;
+			readAndThenSaveEvents();
+			flushEventMerger = false;
+			restartTimeTag(reader->getBoardIndex());
+			reader->resume();
+			recovery.ongoing = false;
+			const double recoveryTime = std::chrono::duration<double>(std::chrono::steady_clock::now()
+					- recovery.failureTime).count();
+			linkRecoveryStatistics.nRecoveries++;
+			linkRecoveryStatistics.lastRecoveryTimeInSec = recoveryTime;
+			linkRecoveryStatistics.totalRecoveryTimeInSec += recoveryTime;
+			if (linkRecoveryStatistics.maxRecoveryTimeInSec < recoveryTime) {
+				linkRecoveryStatistics.maxRecoveryTimeInSec = recoveryTime;
+			}
+			Logger::info() << "Link of board " << reader->getBoardIndex() << " recovered in " << recoveryTime
+					<< " s; readout resumed into " << outputFileName << ".";
+		}
+	}
+
+private:
+	/** Lets the time-based stages continue their time base when the time tag
+	 * counter of a board has been restarted. With multiple boards, the offset
+	 * of the board is latched again, and the common time base continues.
+	 */
+	void restartTimeTag(size_t boardIndex) {
+		if (boardTimeAligner != nullptr) {
+			boardTimeAligner->restart(boardIndex);
+			bool latched = false;
+			try {
+				latched = latchTimeTagOffset(boardIndex);
+			} catch (...) {
+				// access to the first board failed; its link failure is detected by the reader
+			}
+			if (!latched) {
+				Logger::warning(boardTimeRateLimit) << "Failed to latch the time tag offset of board " << boardIndex
+						<< " after link recovery; latched again at the next GPS Time Register read.";
+			}
+			unixTimeOfLastGPSRegisterRead = 0; // latch again in the next pass
+			return;
+		}
+		lightCurve->restartTimeTag(boardIndex);
+		if (eventMerger != nullptr) {
+			eventMerger->restartTimeTag(boardIndex);
+		}
+		if (timeReconstructor != nullptr) {
+			timeReconstructor->restartTimeTag(boardIndex);
+			if (boardIndex == 0) {
+				unixTimeOfLastGPSRegisterRead = 0; // take a new anchor in the next pass
+			}
+		}
+		if (burstDetector != nullptr) {
+			burstDetector->restartTimeTag(boardIndex);
+		}
+	}
+
+private:
+	void updateSSDTPErrorCounters() {
+		using namespace std;
+		uint64_t nResyncs = nSSDTPResyncsOfPreviousRuns;
+		uint64_t nDiscardedBytes = nSSDTPDiscardedBytesOfPreviousRuns;
+		for (auto board : adcBoards) {
+			nResyncs += board->getNSSDTPResyncs();
+			nDiscardedBytes += board->getNSSDTPDiscardedBytes();
+		}
+		if (nResyncs != nSSDTPResyncs) {
+			Logger::warning() << "SSDTP resynchronized " << nResyncs - nSSDTPResyncs << " time(s) (" << nResyncs
+					<< " in total)";
+		}
+		nSSDTPResyncs = nResyncs;
+		nSSDTPDiscardedBytes = nDiscardedBytes;
+	}
+
+private:
+	/** Splits a comma-separated list of device names.
+	 */
+	static std::vector<std::string> splitDeviceNames(const std::string& deviceNames) {
+		std::vector<std::string> result;
+		std::stringstream ss(deviceNames);
+		std::string name;
+		while (std::getline(ss, name, ',')) {
+			if (name != "") {
+				result.push_back(name);
+			}
+		}
+		return result;
+	}
+
+private:
+	size_t getNChannelsOfAllBoards() const {
+		return adcBoards.size() * SpaceFibreADC::NumberOfChannels;
+	}
+
 private:
 	static const uint32_t DefaultEventReadWaitDurationInMillisec = 50;
 	uint32_t eventReadWaitDuration = DefaultEventReadWaitDurationInMillisec;
 	static const size_t GPSRegisterReadWaitInSec = 30; //30s
 	uint32_t unixTimeOfLastGPSRegisterRead = 0;
+	static const int64_t GPSDataFIFOFillWaitInMillisec = 1500;
+	static const size_t MaximumNCommandResults = 64;
+	std::vector<std::pair<uint64_t, ControlCommand>> commandQueue; // (sequence, command)
+	std::map<uint64_t, CommandResult> commandResults; // indexed by sequence
+	uint64_t nSubmittedCommands = 0;
+	CxxUtilities::Mutex commandMutex;
+	std::shared_ptr<const StatusSnapshot> statusSnapshot;
+	mutable CxxUtilities::Mutex statusSnapshotMutex;
+	uint32_t unixTimeOfLastStatusSnapshot = 0;
+	uint32_t unixTimeOfLastGPSNMEASample = 0;
+	bool gpsDataFIFOCleared = false;
+	std::chrono::steady_clock::time_point timeOfGPSDataFIFOClear;
+	NMEAParser nmeaParser;
+	NMEAParser::Fix gpsFix { };
+	bool gpsFixValid = false;
+	static const size_t TemperatureReadWaitInSec = 60;
+	static const uint32_t LinkRecoveryRetryIntervalInMillisec = 1000;
+	/** State of the recovery of a board whose link failed (see recoverLinks()).
+	 */
+	struct LinkRecovery {
+		bool ongoing;
+		std::chrono::steady_clock::time_point failureTime;
+		std::chrono::steady_clock::time_point nextTrialTime;
+	};
+	std::vector<LinkRecovery> linkRecoveries; // per board
+	std::vector<uint64_t> latestTimeTags; // per board; time tag of the last event written (see applyParameterChange())
+	static constexpr double ReadoutLogIntervalInSec = 10.0;
+	static constexpr double RepeatedWarningIntervalInSec = 60.0;
+	static constexpr double MinimumCoincidenceHoldTimeInSec = 0.1;
+	uint32_t unixTimeOfLastTemperatureRead = 0;
 
 private:
-	GROWTH_FY2015_ADC* adcBoard;
+	GROWTH_FY2015_ADC* adcBoard = nullptr; // the first board
+	std::vector<GROWTH_FY2015_ADC*> adcBoards;
+	std::vector<BoardReader*> boardReaders;
+	GROWTH_FY2015_ADC_Type::EventBatch receivedEvents;
+	GROWTH_FY2015_ADC_Type::EventBatch mergedEvents;
+	TimeOrderedEventMerger* eventMerger = nullptr;
+	bool flushEventMerger = false;
+	uint64_t nLateEvents = 0;
+	uint64_t nLateEventsOfPreviousRuns = 0;
+	CoincidenceBuilder* coincidenceBuilder = nullptr;
+	TimeReconstructor* timeReconstructor = nullptr;
+	BoardTimeAligner* boardTimeAligner = nullptr; // multiple boards on a common time base
+	size_t nClockJumps = 0;
+	size_t nClockJumpsOfPreviousRuns = 0;
+	double clockRateRatio = 1.0;
+	CoincidenceStatistics coincidenceStatistics { };
+	CoincidenceStatistics coincidenceStatisticsOfPreviousRuns { };
 	CxxUtilities::Condition c;
 	uint32_t fpgaType;
 	uint32_t fpgaVersion;
 	size_t nEvents = 0;
 	size_t nEventsOfCurrentOutputFile = 0;
+	LightCurve* lightCurve = nullptr;
+	BurstDetector* burstDetector = nullptr;
+	PulseShapeAnalyzer* pulseShapeAnalyzer = nullptr;
+	TrapezoidalFilter* trapezoidalFilter = nullptr;
+	BaselineEstimator* baselineEstimator = nullptr;
+	EventPublisher* eventPublisher = nullptr;
+
+private:
+	// messages repeated in the main loop
+	Logger::RateLimit readoutRateLimit { ReadoutLogIntervalInSec };
+	Logger::RateLimit gpsTimeRateLimit { RepeatedWarningIntervalInSec };
+	Logger::RateLimit gpsNMEARateLimit { RepeatedWarningIntervalInSec };
+	Logger::RateLimit linkRecoveryRateLimit { RepeatedWarningIntervalInSec };
+	Logger::RateLimit temperatureRateLimit { RepeatedWarningIntervalInSec };
+	Logger::RateLimit boardTimeRateLimit { RepeatedWarningIntervalInSec };
+#ifdef RASPBERRY_PI
+	ADCDAC* adcdac = nullptr;
+#endif
+	bool burstActive = false;
+	size_t nBursts = 0;
+	GROWTH_FY2015_ADC::LinkThroughput linkThroughput { };
+	LinkRecoveryStatistics linkRecoveryStatistics { };
+	uint64_t nSSDTPResyncs = 0;
+	uint64_t nSSDTPDiscardedBytes = 0;
+	uint64_t nSSDTPResyncsOfPreviousRuns = 0;
+	uint64_t nSSDTPDiscardedBytesOfPreviousRuns = 0;
 #ifdef DRAW_CANVAS
 	TCanvas* canvas;
 	TH1D* hist;
@@ -374,7 +1587,10 @@ private:
 #endif
 
 private:
-	uint32_t startUnixTime;
+	uint32_t startUnixTime = 0;
+	uint32_t pauseStartUnixTime = 0;
+	uint32_t pausedDurationInSec = 0;
+	bool runLoopActive = false;
 	uint32_t startUnixTimeOfCurrentOutputFile;
 	std::string outputFileName;bool switchOutputFile;
 	DAQStatus daqStatus;
@@ -1,6 +1,8 @@
 #ifndef SRC_MESSAGESERVER_HH_
 #define SRC_MESSAGESERVER_HH_
 
+#include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
 #include "CxxUtilities/CxxUtilities.hh"
@@ -15,33 +17,43 @@
 #include "picojson.h"
 
 #include "MainThread.hh"
-
-#define DEBUG_MESSAGESERVER
-
-#ifdef DEBUG_MESSAGESERVER
-using namespace std;
-#endif
+#include "BinaryMessage.hh"
+#include "Logger.hh"
+#include "GROWTH_FY2015_ADCModules/Debug.hh"
 
 /** Receives message from a client, and process the message.
  * Typical messages include:
  * <ul>
  *   <li> {"command": "stop"}  => stop the target thread </li>
+ *   <li> {"command": "getLightCurve", "lastNMinutes": 10}  => returns count-rate light curve </li>
+ *   <li> {"command": "setParameters", "board": 0, "parameters": {"TriggerThresholds": [600, 600, 600, 600]}}
+ *        => changes thresholds during acquisition </li>
  * </ul>
+ * The same commands are accepted in the binary encoding defined in
+ * BinaryMessage (replied in the same encoding). Commands are dispatched via
+ * a table of (name, binary command ID, handlers); see getCommandTable().
+ *
+ * The server uses a ROUTER socket, so that multiple REQ clients (controller,
+ * display, telemetry) are served concurrently. This thread never waits for
+ * MainThread: commands which change acquisition are queued with
+ * MainThread::submitCommand(), and a command whose result is needed
+ * (setParameters) is replied when MainThread has executed it. Status queries
+ * are answered from MainThread::getStatusSnapshot().
  */
 class MessageServer: public CxxUtilities::StoppableThread {
 public:
 	/** @param[in] mainThread a pointer of Thread instance which will be controlled by this thread
 	 */
 	MessageServer(MainThread* mainThread) : //
-			context(1), socket(context, ZMQ_REP), mainThread(mainThread) {
+			context(1), socket(context, ZMQ_ROUTER), mainThread(mainThread) {
 		std::stringstream ss;
 		ss << "tcp://*:" << TCPPortNumber;
-		int timeout = TimeOutInMilisecond;
-		socket.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
 		socket.bind(ss.str().c_str());
-		// Show message
-		using namespace std;
-		cout << "MessageServer has started to accept IPC commands." << endl;
+		for (auto& command : getCommandTable()) {
+			commandsByName[command.name] = &command;
+			commandsByID[command.id] = &command;
+		}
+		Logger::info() << "MessageServer has started to accept IPC commands.";
 	}
 
 public:
@@ -50,190 +62,652 @@ public:
 
 public:
 	void run() {
-		using namespace std;
 		while (!stopped) {
-			zmq::message_t request;
-			//  Wait for next request from client
-			if (socket.recv(&request)) {
-#ifdef DEBUG_MESSAGESERVER
-				std::cout << "MessageServer: Received " << std::endl;
-#endif
+			zmq::pollitem_t items[] = { { static_cast<void*>(socket), 0, ZMQ_POLLIN, 0 } };
+			zmq::poll(items, 1, PollTimeOutInMillisecond);
+			if ((items[0].revents & ZMQ_POLLIN) != 0) {
+				receiveAndProcessRequest();
+			}
+			sendCompletedReplies();
+		}
+	}
+
+private:
+	/** Receives a request (routing envelope + payload), processes it, and replies unless the reply is deferred.
+	 */
+	void receiveAndProcessRequest() {
+		// the envelope consists of the routing identity and the empty delimiter added by the REQ socket
+		std::vector<std::string> envelope;
+		zmq::message_t request;
+		while (true) {
+			if (!socket.recv(&request)) {
+				return;
+			}
+			int more = 0;
+			size_t moreSize = sizeof(more);
+			socket.getsockopt(ZMQ_RCVMORE, &more, &moreSize);
+			if (more == 0) {
+				break; // the last frame is the payload
+			}
+			envelope.push_back(std::string(static_cast<char*>(request.data()), request.size()));
+		}
+
+		replyDeferred = false;
+		const uint8_t* requestData = static_cast<const uint8_t*>(request.data());
+		if (request.size() != 0 && requestData[0] == BinaryMessage::Magic) {
+			// Process and reply in the binary encoding
+			replyBuffer.clear();
+			const uint8_t commandID = processBinaryMessage(requestData, request.size(), replyBuffer);
+			if (replyDeferred) {
+				deferReply(envelope, true, commandID);
 			} else {
-				if (errno != EAGAIN) {
-					cerr << "Error: MessageServer::run(): receive failed." << endl;
-					::exit(-1);
-				} else {
-#ifdef DEBUG_MESSAGESERVER
-					cout << "MessageServer::run(): timed out. continue." << endl;
-#endif
+				sendReply(envelope, replyBuffer.data(), replyBuffer.size());
+			}
+			return;
+		}
+		if (Debug::messageserver()) {
+			Logger::debug() << "MessageServer::run(): received message "
+					<< std::string(static_cast<char*>(request.data()), request.size());
+		}
+
+		// Process received message
+		picojson::object replyJSON = processMessage(static_cast<const char*>(request.data()), request.size());
+		if (replyDeferred) {
+			deferReply(envelope, false, 0);
+			return;
+		}
+
+		// Reply
+		std::string replyMessageString = picojson::value(replyJSON).serialize();
+		sendReply(envelope, replyMessageString.c_str(), replyMessageString.size());
+	}
+
+private:
+	void sendReply(const std::vector<std::string>& envelope, const void* data, size_t size) {
+		try {
+			for (auto& frame : envelope) {
+				socket.send(frame.c_str(), frame.size(), ZMQ_SNDMORE);
+			}
+			socket.send(data, size);
+		} catch (zmq::error_t& e) {
+			// the client has gone away
+		}
+	}
+
+private:
+	/** Replies to requests whose commands have been executed (or timed out) by MainThread.
+	 */
+	void sendCompletedReplies() {
+		const auto now = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < pendingReplies.size();) {
+			const PendingReply& pending = pendingReplies[i];
+			MainThread::CommandResult result;
+			if (!mainThread->takeCommandResult(pending.sequence, result)) {
+				if (now < pending.deadline) {
+					i++;
 					continue;
 				}
+				result = MainThread::CommandResult { false, "command is scheduled but has not been executed yet" };
+			}
+			if (pending.binary) {
+				replyBuffer.clear();
+				BinaryMessage::Writer reply(replyBuffer);
+				writeBinaryReplyHeader(reply, pending.commandID,
+						result.succeeded ? BinaryMessage::OK : BinaryMessage::Error);
+				if (!result.succeeded) {
+					reply.putString(result.errorMessage);
+				}
+				sendReply(pending.envelope, replyBuffer.data(), replyBuffer.size());
+			} else {
+				picojson::object replyMessage =
+						result.succeeded ? createOKMessage() : createErrorMessage(result.errorMessage);
+				const std::string replyMessageString = picojson::value(replyMessage).serialize();
+				sendReply(pending.envelope, replyMessageString.c_str(), replyMessageString.size());
 			}
+			pendingReplies.erase(pendingReplies.begin() + i);
+		}
+	}
+
+private:
+	/** Called by a handler to reply when MainThread has executed the command (see sendCompletedReplies()).
+	 */
+	void setReplyDeferred(uint64_t sequence) {
+		replyDeferred = true;
+		deferredSequence = sequence;
+	}
 
-			// Construct a string from received data
-			std::string messagePayload;
-			messagePayload.assign(static_cast<char*>(request.data()), request.size());
-#ifdef DEBUG_MESSAGESERVER
-			cout << "MessageServer::run(): received message" << endl;
-			cout << messagePayload << endl;
-			cout << endl;
-#endif
+private:
+	void deferReply(const std::vector<std::string>& envelope, bool binary, uint8_t commandID) {
+		pendingReplies.push_back(PendingReply { envelope, deferredSequence, binary, commandID,
+				std::chrono::steady_clock::now() + std::chrono::milliseconds(CommandTimeOutInMillisecond) });
+	}
 
-			// Process received message
-			picojson::object replyJSON = processMessage(messagePayload);
+private:
+	typedef picojson::object (MessageServer::*JSONHandler)(const picojson::object& message);
+	typedef BinaryMessage::Status (MessageServer::*BinaryHandler)(BinaryMessage::Reader& arguments,
+			BinaryMessage::Writer& reply, std::string& errorMessage);
 
-			// Reply
-			std::string replyMessageString = picojson::value(replyJSON).serialize();
-			socket.send(replyMessageString.c_str(), replyMessageString.size());
-		}
+private:
+	struct Command {
+		const char* name; // value of "command" in JSON messages
+		BinaryMessage::CommandID id;
+		JSONHandler jsonHandler;
+		BinaryHandler binaryHandler;
+	};
+
+private:
+	/** Returns the table of supported commands. A new command is added here.
+	 */
+	static const std::vector<Command>& getCommandTable() {
+		static const std::vector<Command> commands { //
+				{ "ping", BinaryMessage::Ping, &MessageServer::processPingCommand, //
+						&MessageServer::processPingCommandBinary }, //
+				{ "stop", BinaryMessage::Stop, &MessageServer::processStopCommand, //
+						&MessageServer::processStopCommandBinary }, //
+				{ "pause", BinaryMessage::Pause, &MessageServer::processPauseCommand, //
+						&MessageServer::processPauseCommandBinary }, //
+				{ "resume", BinaryMessage::Resume, &MessageServer::processResumeCommand, //
+						&MessageServer::processResumeCommandBinary }, //
+				{ "getStatus", BinaryMessage::GetStatus, &MessageServer::processGetStatusCommand, //
+						&MessageServer::processGetStatusCommandBinary }, //
+				{ "startNewOutputFile", BinaryMessage::StartNewOutputFile,
+						&MessageServer::processStartNewOutputFileCommand,
+						&MessageServer::processStartNewOutputFileCommandBinary }, //
+				{ "getLightCurve", BinaryMessage::GetLightCurve, &MessageServer::processGetLightCurveCommand,
+						&MessageServer::processGetLightCurveCommandBinary }, //
+				{ "setParameters", BinaryMessage::SetParameters, &MessageServer::processSetParametersCommand,
+						&MessageServer::processSetParametersCommandBinary } };
+		return commands;
 	}
 
 private:
-	picojson::object processMessage(const std::string& messagePayload) {
-		using namespace std;
+	picojson::object processMessage(const char* messagePayload, size_t size) {
 		picojson::value v;
-		picojson::parse(v, messagePayload);
-		if (v.is<picojson::object>()) {
-#ifdef DEBUG_MESSAGESERVER
-			cout << "MessageServer::processMessage(): received object is: {" << endl;
-#endif
-			for (auto& it : v.get<picojson::object>()) {
-#ifdef DEBUG_MESSAGESERVER
-				cout << it.first << ": " << it.second.to_str() << endl;
-#endif
-				if (it.first == "command") {
-					if (it.second.to_str() == "ping") {
-						return processPingCommand();
-					} else if (it.second.to_str() == "stop") {
-						return processStopCommand();
-					} else if (it.second.to_str() == "pause") {
-						return processPauseCommand();
-					} else if (it.second.to_str() == "resume") {
-						return processResumeCommand();
-					} else if (it.second.to_str() == "getStatus") {
-						return processGetStatusCommand();
-					} else if (it.second.to_str() == "startNewOutputFile") {
-						return processStartNewOutputFileCommand();
+		std::string parseError;
+		picojson::parse(v, messagePayload, messagePayload + size, &parseError);
+		if (parseError.empty() && v.is<picojson::object>()) {
+			const picojson::object& message = v.get<picojson::object>();
+			auto commandEntry = message.find("command");
+			if (commandEntry != message.end() && commandEntry->second.is<std::string>()) {
+				auto command = commandsByName.find(commandEntry->second.get<std::string>());
+				if (command != commandsByName.end()) {
+					if (Debug::messageserver()) {
+						Logger::debug() << "MessageServer::processMessage(): " << command->first << " command received.";
 					}
+					return (this->*(command->second->jsonHandler))(message);
 				}
 			}
-#ifdef DEBUG_MESSAGESERVER
-			cout << "}";
-#endif
 		}
 		// Return error message if the received command is invalid
-		picojson::object errorMessage;
-		errorMessage["status"] = picojson::value("error");
-		errorMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
-		errorMessage["message"] = picojson::value("invalid command");
-		return errorMessage;
+		return createErrorMessage("invalid command");
+	}
+
+private:
+	/** Decodes a binary request, and writes a binary reply to the buffer.
+	 * @return command ID of the request
+	 */
+	uint8_t processBinaryMessage(const uint8_t* data, size_t size, std::vector<uint8_t>& replyBuffer) {
+		BinaryMessage::Reader arguments(data, size);
+		arguments.getUInt8(); // Magic
+		const uint8_t schemaVersion = arguments.getUInt8();
+		const uint8_t commandID = arguments.getUInt8();
+		arguments.getUInt8(); // reserved
+		BinaryMessage::Writer reply(replyBuffer);
+		writeBinaryReplyHeader(reply, commandID, BinaryMessage::OK); // status is overwritten below
+		BinaryMessage::Status status;
+		std::string errorMessage;
+		if (!arguments.isValid()) {
+			status = BinaryMessage::InvalidMessage;
+		} else if (schemaVersion > BinaryMessage::SchemaVersion) {
+			status = BinaryMessage::UnsupportedSchemaVersion;
+		} else if (commandsByID[commandID] == nullptr) {
+			status = BinaryMessage::UnknownCommand;
+		} else {
+			if (Debug::messageserver()) {
+				Logger::debug() << "MessageServer::processBinaryMessage(): " << commandsByID[commandID]->name
+						<< " command received.";
+			}
+			status = (this->*(commandsByID[commandID]->binaryHandler))(arguments, reply, errorMessage);
+			if (status == BinaryMessage::OK && !arguments.isValid()) {
+				status = BinaryMessage::InvalidMessage;
+			}
+		}
+		replyBuffer[3] = status;
+		if (status != BinaryMessage::OK) {
+			reply.truncate(BinaryMessage::ReplyHeaderSize);
+			reply.putString(errorMessage);
+		}
+		return commandID;
+	}
+
+private:
+	void writeBinaryReplyHeader(BinaryMessage::Writer& reply, uint8_t commandID, BinaryMessage::Status status) {
+		reply.putUInt8(BinaryMessage::Magic);
+		reply.putUInt8(BinaryMessage::SchemaVersion);
+		reply.putUInt8(commandID);
+		reply.putUInt8(status);
+		reply.putUInt32(CxxUtilities::Time::getUNIXTimeAsUInt32());
 	}
 
 public:
 	static const uint16_t TCPPortNumber = 10020;
-	static const int TimeOutInMilisecond = 1000; // 1 sec
+	static const long PollTimeOutInMillisecond = 20; // also the latency of deferred replies
 
 private:
-	picojson::object processPingCommand() {
-#ifdef DEBUG_MESSAGESERVER
-		cout << "MessageServer::processMessage(): ping command received." << endl;
-#endif
+	picojson::object processPingCommand(const picojson::object& message) {
+		return createOKMessage();
+	}
+
+private:
+	picojson::object processStopCommand(const picojson::object& message) {
+		stopMainThreadAndSelf();
+		return createOKMessage();
+	}
+
+	picojson::object processPauseCommand(const picojson::object& message) {
+		pauseMainThread();
+		return createOKMessage();
+	}
+
+	picojson::object processResumeCommand(const picojson::object& message) {
+		resumeMainThread();
+		return createOKMessage();
+	}
+
+private:
+	picojson::object processGetStatusCommand(const picojson::object& message) {
+		const std::shared_ptr<const MainThread::StatusSnapshot> snapshot = mainThread->getStatusSnapshot();
 		// Construct reply message
-		picojson::object replyMessage;
-		replyMessage["status"] = picojson::value("ok");
-		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
+		picojson::object replyMessage = createOKMessage();
+		replyMessage["statusUnixTime"] = picojson::value(static_cast<double>(snapshot->unixTime));
+		if (snapshot->daqStatus == DAQStatus::Running) {
+			replyMessage["daqStatus"] = picojson::value("Running");
+		} else {
+			replyMessage["daqStatus"] = picojson::value("Paused");
+		}
+		replyMessage["boardConnected"] = picojson::value(snapshot->boardConnected);
+		replyMessage["outputFileName"] = picojson::value(snapshot->outputFileName);
+		replyMessage["elapsedTime"] = picojson::value(static_cast<double>(snapshot->elapsedTime));
+		replyMessage["nEvents"] = picojson::value(static_cast<double>(snapshot->nEvents));
+		replyMessage["elapsedTimeOfCurrentOutputFile"] = //
+				picojson::value(static_cast<double>(snapshot->elapsedTimeOfCurrentOutputFile));
+		replyMessage["nEventsOfCurrentOutputFile"] = //
+				picojson::value(static_cast<double>(snapshot->nEventsOfCurrentOutputFile));
+		replyMessage["burstActive"] = picojson::value(snapshot->burstActive);
+		replyMessage["nBursts"] = picojson::value(static_cast<double>(snapshot->nBursts));
+		const GROWTH_FY2015_ADC::LinkThroughput& linkThroughput = snapshot->linkThroughput;
+		if (linkThroughput.nTransactions != 0) {
+			picojson::object link;
+			link["baudRate"] = picojson::value(static_cast<double>(linkThroughput.baudRate));
+			link["transactionsPerSec"] = picojson::value(linkThroughput.transactionsPerSec);
+			link["meanLatencyInMillisec"] = picojson::value(linkThroughput.meanLatencyInMillisec);
+			link["payloadBytesPerSec"] = picojson::value(linkThroughput.payloadBytesPerSec);
+			link["wireBytesPerSec"] = picojson::value(linkThroughput.wireBytesPerSec);
+			replyMessage["linkThroughput"] = picojson::value(link);
+		}
+		{
+			const MainThread::LinkRecoveryStatistics& linkRecovery = snapshot->linkRecovery;
+			picojson::object recovery;
+			recovery["nFailures"] = picojson::value(static_cast<double>(linkRecovery.nFailures));
+			recovery["nRecoveries"] = picojson::value(static_cast<double>(linkRecovery.nRecoveries));
+			recovery["nTrials"] = picojson::value(static_cast<double>(linkRecovery.nTrials));
+			recovery["lastRecoveryTimeInSec"] = picojson::value(linkRecovery.lastRecoveryTimeInSec);
+			recovery["maxRecoveryTimeInSec"] = picojson::value(linkRecovery.maxRecoveryTimeInSec);
+			recovery["totalRecoveryTimeInSec"] = picojson::value(linkRecovery.totalRecoveryTimeInSec);
+			recovery["lastFailureUnixTime"] = picojson::value(static_cast<double>(linkRecovery.lastFailureUnixTime));
+			replyMessage["linkRecovery"] = picojson::value(recovery);
+		}
+		replyMessage["nLateEvents"] = picojson::value(static_cast<double>(snapshot->nLateEvents));
+		{
+			const MainThread::CoincidenceStatistics& coincidence = snapshot->coincidence;
+			picojson::object coincidenceObject;
+			coincidenceObject["nCoincidences"] = picojson::value(static_cast<double>(coincidence.nCoincidences));
+			coincidenceObject["nVetoedEvents"] = picojson::value(static_cast<double>(coincidence.nVetoedEvents));
+			coincidenceObject["nDroppedEvents"] = picojson::value(static_cast<double>(coincidence.nDroppedEvents));
+			replyMessage["coincidence"] = picojson::value(coincidenceObject);
+		}
+		replyMessage["nClockJumps"] = picojson::value(static_cast<double>(snapshot->nClockJumps));
+		replyMessage["clockRateRatio"] = picojson::value(snapshot->clockRateRatio);
+		{
+			const NMEAParser::Fix& fix = snapshot->gpsFix;
+			picojson::object gps;
+			gps["fixValid"] = picojson::value(snapshot->gpsFixValid);
+			gps["fixQuality"] = picojson::value(static_cast<double>(fix.fixQuality));
+			gps["nSatellites"] = picojson::value(static_cast<double>(fix.nSatellites));
+			gps["latitude"] = picojson::value(fix.latitude);
+			gps["longitude"] = picojson::value(fix.longitude);
+			gps["altitude"] = picojson::value(fix.altitude);
+			gps["utcTime"] = picojson::value(fix.utcTime);
+			gps["nNMEASentences"] = picojson::value(static_cast<double>(snapshot->nNMEASentences));
+			gps["nDiscardedNMEASentences"] = picojson::value(static_cast<double>(snapshot->nDiscardedNMEASentences));
+			replyMessage["gps"] = picojson::value(gps);
+		}
+		replyMessage["ssdtpNResyncs"] = picojson::value(static_cast<double>(snapshot->nSSDTPResyncs));
+		replyMessage["ssdtpNDiscardedBytes"] = picojson::value(static_cast<double>(snapshot->nSSDTPDiscardedBytes));
+		if (snapshot->baselines.size() != 0) {
+			picojson::array baselines;
+			for (size_t ch = 0; ch < snapshot->baselines.size(); ch++) {
+				const BaselineEstimator::Status& status = snapshot->baselines[ch];
+				picojson::object baseline;
+				baseline["board"] = picojson::value(static_cast<double>(ch / SpaceFibreADC::NumberOfChannels));
+				baseline["ch"] = picojson::value(static_cast<double>(ch % SpaceFibreADC::NumberOfChannels));
+				baseline["valid"] = picojson::value(status.valid);
+				baseline["baseline"] = picojson::value(status.baseline);
+				baseline["referenceBaseline"] = picojson::value(status.referenceBaseline);
+				baseline["drift"] = picojson::value(status.drift);
+				baseline["temperature"] = picojson::value(status.temperature);
+				baseline["driftPerDegC"] = picojson::value(status.driftPerDegC);
+				baselines.push_back(picojson::value(baseline));
+			}
+			replyMessage["baseline"] = picojson::value(baselines);
+		}
 		return replyMessage;
 	}
 
 private:
-	picojson::object processStopCommand() {
-#ifdef DEBUG_MESSAGESERVER
-		cout << "MessageServer::processMessage(): stop command received." << endl;
-#endif
-		// Stop target thread and self
-		if (mainThread != nullptr) {
-			mainThread->stop();
+	picojson::object processStartNewOutputFileCommand(const picojson::object& message) {
+		// Switch output file to a new one
+		mainThread->startNewOutputFile();
+		return createOKMessage();
+	}
+
+private:
+	/** Returns the light curve of the last N minutes.
+	 * Optional parameter "lastNMinutes" specifies the duration (default DefaultLightCurveDurationInMinutes).
+	 * "counts" is an array indexed as counts[channel][band][bin] (channel = boardIndex * 4 + ch).
+	 */
+	picojson::object processGetLightCurveCommand(const picojson::object& message) {
+		double lastNMinutes = DefaultLightCurveDurationInMinutes;
+		auto lastNMinutesEntry = message.find("lastNMinutes");
+		if (lastNMinutesEntry != message.end() && lastNMinutesEntry->second.is<double>()) {
+			lastNMinutes = lastNMinutesEntry->second.get<double>();
 		}
-		this->stop();
+		if (!std::isfinite(lastNMinutes) || lastNMinutes <= 0) {
+			return createErrorMessage("lastNMinutes should be a positive number");
+		}
+
+		LightCurve* lightCurve = mainThread->getLightCurve();
+		if (lightCurve == nullptr) {
+			picojson::object errorMessage;
+			errorMessage["status"] = picojson::value("error");
+			errorMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
+			errorMessage["message"] = picojson::value("light curve not available");
+			return errorMessage;
+		}
+		const LightCurve::Data data = lightCurve->getLightCurve(lastNMinutes * 60);
+
+		picojson::array energyBands;
+		for (size_t band = 0; band < data.nBands; band++) {
+			picojson::array bandBoundary;
+			bandBoundary.push_back(picojson::value(static_cast<double>(data.energyBandBoundaries[band])));
+			bandBoundary.push_back(picojson::value(static_cast<double>(data.energyBandBoundaries[band + 1])));
+			energyBands.push_back(picojson::value(bandBoundary));
+		}
+		picojson::array countsOfAllChannels;
+		for (size_t ch = 0; ch < data.nChannels; ch++) {
+			picojson::array countsOfChannel;
+			for (size_t band = 0; band < data.nBands; band++) {
+				picojson::array countsOfBand;
+				for (size_t bin = 0; bin < data.nBins; bin++) {
+					countsOfBand.push_back(
+							picojson::value(static_cast<double>(data.counts[(ch * data.nBands + band) * data.nBins + bin])));
+				}
+				countsOfChannel.push_back(picojson::value(countsOfBand));
+			}
+			countsOfAllChannels.push_back(picojson::value(countsOfChannel));
+		}
+
 		// Construct reply message
 		picojson::object replyMessage;
 		replyMessage["status"] = picojson::value("ok");
 		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
+		replyMessage["binWidthInSec"] = picojson::value(data.binWidthInSec);
+		replyMessage["startTimeInSec"] = picojson::value(data.startTimeInSec);
+		replyMessage["nBins"] = picojson::value(static_cast<double>(data.nBins));
+		replyMessage["energyBands"] = picojson::value(energyBands);
+		replyMessage["counts"] = picojson::value(countsOfAllChannels);
 		return replyMessage;
 	}
 
-	picojson::object processPauseCommand() {
-#ifdef DEBUG_MESSAGESERVER
-		cout << "MessageServer::processMessage(): pause command received." << endl;
-#endif
+private:
+	/** Changes parameters during acquisition without reopening the board or the output file.
+	 * "parameters" is a partial configuration; only TriggerThresholds and
+	 * TriggerCloseThresholds (arrays with one value per channel) are accepted.
+	 * Optional "board" selects the board (default 0). The whole request is
+	 * validated before anything is applied.
+	 */
+	picojson::object processSetParametersCommand(const picojson::object& message) {
+		MainThread::ControlCommand command { MainThread::ControlCommand::Type::SetParameters, { } };
+		MainThread::ParameterChangeRequest& request = command.parameterChange;
+		auto boardEntry = message.find("board");
+		if (boardEntry != message.end()) {
+			if (!boardEntry->second.is<double>() || boardEntry->second.get<double>() < 0) {
+				return createErrorMessage("board should be a non-negative number");
+			}
+			request.boardIndex = static_cast<size_t>(boardEntry->second.get<double>());
+		}
+		auto parametersEntry = message.find("parameters");
+		if (parametersEntry == message.end() || !parametersEntry->second.is<picojson::object>()) {
+			return createErrorMessage("parameters should be an object");
+		}
+		for (auto& parameter : parametersEntry->second.get<picojson::object>()) {
+			std::vector<uint16_t>* values = nullptr;
+			if (parameter.first == "TriggerThresholds") {
+				values = &request.parameters.triggerThresholds;
+			} else if (parameter.first == "TriggerCloseThresholds") {
+				values = &request.parameters.triggerCloseThresholds;
+			} else {
+				return createErrorMessage(parameter.first + " cannot be changed during acquisition");
+			}
+			if (!parameter.second.is<picojson::array>()
+					|| parameter.second.get<picojson::array>().size() != SpaceFibreADC::NumberOfChannels) {
+				return createErrorMessage(parameter.first + " should be an array of one value per channel");
+			}
+			for (auto& value : parameter.second.get<picojson::array>()) {
+				if (!value.is<double>() || value.get<double>() < 0 || value.get<double>() > UINT16_MAX
+						|| value.get<double>() != static_cast<uint16_t>(value.get<double>())) {
+					return createErrorMessage(parameter.first + " should contain integers from 0 to 65535");
+				}
+				values->push_back(static_cast<uint16_t>(value.get<double>()));
+			}
+		}
+		// replied when MainThread has written the registers
+		setReplyDeferred(mainThread->submitCommand(command));
+		return picojson::object();
+	}
+
+private:
+	void stopMainThreadAndSelf() {
 		// Stop target thread and self
 		if (mainThread != nullptr) {
-			mainThread->stop();
+			mainThread->submitCommand(MainThread::ControlCommand { MainThread::ControlCommand::Type::Stop, { } });
 		}
-		// Construct reply message
-		picojson::object replyMessage;
-		replyMessage["status"] = picojson::value("ok");
-		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
-		return replyMessage;
+		this->stop();
 	}
 
-	picojson::object processResumeCommand() {
-#ifdef DEBUG_MESSAGESERVER
-		cout << "MessageServer::processMessage(): resume command received." << endl;
-#endif
-		// Stop target thread and self
+private:
+	void pauseMainThread() {
+		// Pause acquisition (the board connection and the output file are kept)
 		if (mainThread != nullptr) {
-			if (mainThread->getDAQStatus() == DAQStatus::Paused) {
-				mainThread->start();
-			}
+			mainThread->submitCommand(MainThread::ControlCommand { MainThread::ControlCommand::Type::Pause, { } });
 		}
-		// Construct reply message
-		picojson::object replyMessage;
-		replyMessage["status"] = picojson::value("ok");
-		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
-		return replyMessage;
 	}
 
 private:
-	picojson::object processGetStatusCommand() {
-#ifdef DEBUG_MESSAGESERVER
-		cout << "MessageServer::processMessage(): getStatus command received." << endl;
-#endif
-		// Construct reply message
-		picojson::object replyMessage;
-		replyMessage["status"] = picojson::value("ok");
-		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
-		if(mainThread->getDAQStatus()==DAQStatus::Running){
-			replyMessage["daqStatus"] = picojson::value("Running");
-		}else{
-			replyMessage["daqStatus"] = picojson::value("Paused");
+	void resumeMainThread() {
+		// Resume acquisition (a new observation run is started if not connected)
+		if (mainThread != nullptr) {
+			mainThread->submitCommand(MainThread::ControlCommand { MainThread::ControlCommand::Type::Resume, { } });
 		}
-		replyMessage["outputFileName"] = picojson::value(mainThread->getOutputFileName());
-		replyMessage["elapsedTime"] = picojson::value(static_cast<double>(mainThread->getElapsedTime()));
-		replyMessage["nEvents"] = picojson::value(static_cast<double>(mainThread->getNEvents()));
-		replyMessage["elapsedTimeOfCurrentOutputFile"] = //
-				picojson::value(static_cast<double>(mainThread->getElapsedTimeOfCurrentOutputFile()));
-		replyMessage["nEventsOfCurrentOutputFile"] = //
-				picojson::value(static_cast<double>(mainThread->getNEventsOfCurrentOutputFile()));
-		return replyMessage;
 	}
 
 private:
-	picojson::object processStartNewOutputFileCommand() {
-		// Switch output file to a new one
+	BinaryMessage::Status processPingCommandBinary(BinaryMessage::Reader& arguments, BinaryMessage::Writer& reply,
+			std::string& errorMessage) {
+		return BinaryMessage::OK;
+	}
+
+private:
+	BinaryMessage::Status processStopCommandBinary(BinaryMessage::Reader& arguments, BinaryMessage::Writer& reply,
+			std::string& errorMessage) {
+		stopMainThreadAndSelf();
+		return BinaryMessage::OK;
+	}
+
+private:
+	BinaryMessage::Status processPauseCommandBinary(BinaryMessage::Reader& arguments, BinaryMessage::Writer& reply,
+			std::string& errorMessage) {
+		pauseMainThread();
+		return BinaryMessage::OK;
+	}
+
+private:
+	BinaryMessage::Status processResumeCommandBinary(BinaryMessage::Reader& arguments, BinaryMessage::Writer& reply,
+			std::string& errorMessage) {
+		resumeMainThread();
+		return BinaryMessage::OK;
+	}
+
+private:
+	/** Writes the scalar part of the getStatus reply (see BinaryMessage::GetStatus).
+	 */
+	BinaryMessage::Status processGetStatusCommandBinary(BinaryMessage::Reader& arguments,
+			BinaryMessage::Writer& reply, std::string& errorMessage) {
+		const std::shared_ptr<const MainThread::StatusSnapshot> snapshot = mainThread->getStatusSnapshot();
+		reply.putUInt8(snapshot->daqStatus == DAQStatus::Running ? 1 : 0);
+		reply.putUInt8(snapshot->boardConnected ? 1 : 0);
+		reply.putUInt8(snapshot->burstActive ? 1 : 0);
+		reply.putUInt8(snapshot->gpsFixValid ? 1 : 0);
+		reply.putUInt32(static_cast<uint32_t>(snapshot->elapsedTime));
+		reply.putUInt64(snapshot->nEvents);
+		reply.putUInt32(static_cast<uint32_t>(snapshot->elapsedTimeOfCurrentOutputFile));
+		reply.putUInt64(snapshot->nEventsOfCurrentOutputFile);
+		reply.putUInt32(static_cast<uint32_t>(snapshot->nBursts));
+		reply.putUInt64(snapshot->nLateEvents);
+		reply.putUInt64(snapshot->coincidence.nCoincidences);
+		reply.putUInt64(snapshot->coincidence.nVetoedEvents);
+		reply.putUInt64(snapshot->coincidence.nDroppedEvents);
+		reply.putUInt32(static_cast<uint32_t>(snapshot->nClockJumps));
+		reply.putDouble(snapshot->clockRateRatio);
+		reply.putUInt32(static_cast<uint32_t>(snapshot->linkRecovery.nFailures));
+		reply.putUInt32(static_cast<uint32_t>(snapshot->linkRecovery.nRecoveries));
+		reply.putUInt64(snapshot->nSSDTPResyncs);
+		reply.putUInt64(snapshot->nSSDTPDiscardedBytes);
+		reply.putString(snapshot->outputFileName);
+		return BinaryMessage::OK;
+	}
+
+private:
+	BinaryMessage::Status processStartNewOutputFileCommandBinary(BinaryMessage::Reader& arguments,
+			BinaryMessage::Writer& reply, std::string& errorMessage) {
 		mainThread->startNewOutputFile();
+		return BinaryMessage::OK;
+	}
 
-		// Construct reply message
+private:
+	/** Returns the light curve of the last N minutes (see BinaryMessage::GetLightCurve).
+	 */
+	BinaryMessage::Status processGetLightCurveCommandBinary(BinaryMessage::Reader& arguments,
+			BinaryMessage::Writer& reply, std::string& errorMessage) {
+		double lastNMinutes = DefaultLightCurveDurationInMinutes;
+		if (arguments.getRemainingSize() != 0) {
+			lastNMinutes = arguments.getDouble();
+		}
+		if (!std::isfinite(lastNMinutes) || lastNMinutes <= 0) {
+			errorMessage = "lastNMinutes should be a positive number";
+			return BinaryMessage::Error;
+		}
+		LightCurve* lightCurve = mainThread->getLightCurve();
+		if (lightCurve == nullptr) {
+			errorMessage = "light curve not available";
+			return BinaryMessage::Error;
+		}
+		const LightCurve::Data data = lightCurve->getLightCurve(lastNMinutes * 60);
+		reply.putDouble(data.binWidthInSec);
+		reply.putDouble(data.startTimeInSec);
+		reply.putUInt16(static_cast<uint16_t>(data.nChannels));
+		reply.putUInt16(static_cast<uint16_t>(data.nBands));
+		reply.putUInt32(static_cast<uint32_t>(data.nBins));
+		for (auto boundary : data.energyBandBoundaries) {
+			reply.putUInt32(boundary);
+		}
+		for (auto count : data.counts) {
+			reply.putUInt32(count);
+		}
+		return BinaryMessage::OK;
+	}
+
+private:
+	/** Changes thresholds during acquisition (see BinaryMessage::SetParameters).
+	 */
+	BinaryMessage::Status processSetParametersCommandBinary(BinaryMessage::Reader& arguments,
+			BinaryMessage::Writer& reply, std::string& errorMessage) {
+		MainThread::ControlCommand command { MainThread::ControlCommand::Type::SetParameters, { } };
+		MainThread::ParameterChangeRequest& request = command.parameterChange;
+		request.boardIndex = arguments.getUInt8();
+		const uint8_t flags = arguments.getUInt8();
+		if ((flags & SetTriggerThresholds) != 0) {
+			for (size_t ch = 0; ch < SpaceFibreADC::NumberOfChannels; ch++) {
+				request.parameters.triggerThresholds.push_back(arguments.getUInt16());
+			}
+		}
+		if ((flags & SetTriggerCloseThresholds) != 0) {
+			for (size_t ch = 0; ch < SpaceFibreADC::NumberOfChannels; ch++) {
+				request.parameters.triggerCloseThresholds.push_back(arguments.getUInt16());
+			}
+		}
+		if (!arguments.isValid()) {
+			errorMessage = "arguments are too short";
+			return BinaryMessage::InvalidMessage;
+		}
+		// replied when MainThread has written the registers
+		setReplyDeferred(mainThread->submitCommand(command));
+		return BinaryMessage::OK;
+	}
+
+private:
+	picojson::object createOKMessage() {
 		picojson::object replyMessage;
 		replyMessage["status"] = picojson::value("ok");
 		replyMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
 		return replyMessage;
 	}
 
+private:
+	picojson::object createErrorMessage(const std::string& message) {
+		picojson::object errorMessage;
+		errorMessage["status"] = picojson::value("error");
+		errorMessage["unixTime"] = picojson::value(static_cast<double>(CxxUtilities::Time::getUNIXTimeAsUInt32()));
+		errorMessage["message"] = picojson::value(message);
+		return errorMessage;
+	}
+
+private:
+	static constexpr double DefaultLightCurveDurationInMinutes = 10;
+	static const uint32_t CommandTimeOutInMillisecond = 800; // clients time out after 1 s
+	static const uint8_t SetTriggerThresholds = 0x01; // flags of BinaryMessage::SetParameters
+	static const uint8_t SetTriggerCloseThresholds = 0x02;
+
 private:
 	zmq::context_t context;
 	zmq::socket_t socket;
-	zmq::message_t replyMessage;
+	std::vector<uint8_t> replyBuffer;
+	std::map<std::string, const Command*> commandsByName;
+	const Command* commandsByID[256] = { };
+
+private:
+	/** Request whose reply waits for MainThread to execute the command.
+	 */
+	struct PendingReply {
+		std::vector<std::string> envelope;
+		uint64_t sequence; // see MainThread::submitCommand()
+		bool binary;
+		uint8_t commandID; // for binary replies
+		std::chrono::steady_clock::time_point deadline;
+	};
+	std::vector<PendingReply> pendingReplies;
+	bool replyDeferred = false;
+	uint64_t deferredSequence = 0;
 
 private:
 	MainThread* mainThread;
@@ -0,0 +1,210 @@
+#ifndef SRC_NMEAPARSER_HH_
+#define SRC_NMEAPARSER_HH_
+
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/** Streaming parser of NMEA 0183 sentences output by the GPS receiver.
+ * Bytes read from the GPS Data FIFO are fed with feed() in arbitrary chunks;
+ * a sentence split across two reads is assembled as long as the chunks are
+ * contiguous (call discardPartialSentence() when they are not, e.g. after
+ * the FIFO was cleared). Sentences with a wrong checksum are discarded.
+ * GGA (fix quality, satellites, position), RMC (validity, date) and ZDA
+ * (date) sentences are interpreted; others are ignored.
+ */
+class NMEAParser {
+public:
+	/** Latest GPS solution.
+	 */
+	struct Fix {
+		bool timeValid; // true if utcTime holds date and time of day
+		double utcTime; // UNIX time in sec of the latest sentence
+		double latitude; // deg (north positive)
+		double longitude; // deg (east positive)
+		double altitude; // m above mean sea level
+		uint8_t fixQuality; // GGA fix quality (0 = no fix, 1 = GPS, 2 = DGPS, ...)
+		uint8_t nSatellites; // number of satellites in use
+		double hdop;
+		bool rmcValid; // RMC status 'A'
+	};
+
+public:
+	/** Feeds received bytes.
+	 * @return the number of sentences interpreted in this call
+	 */
+	size_t feed(const uint8_t* data, size_t length) {
+		size_t nInterpreted = 0;
+		for (size_t i = 0; i < length; i++) {
+			const char c = static_cast<char>(data[i]);
+			if (c == '$') {
+				if (sentence.size() != 0) {
+					nDiscardedSentences++; // truncated sentence
+				}
+				sentence = "$";
+			} else if (c == '\r' || c == '\n') {
+				if (sentence.size() != 0 && interpret(sentence)) {
+					nInterpreted++;
+				}
+				sentence.clear();
+			} else if (sentence.size() != 0) {
+				if (c < 0x20 || 0x7e < c || sentence.size() >= MaximumSentenceLength) {
+					nDiscardedSentences++;
+					sentence.clear();
+				} else {
+					sentence.push_back(c);
+				}
+			}
+		}
+		return nInterpreted;
+	}
+
+public:
+	/** Forgets a sentence being assembled (the next byte is not contiguous with the previous ones).
+	 */
+	void discardPartialSentence() {
+		sentence.clear();
+	}
+
+public:
+	/** Returns the latest solution.
+	 */
+	const Fix& getFix() const {
+		return fix;
+	}
+
+public:
+	/** Returns true if the receiver reports a valid position and time.
+	 */
+	bool hasValidFix() const {
+		return fix.timeValid && fix.fixQuality != 0;
+	}
+
+public:
+	size_t getNSentences() const {
+		return nSentences;
+	}
+
+public:
+	/** Returns the number of sentences discarded due to checksum error or truncation.
+	 */
+	size_t getNDiscardedSentences() const {
+		return nDiscardedSentences;
+	}
+
+private:
+	bool interpret(const std::string& line) {
+		// $GPGGA,...*hh
+		const size_t asterisk = line.rfind('*');
+		if (asterisk == std::string::npos || asterisk + 3 > line.size() || line.size() < 7) {
+			nDiscardedSentences++;
+			return false;
+		}
+		uint8_t checksum = 0;
+		for (size_t i = 1; i < asterisk; i++) {
+			checksum ^= static_cast<uint8_t>(line[i]);
+		}
+		if (checksum != std::strtoul(line.substr(asterisk + 1, 2).c_str(), nullptr, 16)) {
+			nDiscardedSentences++;
+			return false;
+		}
+		fields.clear();
+		size_t start = 1;
+		for (size_t i = 1; i <= asterisk; i++) {
+			if (i == asterisk || line[i] == ',') {
+				fields.push_back(line.substr(start, i - start));
+				start = i + 1;
+			}
+		}
+		nSentences++;
+		if (fields[0].size() != 5) {
+			return false;
+		}
+		// ignore the talker ID (GP, GN, GL, ...)
+		const std::string type = fields[0].substr(2);
+		if (type == "GGA" && fields.size() >= 10) {
+			setTimeOfDay(fields[1]);
+			fix.latitude = parseCoordinate(fields[2], fields[3]);
+			fix.longitude = parseCoordinate(fields[4], fields[5]);
+			fix.fixQuality = static_cast<uint8_t>(std::atoi(fields[6].c_str()));
+			fix.nSatellites = static_cast<uint8_t>(std::atoi(fields[7].c_str()));
+			fix.hdop = std::atof(fields[8].c_str());
+			fix.altitude = std::atof(fields[9].c_str());
+			return true;
+		} else if (type == "RMC" && fields.size() >= 10) {
+			fix.rmcValid = (fields[2] == "A");
+			// date is ddmmyy
+			if (fields[9].size() == 6) {
+				setDate(std::atoi(fields[9].substr(0, 2).c_str()), std::atoi(fields[9].substr(2, 2).c_str()),
+						2000 + std::atoi(fields[9].substr(4, 2).c_str()));
+			}
+			setTimeOfDay(fields[1]);
+			return true;
+		} else if (type == "ZDA" && fields.size() >= 5) {
+			if (fields[2] != "" && fields[3] != "" && fields[4] != "") {
+				setDate(std::atoi(fields[2].c_str()), std::atoi(fields[3].c_str()), std::atoi(fields[4].c_str()));
+			}
+			setTimeOfDay(fields[1]);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	/** Converts ddmm.mmmm (or dddmm.mmmm) and a hemisphere letter to degrees.
+	 */
+	static double parseCoordinate(const std::string& value, const std::string& hemisphere) {
+		if (value == "") {
+			return 0;
+		}
+		const double v = std::atof(value.c_str());
+		const int degrees = static_cast<int>(v / 100);
+		const double result = degrees + (v - degrees * 100) / 60.0;
+		return (hemisphere == "S" || hemisphere == "W") ? -result : result;
+	}
+
+private:
+	void setDate(int day, int month, int year) {
+		if (day < 1 || 31 < day || month < 1 || 12 < month || year < 2000) {
+			return;
+		}
+		struct tm t { };
+		t.tm_year = year - 1900;
+		t.tm_mon = month - 1;
+		t.tm_mday = day;
+		unixTimeOfDate = static_cast<double>(timegm(&t));
+		lastTimeOfDay = 0;
+		dateValid = true;
+	}
+
+private:
+	void setTimeOfDay(const std::string& hhmmss) {
+		if (hhmmss.size() < 6) {
+			return;
+		}
+		const double timeOfDay = std::atoi(hhmmss.substr(0, 2).c_str()) * 3600.0
+				+ std::atoi(hhmmss.substr(2, 2).c_str()) * 60.0 + std::atof(hhmmss.substr(4).c_str());
+		if (dateValid && timeOfDay < lastTimeOfDay - SecondsPerDay / 2) {
+			unixTimeOfDate += SecondsPerDay; // passed midnight before the date was updated
+		}
+		lastTimeOfDay = timeOfDay;
+		fix.timeValid = dateValid;
+		fix.utcTime = dateValid ? unixTimeOfDate + timeOfDay : 0;
+	}
+
+private:
+	static const size_t MaximumSentenceLength = 120; // NMEA limits a sentence to 82 characters
+	std::string sentence;
+	std::vector<std::string> fields;
+	Fix fix { };
+	bool dateValid = false;
+	double unixTimeOfDate = 0;
+	double lastTimeOfDay = 0;
+	static constexpr double SecondsPerDay = 86400;
+	size_t nSentences = 0;
+	size_t nDiscardedSentences = 0;
+};
+
+#endif /* SRC_NMEAPARSER_HH_ */
@@ -0,0 +1,185 @@
+#ifndef SRC_PULSESHAPEANALYZER_HH_
+#define SRC_PULSESHAPEANALYZER_HH_
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+#include "GROWTH_FY2015_ADC.hh"
+
+/** Computes pulse-shape features from waveforms in software.
+ * The following columns of EventBatch are filled:
+ * - pulseIntegral: sum of (sample - baseline) over the waveform
+ * - riseTime: number of samples from 10% to 90% of the pulse height on the leading edge
+ * - fallTime: number of samples from 90% to 10% of the pulse height on the trailing edge
+ * - tailTotalRatio: integral after (peak + tailStartOffset) divided by pulseIntegral
+ * - pileUpFlags: see PileUpFlag
+ *
+ * The baseline is the mean of the first nBaselineSamples samples (i.e. pre-trigger samples).
+ * Sum and maximum search, which dominate the computation, are vectorized with
+ * NEON when available (Raspberry Pi 3), and written as plain loops that the
+ * compiler can auto-vectorize otherwise.
+ */
+class PulseShapeAnalyzer {
+public:
+	enum PileUpFlag : uint8_t {
+		PileUpFlag_SecondPulse = 0x01, // signal crossed 50% level upward twice
+		PileUpFlag_Saturated = 0x02, // waveform reached the ADC maximum
+		PileUpFlag_NotReturned = 0x04 // signal did not return below 10% before the end of the waveform
+	};
+
+public:
+	/** @param[in] nBaselineSamples number of leading samples used to compute the baseline
+	 * @param[in] tailStartOffset tail region starts at this number of samples after the peak
+	 */
+	PulseShapeAnalyzer(size_t nBaselineSamples, size_t tailStartOffset) :
+			nBaselineSamples(nBaselineSamples == 0 ? 1 : nBaselineSamples), tailStartOffset(tailStartOffset) {
+	}
+
+public:
+	/** Computes pulse-shape features of events. Events without waveform are
+	 * filled with zeros.
+	 * @param[in,out] events decoded events
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		for (size_t i = 0; i < events.size(); i++) {
+			process(events, i);
+		}
+	}
+
+public:
+	/** Computes pulse-shape features of the i-th event of a batch.
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events, size_t i) {
+		int32_t& pulseIntegral = events.pulseIntegral[i];
+		uint16_t& riseTime = events.riseTime[i];
+		uint16_t& fallTime = events.fallTime[i];
+		float& tailTotalRatio = events.tailTotalRatio[i];
+		uint8_t& pileUpFlags = events.pileUpFlags[i];
+		pulseIntegral = 0;
+		riseTime = 0;
+		fallTime = 0;
+		tailTotalRatio = 0;
+		pileUpFlags = 0;
+
+		const size_t n = events.nSamples[i];
+		const uint16_t* waveform = events.getWaveform(i);
+		if (n <= nBaselineSamples) {
+			return;
+		}
+
+		// baseline
+		const int32_t baseline = static_cast<int32_t>(sum(waveform, nBaselineSamples) / nBaselineSamples);
+
+		// peak
+		const uint16_t peak = maximum(waveform, n);
+		size_t peakIndex = 0;
+		while (waveform[peakIndex] != peak) {
+			peakIndex++;
+		}
+		const int32_t height = static_cast<int32_t>(peak) - baseline;
+		if (height <= 0) {
+			return;
+		}
+		if (peak >= GROWTH_FY2015_ADC::PHAMaximum) {
+			pileUpFlags |= PileUpFlag_Saturated;
+		}
+
+		// integral and tail/total ratio
+		const int64_t total = static_cast<int64_t>(sum(waveform, n)) - static_cast<int64_t>(baseline) * n;
+		pulseIntegral = static_cast<int32_t>(total);
+		const size_t tailStart = std::min(peakIndex + tailStartOffset, n);
+		const int64_t tail = static_cast<int64_t>(sum(waveform + tailStart, n - tailStart))
+				- static_cast<int64_t>(baseline) * (n - tailStart);
+		if (total > 0) {
+			tailTotalRatio = static_cast<float>(tail) / static_cast<float>(total);
+		}
+
+		// rise time (search backward from the peak)
+		const int32_t level10 = baseline + height / 10;
+		const int32_t level50 = baseline + height / 2;
+		const int32_t level90 = baseline + height * 9 / 10;
+		size_t i90 = peakIndex;
+		while (i90 > 0 && waveform[i90 - 1] >= level90) {
+			i90--;
+		}
+		size_t i10 = i90;
+		while (i10 > 0 && waveform[i10 - 1] >= level10) {
+			i10--;
+		}
+		riseTime = static_cast<uint16_t>(i90 - i10);
+
+		// fall time (search forward from the peak)
+		size_t j90 = peakIndex;
+		while (j90 + 1 < n && waveform[j90 + 1] >= level90) {
+			j90++;
+		}
+		size_t j10 = j90;
+		while (j10 + 1 < n && waveform[j10 + 1] >= level10) {
+			j10++;
+		}
+		if (j10 + 1 >= n) {
+			pileUpFlags |= PileUpFlag_NotReturned;
+		}
+		fallTime = static_cast<uint16_t>(j10 - j90);
+
+		// pile up (count upward crossings of the 50% level)
+		size_t nCrossings = 0;
+		bool above = waveform[0] >= level50;
+		for (size_t o = 1; o < n; o++) {
+			const bool currentAbove = waveform[o] >= level50;
+			if (currentAbove && !above) {
+				nCrossings++;
+			}
+			above = currentAbove;
+		}
+		if (nCrossings > 1) {
+			pileUpFlags |= PileUpFlag_SecondPulse;
+		}
+	}
+
+private:
+	static uint32_t sum(const uint16_t* data, size_t n) {
+		uint32_t result = 0;
+		size_t i = 0;
+#ifdef __ARM_NEON
+		uint32x4_t accumulator = vdupq_n_u32(0);
+		for (; i + 8 <= n; i += 8) {
+			accumulator = vpadalq_u16(accumulator, vld1q_u16(data + i));
+		}
+		uint32x2_t pair = vadd_u32(vget_low_u32(accumulator), vget_high_u32(accumulator));
+		result = vget_lane_u32(vpadd_u32(pair, pair), 0);
+#endif
+		for (; i < n; i++) {
+			result += data[i];
+		}
+		return result;
+	}
+
+private:
+	static uint16_t maximum(const uint16_t* data, size_t n) {
+		uint16_t result = 0;
+		size_t i = 0;
+#ifdef __ARM_NEON
+		if (n >= 8) {
+			uint16x8_t maxVector = vdupq_n_u16(0);
+			for (; i + 8 <= n; i += 8) {
+				maxVector = vmaxq_u16(maxVector, vld1q_u16(data + i));
+			}
+			uint16x4_t m = vpmax_u16(vget_low_u16(maxVector), vget_high_u16(maxVector));
+			m = vpmax_u16(m, m);
+			m = vpmax_u16(m, m);
+			result = vget_lane_u16(m, 0);
+		}
+#endif
+		for (; i < n; i++) {
+			result = std::max(result, data[i]);
+		}
+		return result;
+	}
+
+private:
+	size_t nBaselineSamples;
+	size_t tailStartOffset;
+};
+
+#endif /* SRC_PULSESHAPEANALYZER_HH_ */
@@ -19,6 +19,14 @@
 #include <functional>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <climits>
+#include <cstdlib>
+#include <libgen.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
 
 #include "SpaceWireRMAPLibrary/SpaceWireUtilities.hh"
 
@@ -50,29 +58,41 @@ public:
 	}
 };
 
+/** Serial port with a dedicated I/O thread.
+ * A long-lived io_service thread continuously drains the tty into a ring
+ * buffer (ReceiveRingBufferSize bytes). receive() copies data from the ring
+ * buffer, and waits on a condition variable (with timeout) only when the
+ * ring buffer is empty. When the ring buffer is full, the I/O thread waits
+ * until consumers free space, so received bytes are never dropped.
+ */
 struct SerialPort {
 public:
 	static const size_t ReadBufferSize = 10 * 1024;
-
-public:
-	void read_callback(const boost::system::error_code &e, std::size_t size, boost::array<char, ReadBufferSize> r) {
-		std::cout << "read :" << size << "byte[s] " << std::endl;
-		std::cout.write(r.data(), size);
-	}
-
-public:
-	void write_callback(const boost::system::error_code &e, std::size_t size) {
-		std::cout << "write :" << size << "byte[s]" << std::endl;
-	}
+	static const size_t ReceiveRingBufferSize = 1024 * 1024;
 
 private:
-	boost::asio::serial_port *port;
 	boost::asio::io_service io;
-	boost::asio::streambuf receive_buffer_;
+	boost::asio::serial_port* port;
+	boost::asio::io_service::work* work;
+	boost::thread* ioThread;
+	std::vector<uint8_t> readBuffer;
+
+private:
+	// ring buffer (guarded by ringMutex)
+	std::vector<uint8_t> ringBuffer;
+	size_t ringReadIndex = 0;
+	size_t ringNBytes = 0;
+	boost::mutex ringMutex;
+	boost::condition_variable dataAvailable;
+	boost::condition_variable spaceAvailable;
+	bool portClosed = false; // close() has been called
+	bool readFailed = false; // the tty returned an error (e.g. the USB-serial converter was unplugged)
+	bool receiveCanceled = false;
+	uint64_t nReceivedBytesTotal = 0;
 
 public:
 	SerialPort(std::string deviceName, size_t baudRate = 9600) :
-			timeoutDurationObject(1000) {
+			readBuffer(ReadBufferSize), ringBuffer(ReceiveRingBufferSize), timeoutDurationObject(1000) {
 		using namespace std;
 
 		port = new boost::asio::serial_port(io, deviceName.c_str());
@@ -82,101 +102,179 @@ public:
 		port->set_option(boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::none));
 		port->set_option(boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one));
 
-		// for non-blocking
-		// boost::thread thr_io(boost::bind(&boost::asio::io_service::run, &io));
-
 		setTimeout(1000);
+
+		// start the I/O thread
+		work = new boost::asio::io_service::work(io);
+		startAsyncRead();
+		ioThread = new boost::thread([this]() {io.run();});
 	}
 
-	/*
-	 public:
-	 size_t receive(std::vector<uint8_t> &receiveBuffer) {
-	 return port->read_some(boost::asio::buffer(receiveBuffer));
-	 }*/
+public:
+	~SerialPort() {
+		close();
+	}
 
 public:
+	/** Stops the I/O thread and closes the port. Also called after a read
+	 * error, so that the thread and the file descriptor are released.
+	 */
 	void close() {
-		port->close();
+		{
+			boost::lock_guard<boost::mutex> lock(ringMutex);
+			if (portClosed) {
+				return;
+			}
+			portClosed = true;
+		}
+		dataAvailable.notify_all();
+		spaceAvailable.notify_all();
+		boost::system::error_code error;
+		port->cancel(error);
+		port->close(error);
+		delete work;
+		io.stop();
+		ioThread->join();
+		delete ioThread;
 		delete port;
 	}
 
+private:
+	void startAsyncRead() {
+		port->async_read_some(boost::asio::buffer(readBuffer),
+				[this](const boost::system::error_code& error, size_t nReceivedBytes) {
+					onReceive(error, nReceivedBytes);
+				});
+	}
+
+private:
+	/** Called in the I/O thread when data are read from the tty.
+	 */
+	void onReceive(const boost::system::error_code& error, size_t nReceivedBytes) {
+		if (error) {
+#ifdef DEBUG_SERIALPORT
+			using namespace std;
+			cout << "SerialPort::onReceive(): " << error.message() << endl;
+#endif
+			// wake up readers; the port is torn down by close()
+			boost::lock_guard<boost::mutex> lock(ringMutex);
+			readFailed = true;
+			dataAvailable.notify_all();
+			return;
+		}
+		size_t copiedBytes = 0;
+		{
+			boost::unique_lock<boost::mutex> lock(ringMutex);
+			while (copiedBytes < nReceivedBytes) {
+				while (ringNBytes == ringBuffer.size() && !portClosed) {
+					spaceAvailable.wait(lock);
+				}
+				if (portClosed) {
+					return;
+				}
+				const size_t writeIndex = (ringReadIndex + ringNBytes) % ringBuffer.size();
+				const size_t n = std::min( { nReceivedBytes - copiedBytes, ringBuffer.size() - ringNBytes,
+						ringBuffer.size() - writeIndex });
+				memcpy(&ringBuffer[writeIndex], &readBuffer[copiedBytes], n);
+				ringNBytes += n;
+				copiedBytes += n;
+				nReceivedBytesTotal += n;
+				dataAvailable.notify_all();
+			}
+		}
+		startAsyncRead();
+	}
+
+public:
+	/** Sets ASYNC_LOW_LATENCY to the tty so that received bytes are
+	 * pushed to the user space without the driver's buffering delay.
+	 * @return true if successful
+	 */
+	bool setLowLatencyMode() {
+#ifdef __linux__
+		struct serial_struct serial;
+		const int fd = port->native_handle();
+		if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+			return false;
+		}
+		serial.flags |= ASYNC_LOW_LATENCY;
+		return ioctl(fd, TIOCSSERIAL, &serial) == 0;
+#else
+		return false;
+#endif
+	}
+
+public:
+	/** Sets the latency timer of an FTDI USB-serial converter via sysfs
+	 * (default 16 ms; 1 ms is the minimum). Symbolic links such as
+	 * /dev/serial/by-id/... are resolved.
+	 * @param[in] deviceName tty device name (e.g. /dev/ttyUSB0)
+	 * @param[in] latencyTimerInMillisec latency timer value
+	 * @return true if successful (false if the device is not an FTDI converter or permission is denied)
+	 */
+	static bool setFTDILatencyTimer(std::string deviceName, uint8_t latencyTimerInMillisec) {
+#ifdef __linux__
+		char resolvedPath[PATH_MAX];
+		if (realpath(deviceName.c_str(), resolvedPath) == NULL) {
+			return false;
+		}
+		const std::string sysfsFile = std::string("/sys/bus/usb-serial/devices/") + basename(resolvedPath)
+				+ "/latency_timer";
+		std::ofstream ofs(sysfsFile);
+		if (!ofs.is_open()) {
+			return false;
+		}
+		ofs << static_cast<uint32_t>(latencyTimerInMillisec) << std::endl;
+		return ofs.good();
+#else
+		return false;
+#endif
+	}
+
+private:
+	boost::mutex sendMutex;
+
 public:
 	void send(std::vector<uint8_t> &sendBuffer) {
+		send(sendBuffer.data(), sendBuffer.size());
+	}
+
+public:
+	/** Sends data. Returns after all the bytes are written.
+	 * @param[in] sendBuffer data to be sent
+	 * @param[in] length length of the data
+	 */
+	void send(const uint8_t* sendBuffer, size_t length) {
 #ifdef DEBUG_SERIALPORT
 		using namespace std;
 		cout << "Send: ";
-		SpaceWireUtilities::dumpPacket(sendBuffer);
+		std::vector<uint8_t> dumpBuffer(sendBuffer, sendBuffer + length);
+		SpaceWireUtilities::dumpPacket(dumpBuffer);
 #endif
-		port->write_some(boost::asio::buffer(sendBuffer));
+		boost::lock_guard<boost::mutex> lock(sendMutex);
+		boost::asio::write(*port, boost::asio::buffer(sendBuffer, length));
 	}
 
-private:
-	std::vector<uint8_t> internalBufferForSend;
-
 public:
-	void send(uint8_t* sendBuffer, size_t length) {
-		internalBufferForSend.resize(length);
-		memcpy(&(internalBufferForSend[0]), sendBuffer, length);
+	/** Sends a header and a payload as a single write (gather I/O) without copying them
+	 * into an intermediate buffer. Returns after all the bytes are written.
+	 * @param[in] header header data
+	 * @param[in] headerLength length of the header
+	 * @param[in] payload payload data
+	 * @param[in] payloadLength length of the payload
+	 */
+	void send(const uint8_t* header, size_t headerLength, const uint8_t* payload, size_t payloadLength) {
 #ifdef DEBUG_SERIALPORT
 		using namespace std;
 		cout << "Send: ";
-		SpaceWireUtilities::dumpPacket(internalBufferForSend);
+		std::vector<uint8_t> dumpBuffer(header, header + headerLength);
+		dumpBuffer.insert(dumpBuffer.end(), payload, payload + payloadLength);
+		SpaceWireUtilities::dumpPacket(dumpBuffer);
 #endif
-		port->write_some(boost::asio::buffer(internalBufferForSend));
-	}
-
-	/*
-	 public:
-	 void write_nonblocking(uint8_t *buffer, size_t length) {
-	 port->async_write_some(
-	 boost::asio::buffer(buffer, length),
-	 boost::bind(&SerialPort::write_callback, this, _1, _2));
-	 }
-
-	 public:
-	 std::vector<uint8_t> read_nonblocking() {
-	 port->async_read_some(//
-	 receive_buffer_, //
-	 boost::asio::transfer_at_least(1),//
-	 boost::bind(&SerialPort::read_callback, this)//
-	 );
-	 std::vector<uint8_t> result;
-	 return result;
-	 }*/
-
-private:
-	CxxUtilities::Mutex mutex;
-
-public:
-	template<typename MutableBufferSequence>
-	void receiveWithTimeout(const MutableBufferSequence &buffers, size_t &nReceivedBytes,
-			const boost::asio::deadline_timer::duration_type &expiry_time) {
-		mutex.lock();
-		boost::optional<boost::system::error_code> timer_result;
-		boost::asio::deadline_timer timer(port->get_io_service());
-		timer.expires_from_now(expiry_time);
-		timer.async_wait([&timer_result](const boost::system::error_code &error) {
-			timer_result.reset(error);
-		});
-
-		boost::optional<boost::system::error_code> read_result;
-		port->async_read_some(buffers, [&read_result,&nReceivedBytes](const boost::system::error_code &error,
-				size_t _nReceivedBytes) {read_result.reset(error); nReceivedBytes=_nReceivedBytes;});
-
-		port->get_io_service().reset();
-		while (port->get_io_service().run_one()) {
-			if (read_result)
-				timer.cancel();
-			else if (timer_result)
-				port->cancel();
-		}
-
-		if (*read_result) {
-			mutex.unlock();
-			throw boost::system::system_error(*read_result);
-		}
-
-		mutex.unlock();
+		const boost::array<boost::asio::const_buffer, 2> buffers = { { boost::asio::buffer(header, headerLength),
+				boost::asio::buffer(payload, payloadLength) } };
+		boost::lock_guard<boost::mutex> lock(sendMutex);
+		boost::asio::write(*port, buffers);
 	}
 
 public:
@@ -193,46 +291,70 @@ public:
 public:
 	/** Receives data. The maximum length can be specified as length.
 	 * Receive size may be shorter than the specified length.
+	 * SerialPortException::Timeout is thrown if no data arrive within the timeout duration,
+	 * and SerialPortException::SerialPortClosed if the port is closed, a read error occurred,
+	 * or receive is canceled. A cancel request (cancelReceive()) is cleared when this method returns.
 	 * @param[in] data uint8_t buffer where received data will be stored
 	 * @param[in] length the maximum size of the data buffer
 	 * @return received size
 	 */
 	size_t receive(uint8_t* data, uint32_t length, bool waitUntilSpecifiedLengthCompletes = false)
 			throw (SerialPortException) {
-		int result = 0;
-		int remainingLength = length;
-		int readDoneLength = 0;
-		size_t nReceivedBytes;
-
-		try {
-			_SerialPort_receive_loop: //
-			receiveWithTimeout(boost::asio::buffer((uint8_t*) data + readDoneLength, remainingLength), nReceivedBytes,
-					timeoutDurationObject);
-
-			if (nReceivedBytes > length) {
-				using namespace std;
-				cerr << "SerialPort::receive(): too long data (" << nReceivedBytes << " bytes) received against specified "
-						<< length << " bytes" << endl;
-				throw SerialPortException(SerialPortException::TooLargeDataReceived);
-			}
-
-			if (waitUntilSpecifiedLengthCompletes == false) {
-				return nReceivedBytes;
-			} else {
-				remainingLength = remainingLength - nReceivedBytes;
-				readDoneLength = readDoneLength + nReceivedBytes;
-				if (remainingLength == 0) {
-					return length;
+		size_t readDoneLength = 0;
+		boost::unique_lock<boost::mutex> lock(ringMutex);
+		while (readDoneLength < length) {
+			// wait for data
+			while (ringNBytes == 0) {
+				if (portClosed || readFailed || receiveCanceled) {
+					receiveCanceled = false;
+					throw SerialPortException(SerialPortException::SerialPortClosed);
+				}
+				if (!dataAvailable.timed_wait(lock, timeoutDurationObject) && ringNBytes == 0) {
+					receiveCanceled = false;
+					throw SerialPortException(SerialPortException::Timeout);
 				}
-				goto _SerialPort_receive_loop;
 			}
-		} catch (boost::system::system_error& e) {
-#ifdef DEBUG_SERIALPORT
-			using namespace std;
-			cout << "Exception in SerialPort::receive(): " << e.what() << endl;
-#endif
-			throw SerialPortException(SerialPortException::Timeout);
+			// copy from the ring buffer
+			while (ringNBytes != 0 && readDoneLength < length) {
+				const size_t n = std::min( { static_cast<size_t>(length - readDoneLength), ringNBytes,
+						ringBuffer.size() - ringReadIndex });
+				memcpy(data + readDoneLength, &ringBuffer[ringReadIndex], n);
+				ringReadIndex = (ringReadIndex + n) % ringBuffer.size();
+				ringNBytes -= n;
+				readDoneLength += n;
+			}
+			spaceAvailable.notify_all();
+			if (!waitUntilSpecifiedLengthCompletes) {
+				break;
+			}
 		}
+		receiveCanceled = false;
+		return readDoneLength;
+	}
+
+public:
+	/** Wakes up receive() waiting for data, which then throws SerialPortException::SerialPortClosed.
+	 */
+	void cancelReceive() {
+		boost::lock_guard<boost::mutex> lock(ringMutex);
+		receiveCanceled = true;
+		dataAvailable.notify_all();
+	}
+
+public:
+	/** Returns the number of bytes received from the tty since the port was opened.
+	 */
+	uint64_t getNReceivedBytes() {
+		boost::lock_guard<boost::mutex> lock(ringMutex);
+		return nReceivedBytesTotal;
+	}
+
+public:
+	/** Returns the number of bytes stored in the ring buffer, not yet consumed.
+	 */
+	size_t getNBufferedBytes() {
+		boost::lock_guard<boost::mutex> lock(ringMutex);
+		return ringNBytes;
 	}
 
 private:
@@ -40,31 +40,39 @@
 #include "SpaceWireRMAPLibrary/SpaceWireUtilities.hh"
 #include "SpaceWireRMAPLibrary/SpaceWireSSDTPModule.hh"
 #include "SpaceWireSSDTPModuleUART.hh"
+#include "Logger.hh"
 
 /** SpaceWire IF class which transfers data over UART.
  */
 class SpaceWireIFOverUART: public SpaceWireIF, public SpaceWireIFActionTimecodeScynchronizedAction {
 
 public:
-	static const int BAUD_RATE = 230400;
+	static const int BAUD_RATE = 230400; // default
+	static const uint8_t FTDILatencyTimerInMillisec = 1;
 
 public:
 	static constexpr double WaitTimeAfterCancelReceive=1500;//ms
+	static constexpr double ErrorLogIntervalInSec = 60.0;
 
 private:
 	std::string deviceName;
+	size_t baudRate;
 	SpaceWireSSDTPModuleUART* ssdtp;
 	SerialPort* serialPort;
 
 public:
 	/** Constructor.
+	 * @param[in] deviceName UART-USB device name
+	 * @param[in] baudRate baud rate (should match that of the UART of the FPGA)
 	 */
-	SpaceWireIFOverUART(std::string deviceName) :
-			SpaceWireIF(), deviceName(deviceName) {
+	SpaceWireIFOverUART(std::string deviceName, size_t baudRate = BAUD_RATE) :
+			SpaceWireIF(), deviceName(deviceName), baudRate(baudRate), ssdtp(NULL), serialPort(NULL) {
 	}
 
 public:
 	virtual ~SpaceWireIFOverUART() {
+		delete ssdtp;
+		delete serialPort;
 	}
 
 public:
@@ -72,12 +80,30 @@ public:
 		using namespace std;
 		using namespace std;
 		using namespace CxxUtilities;
+		// an instance is created per reconnection; messages are limited across instances
+		// (open() is called only by the thread which (re)connects the links)
+		static Logger::RateLimit lowLatencyRateLimit { ErrorLogIntervalInSec };
+		static Logger::RateLimit latencyTimerRateLimit { ErrorLogIntervalInSec };
+		static Logger::RateLimit openRateLimit { ErrorLogIntervalInSec };
 		ssdtp = NULL;
 		try {
-			serialPort = new SerialPort(deviceName, BAUD_RATE);
+			serialPort = new SerialPort(deviceName, baudRate);
 			setTimeoutDuration(500000);
+			// reduce latency of each RMAP transaction (not fatal if unavailable)
+			if (!serialPort->setLowLatencyMode()) {
+				Logger::warning(lowLatencyRateLimit) << "SpaceWireIFOverUART::open(): ASYNC_LOW_LATENCY could not be set to "
+						<< deviceName;
+			}
+			if (!SerialPort::setFTDILatencyTimer(deviceName, FTDILatencyTimerInMillisec)) {
+				Logger::warning(latencyTimerRateLimit) << "SpaceWireIFOverUART::open(): FTDI latency timer could not be set for "
+						<< deviceName;
+			}
 		} catch (SerialPortException& e) {
 			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
+		} catch (boost::system::system_error& e) {
+			Logger::error(openRateLimit) << "SpaceWireIFOverUART::open(): " << e.what() << " (baud rate = " << baudRate
+					<< ")";
+			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
 		} catch (...) {
 			throw SpaceWireIFException(SpaceWireIFException::OpeningConnectionFailed);
 		}
@@ -91,8 +117,12 @@ public:
 	void close() throw (SpaceWireIFException) {
 		using namespace CxxUtilities;
 		using namespace std;
-		ssdtp->cancelReceive();
-		serialPort->close();
+		if (ssdtp != NULL) {
+			ssdtp->cancelReceive();
+		}
+		if (serialPort != NULL) {
+			serialPort->close();
+		}
 	}
 
 public:
@@ -213,6 +243,16 @@ public:
 	SpaceWireSSDTPModuleUART* getSSDTPModule() {
 		return ssdtp;
 	}
+
+public:
+	SerialPort* getSerialPort() {
+		return serialPort;
+	}
+
+public:
+	size_t getBaudRate() const {
+		return baudRate;
+	}
 public:
 	/** Cancels ongoing receive() method if any exist.
 	 */
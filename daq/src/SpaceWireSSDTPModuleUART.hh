@@ -37,6 +37,7 @@
 #include "SpaceWireRMAPLibrary/SpaceWireSSDTPModule.hh"
 
 #include "SerialPort.hh"
+#include "Logger.hh"
 
 /** A class that performs synchronous data transfer via
  * UART using "Simple- Synchronous- Data Transfer Protocol".
@@ -66,7 +67,6 @@ private:
 	std::map<uint32_t, uint32_t> registers;
 
 private:
-	uint8_t rheader[12];
 	uint8_t sheader[12];
 
 public:
@@ -136,8 +136,7 @@ public:
 			size = size / 0x100;
 		}
 		try {
-			serialPort->send(sheader, 12);
-			serialPort->send(&(data->at(0)), data->size());
+			serialPort->send(sheader, 12, data->data(), data->size());
 #ifdef DEBUG_SSDTP
 			using namespace std;
 			size_t length = data->size();
@@ -187,8 +186,7 @@ public:
 			asize = asize / 0x100;
 		}
 		try {
-			serialPort->send(sheader, 12);
-			serialPort->send(data, length);
+			serialPort->send(sheader, 12, data, length);
 #ifdef DEBUG_SSDTP
 			using namespace std;
 			cout << "SSDTP::send():" << endl;
@@ -233,259 +231,255 @@ public:
 	 * @returns packet content.
 	 */
 	std::vector<uint8_t> receive() throw (SpaceWireSSDTPException) {
-		receivemutex.lock();
-		if (this->closed) {
-			receivemutex.unlock();
-			return {};
-		}
 		std::vector<uint8_t> data;
 		uint32_t eopType;
 		receive(&data, eopType);
-		receivemutex.unlock();
 		return data;
 	}
 
 private:
-	uint8_t rheader_previous[12];
-	std::vector<uint8_t> receivedDataPrevious;
+	// incremental deframer state (guarded by receivemutex)
+	std::vector<uint8_t> parseBuffer; // bytes received from the serial port but not yet parsed
+	size_t parseIndex = 0; // first unparsed byte in parseBuffer
+	std::vector<uint8_t> packetBeingAssembled; // payload of fragmented (0x02) frames
+	bool synchronized = true;
+	uint64_t nResyncs = 0;
+	uint64_t nDiscardedBytes = 0;
+	uint64_t nReceivedFrames = 0;
 
 public:
 	/** Tries to receive a pcket from the SpaceWire interface.
-	 * This method will block the thread for a certain length of time.
-	 * Timeout can happen via the TCPSocket provided to the instance.
-	 * The code below shows how the timeout duration can be changed.
-	 * @code
-	 * TCPClientSocket* socket=new TCPClientSocket("192.168.1.100", 10030);
-	 * socket->open();
-	 * socket->setTimeoutDuration(1000); //ms
-	 * SpaceWireSSDTPModule* ssdtpModule=new SpaceWireSSDTPModule(socket);
-	 * try{
-	 * 	ssdtpModule->receive();
-	 * }catch(SpaceWireSSDTPException& e){
-	 * 	if(e.getStatus()==SpaceWireSSDTPException::Timeout){
-	 * 	 std::cout << "Timeout" << std::endl;
-	 * 	}else{
-	 * 	 throw e;
-	 * 	}
-	 * }
-	 * @endcode
+	 * SSDTP frames are parsed incrementally from bytes read from the serial port.
+	 * When an invalid header (unknown flag, non-zero reserved byte, or too large
+	 * size) is found, bytes are discarded one by one until a valid header is
+	 * found again (resynchronization). An incomplete frame left when the serial
+	 * port times out is discarded as a whole (counted as a resynchronization),
+	 * so that the next frame is received without delay. This method
+	 * never terminates the process.
 	 * @param[out] data a vector instance which is used to store received data.
 	 * @param[out] eopType contains an EOP marker type (SpaceWireEOPMarker::EOP or SpaceWireEOPMarker::EEP).
+	 * @return size of the received packet (0 if closed or canceled)
+	 * @throw SpaceWireSSDTPException::Timeout if no complete packet is received within the timeout duration
+	 * @throw SpaceWireSSDTPException::Disconnected if the serial port is closed
 	 */
 	int receive(std::vector<uint8_t>* data, uint32_t& eopType) throw (SpaceWireSSDTPException) {
-		size_t size = 0;
-		size_t hsize = 0;
-		size_t flagment_size = 0;
-		size_t received_size = 0;
+		using namespace std;
+		receivemutex.lock();
+		while (true) {
+			if (this->closed) {
+				receivemutex.unlock();
+				return 0;
+			}
+			if (this->receiveCanceled) {
+				this->receiveCanceled = false;
+				receivemutex.unlock();
+				return 0;
+			}
 
-		try {
-			using namespace std;
-//		cout << "#1" << endl;
-			receivemutex.lock();
-			//header
-			receive_header: //
-			rheader[0] = 0xFF;
-			rheader[1] = 0x00;
-			while (rheader[0] != DataFlag_Complete_EOP && rheader[0] != DataFlag_Complete_EEP) {
-//			cout << "#2" << endl;
-
-//			cout << "#2-1" << endl;
-				hsize = 0;
-				flagment_size = 0;
-				received_size = 0;
-				//flag and size part
-				try {
-//				cout << "#2-2" << endl;
-					while (hsize != 12) {
-						if (this->closed) {
-							return 0;
-						}
-						if (this->receiveCanceled) {
-							//reset receiveCanceled
-							this->receiveCanceled = false;
-							//return with no data
-							return 0;
-						}
-//					cout << "#2-3" << endl;
-#ifdef DEBUG_SSDTP
-						using namespace std;
-						cout << "SSDTP::receive(): receiving header part (remaining size=" << dec << 12 - hsize << " bytes)" << endl;
-#endif
-						long result = serialPort->receive(rheader + hsize, 12 - hsize);
-						hsize += result;
-					}
-				} catch (SerialPortException& e) {
-//				cout << "#2-5" << endl;
-					if (e.getStatus() == SerialPortException::Timeout) {
+			// parse buffered bytes
+			bool packetCompleted = false;
+			while (parseFrame(data, eopType, packetCompleted)) {
+				if (packetCompleted) {
+					receivemutex.unlock();
+					return data->size();
+				}
+			}
+
+			// receive more bytes
+			try {
+				const size_t result = serialPort->receive(receivebuffer, BufferSize);
+				compactParseBuffer();
+				parseBuffer.insert(parseBuffer.end(), receivebuffer, receivebuffer + result);
+			} catch (SerialPortException& e) {
+				if (e.getStatus() == SerialPortException::Timeout) {
+					if (parseIndex != parseBuffer.size()) {
+						// an incomplete frame was left on the line; nothing follows it within the timeout,
+						// so all buffered bytes are stale, and the next frame starts with the next byte
 #ifdef DEBUG_SSDTP
-						using namespace std;
-						cout << "SSDTP::receive(): serial port timed out." << endl;
+						cout << "SSDTP::receive(): timed out with incomplete frame (" << dec << parseBuffer.size() - parseIndex
+								<< " bytes)" << endl;
 #endif
-//					cout << "#2-6" << endl;
-						throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
-					} else {
-//					cout << "#2-7" << endl;
-						throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+						discardUnparsedBytes();
 					}
-				} catch (...) {
-					throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+					receivemutex.unlock();
+					throw SpaceWireSSDTPException(SpaceWireSSDTPException::Timeout);
 				}
+				receivemutex.unlock();
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+			} catch (...) {
+				receivemutex.unlock();
+				throw SpaceWireSSDTPException(SpaceWireSSDTPException::Disconnected);
+			}
+		}
+	}
 
-#ifdef DEBUG_SSDTP
-				using namespace std;
-				cout << "SSDTP::receive(): header part received" << endl;
-				cout << "Header: ";
-				for (size_t i = 0; i < 12; i++) {
-					cout << hex << right << setw(2) << setfill('0') << (uint32_t) rheader[i] << " ";
-				}
-				cout << endl;
-#endif
+public:
+	/** Returns the number of times the deframer lost and searched for frame synchronization.
+	 */
+	uint64_t getNResyncs() const {
+		return nResyncs;
+	}
 
-//			cout << "#3" << endl;
-				//data or control code part
-				if (rheader[0] == DataFlag_Complete_EOP || rheader[0] == DataFlag_Complete_EEP
-						|| rheader[0] == DataFlag_Flagmented) {
-//				cout << "#4" << endl;
-					//data
-					for (uint32_t i = 2; i < 12; i++) {
-						flagment_size = flagment_size * 0x100 + rheader[i];
-					}
-					//verify flagment size
-					if (flagment_size > BufferSize) {
-						cerr << "SpaceWireSSDTPModuleUART::receive(): too large flagment size (" << flagment_size << " bytes)"
-								<< endl;
-						cerr << "Something is wrong with SSDTP over Serail Port data communication." << endl;
-						cerr << "Trying to receive remainig data from receive buffer." << endl;
-						long result = serialPort->receive(receivebuffer, BufferSize);
-						cerr << result << " bytes received." << endl;
-						cout << "Data: ";
-						for (size_t i = 0; i < result; i++) {
-							cout << hex << right << setw(2) << setfill('0') << (uint32_t) *(receivebuffer + i) << " ";
-						}
-						cout << endl;
-						exit(-1);
-					}
+public:
+	/** Returns the number of bytes discarded during resynchronization.
+	 */
+	uint64_t getNDiscardedBytes() const {
+		return nDiscardedBytes;
+	}
+
+public:
+	/** Returns the number of valid SSDTP frames received.
+	 */
+	uint64_t getNReceivedFrames() const {
+		return nReceivedFrames;
+	}
+
+private:
+	/** Parses one frame from parseBuffer.
+	 * @param[out] data filled when a packet completes
+	 * @param[out] eopType set when a packet completes
+	 * @param[out] packetCompleted true if a complete (EOP/EEP) packet was stored to data
+	 * @return false if more bytes are needed
+	 */
+	bool parseFrame(std::vector<uint8_t>* data, uint32_t& eopType, bool& packetCompleted) {
+		packetCompleted = false;
+		const size_t nAvailable = parseBuffer.size() - parseIndex;
+		if (nAvailable < 12) {
+			return false;
+		}
+		const uint8_t* header = &parseBuffer[parseIndex];
+		size_t frameSize;
+		if (!isValidHeader(header, frameSize)) {
+			discardByte();
+			return true;
+		}
+		if (nAvailable < 12 + frameSize) {
+			return false;
+		}
+		if (!synchronized) {
+			synchronized = true;
+			Logger::info(resynchronizedRateLimit) << "SpaceWireSSDTPModuleUART::receive(): resynchronized ("
+					<< nDiscardedBytes << " bytes discarded in total)";
+		}
+		const uint8_t flag = header[0];
+		const uint8_t* payload = header + 12;
+		parseIndex += 12 + frameSize;
+		nReceivedFrames++;
 
-					uint8_t* data_pointer = receivebuffer;
-//				cout << "#5" << endl;
-					while (received_size != flagment_size) {
-//					cout << "#6" << endl;
-						long result;
-						_loop_receiveDataPart: //
-						if (this->receiveCanceled) {
-							//reset receiveCanceled
-							this->receiveCanceled = false;
-							//dump info
-							cerr << "SpaceWireSSDTPModuleUART::receive(): canceled while waiting to receive " << dec << flagment_size
-									<< " bytes." << endl;
-							cout << "Current header:" << endl;
-							for (size_t i = 0; i < 12; i++) {
-								cout << hex << right << setw(2) << setfill('0') << (uint32_t) rheader[i] << " ";
-							}
-							cout << dec << endl;
-							//return with no data
-							return 0;
-						}
-						try {
-							result = serialPort->receive(data_pointer + size + received_size, flagment_size - received_size);
 #ifdef DEBUG_SSDTP
-							using namespace std;
-							cout << "SSDTP::receive(): data part received" << endl;
-							cout << "Data: ";
-							for (size_t i = 0; i < result; i++) {
-								cout << hex << right << setw(2) << setfill('0') << (uint32_t) *(data_pointer + size + received_size + i)
-										<< " ";
-							}
-							cout << endl;
+		using namespace std;
+		cout << "SSDTP::receive(): frame received (flag=0x" << hex << setw(2) << setfill('0') << (uint32_t) flag
+				<< " size=" << dec << frameSize << ")" << endl;
 #endif
-						} catch (SerialPortException e) {
-							if (e.getStatus() == SerialPortException::Timeout) {
-								goto _loop_receiveDataPart;
-							}
-							cout << "SSDTPModule::receive() exception when receiving data" << endl;
-							cout << "rheader[0]=0x" << setw(2) << setfill('0') << hex << (uint32_t) rheader[0] << endl;
-							cout << "rheader[1]=0x" << setw(2) << setfill('0') << hex << (uint32_t) rheader[1] << endl;
-							cout << "size=" << dec << size << endl;
-							cout << "flagment_size=" << dec << flagment_size << endl;
-							cout << "received_size=" << dec << received_size << endl;
-							exit(-1);
-						}
-						received_size += result;
-					}
-//				cout << "#7" << endl;
-					size += received_size;
-				} else if (rheader[0] == ControlFlag_SendTimeCode || rheader[0] == ControlFlag_GotTimeCode) {
-					//control
-					uint8_t timecode_and_reserved[2];
-					uint32_t tmp_size = 0;
-					try {
-						while (tmp_size != 2) {
-							int result = serialPort->receive(timecode_and_reserved + tmp_size, 2 - tmp_size);
-							tmp_size += result;
-						}
-					} catch (...) {
-						throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
-					}
-					switch (rheader[0]) {
-					case ControlFlag_SendTimeCode:
-						internal_timecode = timecode_and_reserved[0];
-						gotTimeCode(internal_timecode);
-						break;
-					case ControlFlag_GotTimeCode:
-						internal_timecode = timecode_and_reserved[0];
-						gotTimeCode(internal_timecode);
-						break;
-					}
-//				cout << "#11" << endl;
-				} else {
-					cout << "SSDTP fatal error with flag value of 0x" << hex << (uint32_t) rheader[0] << dec << endl;
-					cout << "Previous data: (" << dec << receivedDataPrevious.size() << " bytes)" << endl;
-					for (size_t i = 0; i < receivedDataPrevious.size(); i++) {
-						cout << hex << right << setw(2) << setfill('0') << (uint32_t) receivedDataPrevious[i] << " ";
-					}
-					cout << dec << endl;
-					cout << "Current header:" << endl;
-					for (size_t i = 0; i < 12; i++) {
-						cout << hex << right << setw(2) << setfill('0') << (uint32_t) rheader[i] << " ";
-					}
-					cout << dec << endl;
-					throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
-				}
+
+		switch (flag) {
+		case DataFlag_Complete_EOP:
+		case DataFlag_Complete_EEP:
+			packetBeingAssembled.insert(packetBeingAssembled.end(), payload, payload + frameSize);
+			if (packetBeingAssembled.size() == 0) {
+				return true; // ignore empty packet
 			}
-//		cout << "#8 " << size << endl;
-			data->resize(size);
-			if (size != 0) {
-				memcpy(&(data->at(0)), receivebuffer, size);
-			} else {
-				goto receive_header;
+			data->swap(packetBeingAssembled);
+			packetBeingAssembled.clear();
+			eopType = (flag == DataFlag_Complete_EOP) ? SpaceWireEOPMarker::EOP : SpaceWireEOPMarker::EEP;
+			packetCompleted = true;
+			return true;
+		case DataFlag_Flagmented:
+			packetBeingAssembled.insert(packetBeingAssembled.end(), payload, payload + frameSize);
+			if (packetBeingAssembled.size() > MaxPacketSize) {
+				// lost EOP; drop the packet
+				packetBeingAssembled.clear();
 			}
-			if (rheader[0] == DataFlag_Complete_EOP) {
-				eopType = SpaceWireEOPMarker::EOP;
-			} else if (rheader[0] == DataFlag_Complete_EEP) {
-				eopType = SpaceWireEOPMarker::EEP;
-			} else {
-				eopType = SpaceWireEOPMarker::Continued;
+			return true;
+		case ControlFlag_SendTimeCode:
+		case ControlFlag_GotTimeCode:
+			internal_timecode = payload[0];
+			gotTimeCode(internal_timecode);
+			return true;
+		}
+		return true;
+	}
+
+private:
+	/** Checks if 12 bytes form a valid SSDTP header.
+	 * @param[in] header 12-byte header
+	 * @param[out] frameSize size of the following payload
+	 */
+	bool isValidHeader(const uint8_t* header, size_t& frameSize) const {
+		if (header[1] != 0x00) {
+			return false;
+		}
+		uint64_t size = 0;
+		for (size_t i = 2; i < 12; i++) {
+			size = (size << 8) + header[i];
+		}
+		switch (header[0]) {
+		case DataFlag_Complete_EOP:
+		case DataFlag_Complete_EEP:
+		case DataFlag_Flagmented:
+			if (size > BufferSize) {
+				return false;
+			}
+			break;
+		case ControlFlag_SendTimeCode:
+		case ControlFlag_GotTimeCode:
+			if (size != 2) {
+				return false;
 			}
-//		cout << "#9" << endl;
+			break;
+		default:
+			return false;
+		}
+		frameSize = static_cast<size_t>(size);
+		return true;
+	}
 
-			//debug receive data
-#ifdef DEBUG_SSDTP
-			static const size_t ReceivedDataPreviousMax = 4096;
-			receivedDataPrevious.resize(std::min(size, ReceivedDataPreviousMax));
-			memcpy(&(receivedDataPrevious[0]), receivebuffer, std::min(size, ReceivedDataPreviousMax));
-#endif
-			receivemutex.unlock();
-			return size;
-		} catch (SpaceWireSSDTPException& e) {
-			receivemutex.unlock();
-			throw e;
-		} catch (SerialPortException& e) {
-			using namespace std;
-			receivemutex.unlock();
-			throw SpaceWireSSDTPException(SpaceWireSSDTPException::TCPSocketError);
+private:
+	void discardByte() {
+		if (synchronized) {
+			Logger::warning(resynchronizingRateLimit) << "SpaceWireSSDTPModuleUART::receive(): invalid SSDTP header (flag=0x"
+					<< std::hex << static_cast<uint32_t>(parseBuffer[parseIndex]) << std::dec << "); resynchronizing";
+			loseSynchronization();
+		}
+		parseIndex++;
+		nDiscardedBytes++;
+	}
+
+private:
+	void discardUnparsedBytes() {
+		if (synchronized) {
+			Logger::warning(resynchronizingRateLimit) << "SpaceWireSSDTPModuleUART::receive(): incomplete frame ("
+					<< parseBuffer.size() - parseIndex << " bytes) timed out; discarded";
+			loseSynchronization();
 		}
+		nDiscardedBytes += parseBuffer.size() - parseIndex;
+		parseIndex = parseBuffer.size();
 	}
 
+private:
+	void loseSynchronization() {
+		synchronized = false;
+		nResyncs++;
+		packetBeingAssembled.clear();
+	}
+
+private:
+	void compactParseBuffer() {
+		if (parseIndex != 0) {
+			parseBuffer.erase(parseBuffer.begin(), parseBuffer.begin() + parseIndex);
+			parseIndex = 0;
+		}
+	}
+
+private:
+	static const size_t MaxPacketSize = 1024 * 1024;
+
+private:
+	// messages of the receive thread (logged on every resynchronization of a noisy line)
+	Logger::RateLimit resynchronizingRateLimit { ErrorLogIntervalInSec };
+	Logger::RateLimit resynchronizedRateLimit { ErrorLogIntervalInSec };
+	static constexpr double ErrorLogIntervalInSec = 10.0;
+
 public:
 	/** Emits a TimeCode.
 	 * @param[in] timecode timecode value.
@@ -635,13 +629,13 @@ public:
 	/** Cancels ongoing receive() method if any exist.
 	 */
 	void cancelReceive() {
-		using namespace std;
-		cerr << "SpaceWireSSDTPModuleUART::cancelReceive() invoked" << endl;
+		Logger::info(cancelReceiveRateLimit) << "SpaceWireSSDTPModuleUART::cancelReceive() invoked";
 		this->receiveCanceled = true;
 	}
 
 private:
 	bool receiveCanceled = false;
+	Logger::RateLimit cancelReceiveRateLimit { ErrorLogIntervalInSec }; // used by the thread stopping the reader
 
 public:
 	/* for SSDTP2 */
@@ -0,0 +1,215 @@
+#ifndef SRC_TIMEORDEREDEVENTMERGER_HH_
+#define SRC_TIMEORDEREDEVENTMERGER_HH_
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+
+/** Sorts events of multiple channels/boards by time with bounded latency.
+ * Events of a single channel leave the EventFIFO in time order, but events
+ * of different channels (and boards) are interleaved in FPGA arbitration
+ * order. This class holds events in an EventBatch, and keeps a min-heap of
+ * (unwrapped time tag, row) over its rows (40-bit timeTag extended to 64 bit
+ * with TimeTagUnwrapper, so wraparound does not break the order).
+ * Events are released sorted by time; rows are in the arrival order, so
+ * events with the same time keep it. Released rows are removed from the
+ * batch only when they become the majority (compaction).
+ *
+ * An event is released when every input (channel) has advanced past its
+ * time (watermark). To bound the latency, an input which has not seen an
+ * event within maximumLatency of the most recent event is regarded as having
+ * advanced to (most recent time - maximumLatency). If no event is pushed for
+ * maximumLatency in wall-clock time, all held events are released.
+ * Events which arrive after the watermark has passed them are released
+ * immediately and counted as late events.
+ * Time tags of all boards have to be on a common time base (mapped by
+ * BoardTimeAligner before push()); they are unwrapped as one counter.
+ */
+class TimeOrderedEventMerger {
+public:
+	/** @param[in] nBoards number of boards
+	 * @param[in] maximumLatencyInSec maximum time an event is held in the merger
+	 */
+	TimeOrderedEventMerger(size_t nBoards, double maximumLatencyInSec) :
+			nBoards(nBoards), inputTimes(nBoards * SpaceFibreADC::NumberOfChannels, 0), //
+			maximumLatencyInSec(maximumLatencyInSec) {
+		maximumLatencyInClock = static_cast<uint64_t>(maximumLatencyInSec / GROWTH_FY2015_ADC::ClockInterval);
+		timeOfLastPush = std::chrono::steady_clock::now();
+	}
+
+public:
+	/** Adds events to the merger.
+	 * @param[in] events events in the order read from the EventFIFO(s)
+	 */
+	void push(const GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		if (events.size() == 0) {
+			return;
+		}
+		acceptedIndices.clear();
+		size_t row = heldEvents.size();
+		for (size_t i = 0; i < events.size(); i++) {
+			const size_t input = events.getGlobalChannelIndex(i);
+			if (events.boardIndex[i] >= nBoards || input >= inputTimes.size()) {
+				continue;
+			}
+			const uint64_t time = unwrapper.unwrap(events.timeTag[i]);
+			acceptedIndices.push_back(i);
+			heldRows.push(HeldRow { time, row });
+			row++;
+			if (inputTimes[input] < time) {
+				inputTimes[input] = time;
+			}
+			if (latestTime < time) {
+				latestTime = time;
+			}
+		}
+		heldEvents.append(events, acceptedIndices);
+		timeOfLastPush = std::chrono::steady_clock::now();
+	}
+
+public:
+	/** Appends events which can be released in time order to the specified batch.
+	 * @param[out] events released events are appended
+	 * @return the number of released events
+	 */
+	size_t pop(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		const double elapsed =
+				std::chrono::duration<double>(std::chrono::steady_clock::now() - timeOfLastPush).count();
+		if (elapsed > maximumLatencyInSec) {
+			return flush(events);
+		}
+		return release(getWatermark(), events);
+	}
+
+public:
+	/** Releases all held events (e.g. at the end of a run).
+	 * @return the number of released events
+	 */
+	size_t flush(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		return release(UINT64_MAX, events);
+	}
+
+public:
+	/** Called when the time tag counter has been restarted (the board was
+	 * reprogrammed after link recovery) and time tags are not mapped to a
+	 * common time base (single board). Events taken before the restart should
+	 * have been flushed. The next event is placed at the latest time pushed so far.
+	 * @param[in] boardIndex index of the board
+	 */
+	void restartTimeTag(size_t boardIndex) {
+		if (boardIndex < nBoards) {
+			unwrapper.restartFrom(latestTime);
+		}
+	}
+
+public:
+	/** Returns the number of events currently held in the merger.
+	 */
+	size_t getNHeldEvents() const {
+		return heldRows.size();
+	}
+
+public:
+	/** Returns the number of events which arrived after events later than them had been released.
+	 */
+	uint64_t getNLateEvents() const {
+		return nLateEvents;
+	}
+
+private:
+	uint64_t getWatermark() const {
+		const uint64_t lowerBound = (latestTime > maximumLatencyInClock) ? latestTime - maximumLatencyInClock : 0;
+		uint64_t watermark = latestTime;
+		for (auto time : inputTimes) {
+			const uint64_t inputTime = (time > lowerBound) ? time : lowerBound;
+			if (inputTime < watermark) {
+				watermark = inputTime;
+			}
+		}
+		return watermark;
+	}
+
+private:
+	/** Row of heldEvents and its unwrapped time tag (ordered by time, then by arrival).
+	 */
+	struct HeldRow {
+		uint64_t time;
+		size_t row;
+		bool operator>(const HeldRow& other) const {
+			return time > other.time || (time == other.time && row > other.row);
+		}
+	};
+
+private:
+	size_t release(uint64_t watermark, GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		releasedIndices.clear();
+		while (!heldRows.empty() && heldRows.top().time <= watermark) {
+			const HeldRow& top = heldRows.top();
+			if (top.time < lastReleasedTime) {
+				nLateEvents++;
+			} else {
+				lastReleasedTime = top.time;
+			}
+			releasedIndices.push_back(top.row);
+			heldRows.pop();
+		}
+		if (releasedIndices.size() == 0) {
+			return 0;
+		}
+		events.append(heldEvents, releasedIndices);
+		nReleasedRows += releasedIndices.size();
+		if (heldRows.empty()) {
+			heldEvents.clear();
+			nReleasedRows = 0;
+		} else if (nReleasedRows * 2 > heldEvents.size()) {
+			compact();
+		}
+		return releasedIndices.size();
+	}
+
+private:
+	/** Removes released rows from heldEvents, and renumbers the rows in the heap.
+	 */
+	void compact() {
+		std::vector<HeldRow> rows;
+		rows.reserve(heldRows.size());
+		while (!heldRows.empty()) {
+			rows.push_back(heldRows.top());
+			heldRows.pop();
+		}
+		std::sort(rows.begin(), rows.end(), [](const HeldRow& a, const HeldRow& b) {
+			return a.row < b.row;
+		});
+		keptIndices.clear();
+		for (size_t k = 0; k < rows.size(); k++) {
+			keptIndices.push_back(rows[k].row);
+			rows[k].row = k;
+		}
+		heldEvents.keep(keptIndices);
+		heldRows = HeldRowHeap(std::greater<HeldRow>(), std::move(rows));
+		nReleasedRows = 0;
+	}
+
+private:
+	size_t nBoards;
+	TimeTagUnwrapper unwrapper; // common to all boards
+	std::vector<uint64_t> inputTimes; // latest unwrapped time per channel (over all boards)
+	typedef std::priority_queue<HeldRow, std::vector<HeldRow>, std::greater<HeldRow>> HeldRowHeap;
+	GROWTH_FY2015_ADC_Type::EventBatch heldEvents; // includes released rows until compact()
+	HeldRowHeap heldRows; // rows of heldEvents not released yet
+	size_t nReleasedRows = 0; // released rows remaining in heldEvents
+	std::vector<size_t> acceptedIndices;
+	std::vector<size_t> releasedIndices;
+	std::vector<size_t> keptIndices;
+	double maximumLatencyInSec;
+	uint64_t maximumLatencyInClock;
+	uint64_t latestTime = 0;
+	uint64_t lastReleasedTime = 0;
+	uint64_t nLateEvents = 0;
+	std::chrono::steady_clock::time_point timeOfLastPush;
+};
+
+#endif /* SRC_TIMEORDEREDEVENTMERGER_HH_ */
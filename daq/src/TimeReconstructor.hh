@@ -0,0 +1,259 @@
+#ifndef SRC_TIMERECONSTRUCTOR_HH_
+#define SRC_TIMERECONSTRUCTOR_HH_
+
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include "GROWTH_FY2015_ADC.hh"
+#include "GROWTH_FY2015_ADCModules/TimeTagUnwrapper.hh"
+
+/** Converts FPGA time tags of events to absolute (UTC) time.
+ * The 40-bit EventBatch::timeTag is extended to 64 bit per board
+ * (EventBatch::unwrappedTimeTag). Pairs of (FPGA time tag, UTC) sampled from the
+ * GPS Time Register of the first board (the time tag latched at the latest
+ * PPS and the corresponding GPS time) are used as anchors of a
+ * piecewise-linear FPGA-clock-to-UTC model. EventBatch::utcTime is interpolated
+ * between anchors, or extrapolated with the slope of the latest segment
+ * (the nominal clock interval until two anchors are available).
+ *
+ * When a new anchor deviates from the prediction of the model by more than
+ * clockJumpThreshold (e.g. FPGA reset, GPS re-lock, leap second), the model
+ * is restarted from that anchor and a clock jump is counted. Events in the
+ * first segment after a jump are flagged with TimeQuality::AfterClockJump.
+ * Events of boards other than the first one (no GPS reference) only get
+ * unwrappedTimeTag and are flagged with TimeQuality::NoTimeModel.
+ */
+class TimeReconstructor {
+public:
+	/** Bits of EventBatch::timeQualityFlags.
+	 */
+	enum TimeQuality : uint8_t {
+		NoTimeModel = 0x01, // utcTime is not available (0)
+		Extrapolated = 0x02, // event time is later than the latest anchor
+		NominalClockRate = 0x04, // only one anchor available; nominal clock interval was used
+		AfterClockJump = 0x08 // event is in the first segment after a clock jump
+	};
+
+public:
+	/** @param[in] nBoards number of boards
+	 * @param[in] clockJumpThresholdInSec deviation of an anchor from the model regarded as a clock jump
+	 */
+	TimeReconstructor(size_t nBoards, double clockJumpThresholdInSec) :
+			unwrappers(nBoards > 0 ? nBoards : 1), clockJumpThresholdInSec(clockJumpThresholdInSec) {
+	}
+
+public:
+	/** Adds an anchor from a GPS Time Register buffer (see GROWTH_FY2015_ADC::getGPSRegisterUInt8()).
+	 * @param[in] timeTagOffset added to the latched time tag when event time tags are mapped to a
+	 * common time base (BoardTimeAligner::getOffset() of the first board)
+	 * @return false if the register does not contain a valid GPS time
+	 */
+	bool addGPSTimeRegister(const uint8_t* gpsTimeRegisterBuffer, uint64_t timeTagOffset = 0) {
+		uint64_t timeTag;
+		double utcTime;
+		if (!parseGPSTimeRegister(gpsTimeRegisterBuffer, timeTag, utcTime)) {
+			return false;
+		}
+		addTimeSample((timeTag + timeTagOffset) & TimeTagUnwrapper::TimeTagMask, utcTime);
+		return true;
+	}
+
+public:
+	/** Extracts the FPGA time tag latched at the latest PPS and its GPS time from a GPS Time Register buffer.
+	 * @param[out] timeTag FPGA time tag
+	 * @param[out] utcTime UNIX time in sec
+	 * @return false if the register does not contain a valid GPS time
+	 */
+	static bool parseGPSTimeRegister(const uint8_t* gpsTimeRegisterBuffer, uint64_t& timeTag, double& utcTime) {
+		// 0123456789X123456789
+		// GPYYMMDDHHMMSSxxxxxx
+		int fields[6];
+		for (size_t i = 0; i < 6; i++) {
+			const uint8_t upper = gpsTimeRegisterBuffer[2 + i * 2];
+			const uint8_t lower = gpsTimeRegisterBuffer[3 + i * 2];
+			if (upper < '0' || '9' < upper || lower < '0' || '9' < lower) {
+				return false;
+			}
+			fields[i] = (upper - '0') * 10 + (lower - '0');
+		}
+		timeTag = 0;
+		for (size_t i = 14; i < GROWTH_FY2015_ADC::LengthOfGPSTimeRegister; i++) {
+			timeTag = gpsTimeRegisterBuffer[i] + (timeTag << 8);
+		}
+		struct tm t { };
+		t.tm_year = fields[0] + 100; // 20YY
+		t.tm_mon = fields[1] - 1;
+		t.tm_mday = fields[2];
+		t.tm_hour = fields[3];
+		t.tm_min = fields[4];
+		t.tm_sec = fields[5];
+		utcTime = static_cast<double>(timegm(&t));
+		return true;
+	}
+
+public:
+	/** Adds an anchor of the model.
+	 * @param[in] timeTag FPGA time tag (40 bit) of the first board
+	 * @param[in] utcTime UTC (UNIX time in sec) corresponding to the time tag
+	 */
+	void addTimeSample(uint64_t timeTag, double utcTime) {
+		mutex.lock();
+		// GPS time tags and event time tags of the first board share the same counter
+		const Anchor anchor { unwrappers[0].unwrap(timeTag), utcTime };
+		if (anchors.size() != 0) {
+			const Anchor& latest = anchors.back();
+			if (anchor.timeTag == latest.timeTag && anchor.utcTime == latest.utcTime) {
+				mutex.unlock();
+				return; // same PPS read again
+			}
+			bool jump = anchor.timeTag <= latest.timeTag;
+			if (!jump) {
+				const double residual = anchor.utcTime - toUTC(anchor.timeTag);
+				jump = std::fabs(residual) > clockJumpThresholdInSec;
+			}
+			if (jump) {
+				nClockJumps++;
+				anchors.clear();
+				timeTagOfLastClockJump = anchor.timeTag;
+				afterClockJump = true;
+			}
+		}
+		anchors.push_back(anchor);
+		if (anchors.size() > 2) {
+			afterClockJump = false; // the first segment after the jump is complete
+		}
+		if (anchors.size() > MaximumNAnchors) {
+			anchors.pop_front();
+		}
+		nAnchors++;
+		mutex.unlock();
+	}
+
+public:
+	/** Fills unwrappedTimeTag, utcTime, and timeQualityFlags of events.
+	 * @param[in,out] events decoded events
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		mutex.lock();
+		for (size_t i = 0; i < events.size(); i++) {
+			const uint8_t boardIndex = events.boardIndex[i];
+			events.utcTime[i] = 0;
+			events.timeQualityFlags[i] = NoTimeModel;
+			if (boardIndex >= unwrappers.size()) {
+				events.unwrappedTimeTag[i] = events.timeTag[i];
+				continue;
+			}
+			const uint64_t time = unwrappers[boardIndex].unwrap(events.timeTag[i]);
+			events.unwrappedTimeTag[i] = time;
+			if (boardIndex != 0 || anchors.size() == 0) {
+				continue;
+			}
+			uint8_t flags = 0;
+			if (time > anchors.back().timeTag) {
+				flags |= Extrapolated;
+			}
+			if (anchors.size() == 1) {
+				flags |= NominalClockRate;
+			}
+			if (afterClockJump && time >= timeTagOfLastClockJump
+					&& (anchors.size() == 1 || time <= anchors[1].timeTag)) {
+				flags |= AfterClockJump;
+			}
+			events.utcTime[i] = toUTC(time);
+			events.timeQualityFlags[i] = flags;
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Called when the time tag counter of a board has been restarted (the board
+	 * was reprogrammed after link recovery). unwrappedTimeTag of the board
+	 * continues from the latest value. For the first board, the anchors are
+	 * discarded because they refer to the previous counter, and events are
+	 * flagged with TimeQuality::NoTimeModel until the next anchor is added.
+	 * @param[in] boardIndex index of the board
+	 */
+	void restartTimeTag(size_t boardIndex) {
+		mutex.lock();
+		if (boardIndex < unwrappers.size() && unwrappers[boardIndex].isInitialized()) {
+			unwrappers[boardIndex].restartFrom(unwrappers[boardIndex].getLatestUnwrappedTimeTag());
+		}
+		if (boardIndex == 0) {
+			anchors.clear();
+			afterClockJump = false;
+		}
+		mutex.unlock();
+	}
+
+public:
+	/** Returns the number of detected clock jumps.
+	 */
+	size_t getNClockJumps() const {
+		return nClockJumps;
+	}
+
+public:
+	/** Returns the number of anchors added so far.
+	 */
+	size_t getNAnchors() const {
+		return nAnchors;
+	}
+
+public:
+	/** Returns the ratio of the measured FPGA clock interval to the nominal one (1 if not measured yet).
+	 */
+	double getClockRateRatio() {
+		mutex.lock();
+		double ratio = 1.0;
+		if (anchors.size() >= 2) {
+			ratio = getSlope(anchors.size() - 2) / GROWTH_FY2015_ADC::ClockInterval;
+		}
+		mutex.unlock();
+		return ratio;
+	}
+
+private:
+	struct Anchor {
+		uint64_t timeTag; // unwrapped
+		double utcTime;
+	};
+
+private:
+	/** Returns seconds per clock of the segment between anchors[i] and anchors[i+1].
+	 */
+	double getSlope(size_t i) const {
+		return (anchors[i + 1].utcTime - anchors[i].utcTime)
+				/ static_cast<double>(anchors[i + 1].timeTag - anchors[i].timeTag);
+	}
+
+private:
+	double toUTC(uint64_t time) const {
+		if (anchors.size() == 1) {
+			return anchors[0].utcTime + timeDifference(time, anchors[0].timeTag) * GROWTH_FY2015_ADC::ClockInterval;
+		}
+		// find the segment (the latest segment is used for extrapolation)
+		size_t i = anchors.size() - 2;
+		while (i > 0 && time < anchors[i].timeTag) {
+			i--;
+		}
+		return anchors[i].utcTime + timeDifference(time, anchors[i].timeTag) * getSlope(i);
+	}
+
+private:
+	static double timeDifference(uint64_t a, uint64_t b) {
+		return (a >= b) ? static_cast<double>(a - b) : -static_cast<double>(b - a);
+	}
+
+private:
+	static const size_t MaximumNAnchors = 16;
+	std::vector<TimeTagUnwrapper> unwrappers; // per board (the first one also unwraps GPS time tags)
+	std::deque<Anchor> anchors;
+	double clockJumpThresholdInSec;
+	bool afterClockJump = false;
+	uint64_t timeTagOfLastClockJump = 0;
+	size_t nClockJumps = 0;
+	size_t nAnchors = 0;
+	CxxUtilities::Mutex mutex;
+};
+
+#endif /* SRC_TIMERECONSTRUCTOR_HH_ */
@@ -0,0 +1,155 @@
+#ifndef SRC_TRAPEZOIDALFILTER_HH_
+#define SRC_TRAPEZOIDALFILTER_HH_
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "GROWTH_FY2015_ADCModules/EventBatch.hh"
+
+/** Trapezoidal shaping filter applied to waveforms in software.
+ * The recursive algorithm of Jordanov and Knoll (NIM A 345, 337 (1994)) is
+ * implemented in integer (fixed-point) arithmetic:
+ *   d[n] = v[n] - v[n-k] - v[n-l] + v[n-k-l]   (l = k + m)
+ *   p[n] = p[n-1] + d[n]
+ *   r[n] = p[n] * 2^8 + M * d[n]               (M in Q8 fixed point)
+ *   s[n] = s[n-1] + r[n]
+ * where k is the rise time, m the flat-top length, and M the pole-zero
+ * correction for the exponential decay of the preamplifier output
+ * (M = 1/(exp(1/tau)-1) for decay time constant tau in samples).
+ * The double difference d[n], which is independent per sample, is computed
+ * with NEON when available. The output is normalized by the filter gain so
+ * that EventBatch::filteredPHA is in the same unit as the ADC value, measured
+ * from the baseline (mean of the pre-trigger samples).
+ */
+class TrapezoidalFilter {
+public:
+	/** @param[in] riseTime rise time k of the trapezoid in samples
+	 * @param[in] flatTop flat-top length m of the trapezoid in samples
+	 * @param[in] decayTimeConstant decay time constant of the input pulse in samples (0 = step-like input,
+	 * no pole-zero correction)
+	 * @param[in] nBaselineSamples number of leading samples used to compute the baseline
+	 */
+	TrapezoidalFilter(size_t riseTime, size_t flatTop, double decayTimeConstant, size_t nBaselineSamples) :
+			k(std::max<size_t>(riseTime, 1)), l(std::max<size_t>(riseTime, 1) + flatTop), //
+			nBaselineSamples(std::max<size_t>(nBaselineSamples, 1)) {
+		if (decayTimeConstant > 0) {
+			const double m = 1.0 / (std::exp(1.0 / decayTimeConstant) - 1.0);
+			poleZeroQ8 = static_cast<int32_t>(m * (1 << FractionalBits) + 0.5);
+		}
+		padding = k + l;
+		x.assign(padding + SpaceFibreADC::MaxWaveformLength, 0);
+		d.assign(SpaceFibreADC::MaxWaveformLength, 0);
+		computeGain(decayTimeConstant);
+	}
+
+public:
+	/** Computes filtered pulse height of events.
+	 * @param[in,out] events decoded events
+	 */
+	void process(GROWTH_FY2015_ADC_Type::EventBatch& events) {
+		for (size_t i = 0; i < events.size(); i++) {
+			events.filteredPHA[i] = static_cast<float>(filter(events.getWaveform(i), events.nSamples[i]));
+		}
+	}
+
+public:
+	/** Applies the filter to a waveform, and returns the maximum of the filter output
+	 * normalized to ADC unit (0 if the waveform is not longer than the baseline region).
+	 */
+	double filter(const uint16_t* waveform, size_t n) {
+		if (n <= nBaselineSamples) {
+			return 0;
+		}
+		n = std::min(n, SpaceFibreADC::MaxWaveformLength);
+
+		// baseline-subtracted input; samples before the waveform are regarded as baseline
+		int32_t baselineSum = 0;
+		for (size_t i = 0; i < nBaselineSamples; i++) {
+			baselineSum += waveform[i];
+		}
+		const int32_t baseline = baselineSum / static_cast<int32_t>(nBaselineSamples);
+		int32_t* v = x.data() + padding;
+		for (size_t i = 0; i < n; i++) {
+			v[i] = static_cast<int32_t>(waveform[i]) - baseline;
+		}
+
+		computeDoubleDifference(v, n);
+
+		// recursive stages
+		int64_t maximum = 0;
+		if (poleZeroQ8 == 0) {
+			int32_t p = 0;
+			for (size_t i = 0; i < n; i++) {
+				p += d[i];
+				maximum = std::max<int64_t>(maximum, p);
+			}
+		} else {
+			int32_t p = 0;
+			int64_t s = 0;
+			for (size_t i = 0; i < n; i++) {
+				p += d[i];
+				s += (static_cast<int64_t>(p) << FractionalBits) + static_cast<int64_t>(poleZeroQ8) * d[i];
+				maximum = std::max(maximum, s);
+			}
+		}
+		return maximum / gain;
+	}
+
+public:
+	/** Returns the gain of the filter (filter output for a unit-height input pulse).
+	 */
+	double getGain() const {
+		return gain;
+	}
+
+private:
+	void computeDoubleDifference(const int32_t* v, size_t n) {
+		int32_t* out = d.data();
+		size_t i = 0;
+#ifdef __ARM_NEON
+		for (; i + 4 <= n; i += 4) {
+			const int32x4_t a = vsubq_s32(vld1q_s32(v + i), vld1q_s32(v + i - k));
+			const int32x4_t b = vsubq_s32(vld1q_s32(v + i - l), vld1q_s32(v + i - k - l));
+			vst1q_s32(out + i, vsubq_s32(a, b));
+		}
+#endif
+		for (; i < n; i++) {
+			out[i] = v[i] - v[i - k] - v[i - l] + v[i - k - l];
+		}
+	}
+
+private:
+	/** Determines the gain by filtering a noiseless pulse of known height.
+	 */
+	void computeGain(double decayTimeConstant) {
+		gain = 1;
+		const size_t n = std::min<size_t>(nBaselineSamples + 2 * l + k + 1, SpaceFibreADC::MaxWaveformLength);
+		std::vector<uint16_t> pulse(n, static_cast<uint16_t>(ReferenceBaseline));
+		for (size_t i = nBaselineSamples; i < n; i++) {
+			const double t = static_cast<double>(i - nBaselineSamples);
+			const double height =
+					(decayTimeConstant > 0) ? ReferenceHeight * std::exp(-t / decayTimeConstant) : ReferenceHeight;
+			pulse[i] = static_cast<uint16_t>(ReferenceBaseline + height + 0.5);
+		}
+		const double output = filter(pulse.data(), n);
+		gain = (output > 0) ? output / ReferenceHeight : 1;
+	}
+
+private:
+	static const size_t FractionalBits = 8;
+	static const uint16_t ReferenceBaseline = 1000;
+	static constexpr double ReferenceHeight = 10000.0;
+	size_t k;
+	size_t l;
+	size_t nBaselineSamples;
+	size_t padding;
+	int32_t poleZeroQ8 = 0;
+	double gain = 1;
+	std::vector<int32_t> x;
+	std::vector<int32_t> d;
+};
+
+#endif /* SRC_TRAPEZOIDALFILTER_HH_ */
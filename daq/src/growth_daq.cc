@@ -10,6 +10,9 @@ int main(int argc, char* argv[]) {
 	if (argc < 4) {
 		cout << "Provide UART device name (e.g. /dev/tty.usb-aaa-bbb), YAML configuration file, and exposure." << endl;
 		cout << endl;
+		cout << "To read multiple ADC boards, provide comma-separated device names (e.g. /dev/ttyUSB0,/dev/ttyUSB1)." << endl;
+		cout << "Board index (0, 1, ...) follows this order, and is recorded in boardIndexAndChannel." << endl;
+		cout << endl;
 		cout << "If zero or negative exposure is provided, the program pauses after boot." << endl;
 		cout << "An observation is started when it is receives the 'resume' command via ZeroMQ IPC socket." << endl;
 		::exit(-1);
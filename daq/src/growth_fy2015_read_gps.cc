@@ -57,6 +57,21 @@ int main(int argc, char* argv[]) {
 	}
 	cout << endl;
 
+	//---------------------------------------------
+	// Decode NMEA sentences
+	//---------------------------------------------
+	NMEAParser parser;
+	parser.feed(gpsDataFIFOReadData.data(), gpsDataFIFOReadData.size());
+	const NMEAParser::Fix& fix = parser.getFix();
+	cout << dec << setfill(' ');
+	cout << "NMEA sentences : " << parser.getNSentences() << " (discarded " << parser.getNDiscardedSentences() << ")"
+			<< endl;
+	cout << "Fix quality    : " << (uint32_t) fix.fixQuality << " (" << (uint32_t) fix.nSatellites << " satellites)"
+			<< endl;
+	cout << "Position       : " << setprecision(8) << fix.latitude << " deg, " << fix.longitude << " deg, "
+			<< fix.altitude << " m" << endl;
+	cout << "UTC (UNIX time): " << setprecision(12) << fix.utcTime << (fix.timeValid ? "" : " (no date)") << endl;
+
 	return 0;
 }
 
@@ -0,0 +1,85 @@
+/*
+ * benchmark_trapezoidal_filter.cc
+ *
+ * Measures the throughput of TrapezoidalFilter on synthetic waveforms, and
+ * compares the spread of the filtered pulse height with that of the raw
+ * maximum sample. No hardware is needed.
+ *
+ * Build and run with the default arguments (on Raspberry Pi 3, NEON is enabled by CMakeLists.txt):
+ *   make benchmark
+ * Usage:
+ *   benchmark_trapezoidal_filter [nSamples (default 512)] [required event rate in Hz (default 20000)]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "TrapezoidalFilter.hh"
+
+static const size_t PreTriggerSamples = 16;
+static const size_t NumberOfWaveforms = 1000;
+static const size_t NumberOfIterations = 100;
+static const double PulseHeight = 300;
+static const double DecayTimeConstant = 100;
+static const double NoiseSigma = 3;
+static const double Baseline = 500;
+
+static double standardDeviation(const std::vector<double>& values) {
+  double sum = 0, sum2 = 0;
+  for (auto v : values) {
+    sum += v;
+    sum2 += v * v;
+  }
+  const double mean = sum / values.size();
+  return std::sqrt(sum2 / values.size() - mean * mean);
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  const size_t nSamples          = (argc > 1) ? atoi(argv[1]) : 512;
+  const double requiredEventRate = (argc > 2) ? atof(argv[2]) : 20000;
+
+  // generate waveforms (exponentially decaying pulses with Gaussian noise)
+  std::mt19937 engine(1);
+  std::normal_distribution<double> noise(0, NoiseSigma);
+  std::vector<uint16_t> waveform(nSamples);
+  GROWTH_FY2015_ADC_Type::EventBatch events;
+  std::vector<double> rawMaximum;
+  for (size_t i = 0; i < NumberOfWaveforms; i++) {
+    uint16_t maximum = 0;
+    for (size_t o = 0; o < nSamples; o++) {
+      double value = Baseline + noise(engine);
+      if (o >= PreTriggerSamples) { value += PulseHeight * std::exp(-(o - PreTriggerSamples) / DecayTimeConstant); }
+      waveform[o] = static_cast<uint16_t>(value + 0.5);
+      maximum     = std::max(maximum, waveform[o]);
+    }
+    rawMaximum.push_back(maximum - Baseline);
+    events.setWaveform(events.appendEvent(), waveform.data(), nSamples);
+  }
+
+  TrapezoidalFilter filter(16, 8, DecayTimeConstant, PreTriggerSamples);
+
+  // throughput
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < NumberOfIterations; i++) { filter.process(events); }
+  const auto end         = std::chrono::steady_clock::now();
+  const double elapsed   = std::chrono::duration<double>(end - start).count();
+  const double eventRate = NumberOfWaveforms * NumberOfIterations / elapsed;
+
+  // resolution
+  std::vector<double> filteredPHA(events.filteredPHA.begin(), events.filteredPHA.end());
+
+  cout << "nSamples                 : " << nSamples << endl;
+  cout << "Processed events         : " << NumberOfWaveforms * NumberOfIterations << endl;
+  cout << "Elapsed time             : " << elapsed << " s" << endl;
+  cout << "Throughput               : " << eventRate << " events/s" << endl;
+  cout << "Raw maximum (sigma)      : " << standardDeviation(rawMaximum) << endl;
+  cout << "Filtered PHA (sigma)     : " << standardDeviation(filteredPHA) << endl;
+  if (eventRate < requiredEventRate) {
+    cout << "FAILED: throughput is below the required event rate " << requiredEventRate << " Hz" << endl;
+    return 1;
+  }
+  cout << "OK: throughput exceeds the required event rate " << requiredEventRate << " Hz" << endl;
+  return 0;
+}
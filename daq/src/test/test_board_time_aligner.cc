@@ -0,0 +1,230 @@
+/*
+ * test_board_time_aligner.cc
+ *
+ * Simulates two boards whose 40-bit time tag counters start far apart (and
+ * one of which wraps around), latches their offsets at synthetic PPS edges
+ * with BoardTimeAligner, and checks that TimeOrderedEventMerger receives the
+ * events of both boards on one time base: no false late event, output in
+ * time order, and aligned time tags follow the true time, also across clock
+ * drift and restart of either counter. No hardware is needed.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "BoardTimeAligner.hh"
+#include "TimeOrderedEventMerger.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+static const uint64_t TimeTagModulo = TimeTagUnwrapper::TimeTagModulo;
+static const uint64_t TimeTagMask   = TimeTagUnwrapper::TimeTagMask;
+static const double UTC0            = 1700000000;  // 2023-11-14
+static const uint64_t ClocksPerSec  = static_cast<uint64_t>(std::llround(1 / GROWTH_FY2015_ADC::ClockInterval));
+static const uint64_t ReadoutWindow = ClocksPerSec / 100;  // events popped from the readers every 10 ms
+static const double LatencyInSec    = 0.05;
+
+/** Time tag counter of a board; true time is in clocks of the first board since its counter started.
+ */
+struct Counter {
+  uint64_t origin;      // counter value at originTime
+  uint64_t originTime;  // true time
+  double rateOffset;    // relative to the first board
+
+  uint64_t at(uint64_t trueTime) const {
+    const double elapsed = static_cast<double>(trueTime - originTime) * (1 + rateOffset);
+    return (origin + static_cast<uint64_t>(std::llround(elapsed))) & TimeTagMask;
+  }
+
+  /** The board is reprogrammed (link recovery); the counter starts from 0.
+   */
+  void restart(uint64_t trueTime) {
+    origin     = 0;
+    originTime = trueTime;
+  }
+};
+
+struct Scenario {
+  Counter counters[2];
+  bool aligned;
+  int restartedBoard;    // -1 = none
+  uint64_t restartTime;  // true time
+  double runLengthInSec;
+};
+
+struct Result {
+  size_t nEvents;
+  uint64_t nLateEvents;
+  bool timeOrdered;
+  uint64_t maxError;  // aligned time tag vs true time (clocks), after the offsets are latched again
+};
+
+/** Returns the difference of two time tags (mod 2^40) as a distance.
+ */
+static uint64_t distance(uint64_t a, uint64_t b) {
+  const uint64_t d = (a - b) & TimeTagMask;
+  return (d < TimeTagModulo / 2) ? d : TimeTagModulo - d;
+}
+
+static Result run(Scenario scenario) {
+  std::mt19937 rng(12345);
+  BoardTimeAligner aligner(2);
+  TimeOrderedEventMerger merger(2, LatencyInSec);
+  GROWTH_FY2015_ADC_Type::EventBatch received, released;
+  Result result{0, 0, true, 0};
+  const uint64_t startTime   = scenario.counters[0].originTime;
+  const uint64_t commonStart = scenario.counters[0].origin;  // common time base is the counter of the first board
+  const uint64_t endTime     = startTime + static_cast<uint64_t>(scenario.runLengthInSec * ClocksPerSec);
+  uint64_t nextPPS           = startTime;
+  bool restarted             = false;
+  bool relatched             = (scenario.restartedBoard < 0);
+
+  for (uint64_t windowStart = startTime; windowStart < endTime; windowStart += ReadoutWindow) {
+    if (scenario.restartedBoard >= 0 && !restarted && windowStart >= scenario.restartTime) {
+      // events before the restart have been flushed (MainThread::recoverLinks())
+      merger.flush(released);
+      scenario.counters[scenario.restartedBoard].restart(scenario.restartTime);
+      if (scenario.aligned) { aligner.restart(scenario.restartedBoard); }
+      restarted = true;
+    }
+    if (windowStart >= nextPPS) {
+      // GPS Time Registers latched at the same PPS, read after it
+      const double utcTime = UTC0 + static_cast<double>(nextPPS - startTime) / ClocksPerSec;
+      if (scenario.aligned) {
+        aligner.latch(0, scenario.counters[0].at(nextPPS), utcTime);
+        aligner.latch(1, scenario.counters[1].at(nextPPS), utcTime);
+        relatched = relatched || restarted;
+      }
+      nextPPS += ClocksPerSec;
+    }
+    // events of each board, in the EventFIFO order; true time is carried in unwrappedTimeTag
+    received.clear();
+    for (uint8_t board = 0; board < 2; board++) {
+      std::vector<uint64_t> times;
+      for (size_t n = rng() % 20; n > 0; n--) { times.push_back(windowStart + rng() % ReadoutWindow); }
+      std::sort(times.begin(), times.end());
+      for (auto trueTime : times) {
+        const size_t i               = received.appendEvent();
+        received.boardIndex[i]       = board;
+        received.ch[i]               = rng() % SpaceFibreADC::NumberOfChannels;
+        received.timeTag[i]          = scenario.counters[board].at(trueTime);
+        received.unwrappedTimeTag[i] = trueTime;
+      }
+    }
+    if (scenario.aligned) {
+      aligner.align(received);
+      if (relatched) {
+        for (size_t i = 0; i < received.size(); i++) {
+          const uint64_t expected = (commonStart + received.unwrappedTimeTag[i] - startTime) & TimeTagMask;
+          result.maxError         = std::max(result.maxError, distance(received.timeTag[i], expected));
+        }
+      }
+    }
+    merger.push(received);
+    merger.pop(released);
+  }
+  merger.flush(released);
+
+  result.nEvents     = released.size();
+  result.nLateEvents = merger.getNLateEvents();
+  TimeTagUnwrapper unwrapper;
+  uint64_t previous = 0;
+  for (size_t i = 0; i < released.size(); i++) {
+    const uint64_t time = unwrapper.unwrap(released.timeTag[i]);
+    if (time < previous) { result.timeOrdered = false; }
+    previous = time;
+  }
+  return result;
+}
+
+static Scenario makeScenario(uint64_t origin1, double rateOffset1, bool aligned) {
+  Scenario scenario;
+  scenario.counters[0]    = Counter{1000, 0, 0};
+  scenario.counters[1]    = Counter{origin1, 0, rateOffset1};
+  scenario.aligned        = aligned;
+  scenario.restartedBoard = -1;
+  scenario.restartTime    = 0;
+  scenario.runLengthInSec = 5;
+  return scenario;
+}
+
+static void testCountersFarApart() {
+  const uint64_t farAhead = 300000000000ULL;  // about 50 minutes of clocks
+  Result unaligned        = run(makeScenario(farAhead, 0, false));
+  check(unaligned.nLateEvents > 0, "unaligned counters far apart: events of the first board are late (sanity check)");
+
+  Result aligned = run(makeScenario(farAhead, 0, true));
+  check(aligned.nLateEvents == 0, "counters far apart: no late event");
+  check(aligned.timeOrdered, "counters far apart: merged in time order");
+  check(aligned.maxError <= 1, "counters far apart: aligned time tags follow the true time");
+  check(aligned.nEvents == unaligned.nEvents, "counters far apart: all events released");
+
+  // the second board wraps around 2 s after the start
+  Result wrapped = run(makeScenario(TimeTagModulo - 2 * ClocksPerSec, 0, true));
+  check(wrapped.nLateEvents == 0 && wrapped.timeOrdered, "counter wrapping around: no late event, time order kept");
+  check(wrapped.maxError <= 1, "counter wrapping around: aligned time tags follow the true time");
+}
+
+static void testDrift() {
+  const double rateOffset = 20e-6;  // oscillators differ by 20 ppm
+  Result drifting         = run(makeScenario(123456789ULL, rateOffset, true));
+  check(drifting.nLateEvents == 0 && drifting.timeOrdered, "clock drift: no late event, time order kept");
+  check(drifting.maxError <= static_cast<uint64_t>(rateOffset * ClocksPerSec) + 1,
+        "clock drift: error bounded by the drift within one PPS interval (" + std::to_string(drifting.maxError) +
+            " clocks)");
+}
+
+static void testRestart() {
+  for (int board = 0; board < 2; board++) {
+    Scenario scenario       = makeScenario(300000000000ULL, 0, true);
+    scenario.restartedBoard = board;
+    scenario.restartTime    = 2 * ClocksPerSec + ClocksPerSec / 2;  // between PPS edges
+    Result result           = run(scenario);
+    const std::string label = "restart of board " + std::to_string(board) + ": ";
+    check(result.nLateEvents == 0 && result.timeOrdered, label + "no late event, time order kept");
+    check(result.maxError <= 1, label + "common time base continues after the offset is latched again");
+  }
+}
+
+static void testLatch() {
+  BoardTimeAligner aligner(2);
+  check(!aligner.latch(1, 5000, UTC0), "second board not latched before the first board");
+  check(aligner.latch(0, 1000, UTC0) && aligner.isLatched(0), "first board latched");
+  check(!aligner.latch(1, 5000, UTC0 + 1), "second board latched at another PPS rejected");
+  check(aligner.latch(1, 5000, UTC0) && aligner.getOffset(1) == ((1000 - 5000) & TimeTagMask),
+        "offset of the second board");
+  check(!aligner.latch(2, 5000, UTC0), "invalid board index rejected");
+
+  // continuity until the offset is latched again
+  GROWTH_FY2015_ADC_Type::EventBatch events;
+  size_t i             = events.appendEvent();
+  events.boardIndex[i] = 0;
+  events.timeTag[i]    = 900000;
+  aligner.restart(1);
+  check(!aligner.isLatched(1), "restarted board is not latched");
+  i                    = events.appendEvent();
+  events.boardIndex[i] = 1;
+  events.timeTag[i]    = 10;
+  aligner.align(events);
+  check(events.timeTag[0] == 900000, "first board: offset 0");
+  check(events.timeTag[1] == 900000, "restarted board placed at the latest aligned time tag");
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  testLatch();
+  testCountersFarApart();
+  testDrift();
+  testRestart();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
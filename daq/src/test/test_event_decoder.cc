@@ -0,0 +1,166 @@
+/*
+ * test_event_decoder.cc
+ *
+ * Encodes synthetic event packets (1, 4 and 100 waveform samples, mixed
+ * lengths, and garbage words between packets), feeds them to EventDecoder
+ * in reads of random length as RMAP reads of the EventFIFO would, and checks
+ * the decoded events against the generated ones. The same stream is decoded
+ * both by the state machine and by the fixed-stride path
+ * (setNSamplesInEventPacket()), which have to give identical results.
+ * No hardware is needed.
+ */
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include "GROWTH_FY2015_ADCModules/EventDecoder.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+static const uint32_t FPGAVersion      = 0x20171031;
+static const uint16_t StartFlag        = EventPacketFormat::Format20151016::StartFlag;
+static const uint16_t Terminator       = EventPacketFormat::Format20151016::Terminator;
+static const size_t NumberOfPackets    = 5000;
+static const size_t NumberOfSplitSeeds = 5;
+
+/** Appends a packet of a random event with nSamples samples to words, and the event to expected.
+ */
+static void appendPacket(std::mt19937& random, size_t nSamples, std::vector<uint16_t>& words,
+                         GROWTH_FY2015_ADC_Type::EventBatch& expected) {
+  std::uniform_int_distribution<uint16_t> word(0, 0xFFEF);  // flags do not appear in headers and samples
+  std::uniform_int_distribution<uint16_t> sample(0, 4095);
+  const size_t i            = expected.appendEvent();
+  expected.ch[i]            = random() % SpaceFibreADC::NumberOfChannels;
+  expected.timeTag[i]       = (static_cast<uint64_t>(random() % 0xF0) << 32) + (random() & 0xFFFFFFFF);
+  expected.triggerCount[i]  = word(random);
+  expected.phaMax[i]        = sample(random);
+  expected.phaMaxTime[i]    = word(random);
+  expected.phaMin[i]        = sample(random);
+  expected.phaFirst[i]      = sample(random);
+  expected.phaLast[i]       = sample(random);
+  expected.maxDerivative[i] = word(random);
+  expected.baseline[i]      = sample(random);
+  std::vector<uint16_t> waveform(nSamples);
+  for (auto& s : waveform) { s = sample(random); }
+  expected.setWaveform(i, waveform.data(), nSamples);
+
+  const uint64_t timeTag = expected.timeTag[i];
+  words.push_back(StartFlag);
+  words.push_back((expected.ch[i] << 8) | (timeTag >> 32));
+  words.push_back((timeTag >> 16) & 0xFFFF);
+  words.push_back(timeTag & 0xFFFF);
+  words.push_back(word(random));  // reserved
+  words.push_back(expected.triggerCount[i]);
+  words.push_back(expected.phaMax[i]);
+  words.push_back(expected.phaMaxTime[i]);
+  words.push_back(expected.phaMin[i]);
+  words.push_back(expected.phaFirst[i]);
+  words.push_back(expected.phaLast[i]);
+  words.push_back(expected.maxDerivative[i]);
+  words.push_back(expected.baseline[i]);
+  words.insert(words.end(), waveform.begin(), waveform.end());
+  words.push_back(Terminator);
+}
+
+/** Generates a stream of packets. Most packets have nSamples samples; if mixed,
+ * some have other lengths (e.g. left in the EventFIFO after SamplesInEventPacket
+ * was changed) and some are preceded by garbage words.
+ */
+static std::vector<uint8_t> generateStream(size_t nSamples, bool mixed,
+                                           GROWTH_FY2015_ADC_Type::EventBatch& expected) {
+  std::mt19937 random(static_cast<uint32_t>(nSamples * 2 + mixed));
+  std::vector<uint16_t> words;
+  for (size_t k = 0; k < NumberOfPackets; k++) {
+    size_t n = nSamples;
+    if (mixed && random() % 10 == 0) { n = random() % 200; }
+    if (mixed && random() % 50 == 0) {
+      for (size_t g = random() % 5 + 1; g > 0; g--) { words.push_back(random() % 0xFFF0); }
+    }
+    appendPacket(random, n, words, expected);
+  }
+  std::vector<uint8_t> bytes;
+  for (auto w : words) {
+    bytes.push_back(w >> 8);
+    bytes.push_back(w & 0xFF);
+  }
+  return bytes;
+}
+
+/** Decodes a byte stream split into reads of random length (even number of bytes).
+ * @param[in] nSamplesInEventPacket 0 = the fixed-stride path is not used
+ */
+static GROWTH_FY2015_ADC_Type::EventBatch decode(const std::vector<uint8_t>& bytes, size_t nSamplesInEventPacket,
+                                                 uint32_t splitSeed) {
+  EventDecoder* decoder = EventDecoder::create(FPGAVersion);
+  if (nSamplesInEventPacket != 0) { decoder->setNSamplesInEventPacket(nSamplesInEventPacket); }
+  std::mt19937 random(splitSeed);
+  GROWTH_FY2015_ADC_Type::EventBatch events;
+  std::vector<uint8_t> read;
+  size_t position = 0;
+  while (position < bytes.size()) {
+    // mostly short reads (a header or a sample split over reads), sometimes long ones
+    size_t length = 2 * (1 + random() % 40);
+    if (random() % 10 == 0) { length = 2 * (1 + random() % 3000); }
+    length = std::min(length, bytes.size() - position);
+    read.assign(bytes.begin() + position, bytes.begin() + position + length);
+    position += length;
+    decoder->decodeEvent(&read);
+    decoder->popDecodedEvents(events);
+  }
+  delete decoder;
+  return events;
+}
+
+/** Returns the number of events which differ (all columns and waveform samples).
+ */
+static size_t countMismatches(const GROWTH_FY2015_ADC_Type::EventBatch& a,
+                              const GROWTH_FY2015_ADC_Type::EventBatch& b) {
+  if (a.size() != b.size()) { return std::max(a.size(), b.size()); }
+  size_t nMismatches = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    bool same = a.ch[i] == b.ch[i] && a.timeTag[i] == b.timeTag[i] && a.triggerCount[i] == b.triggerCount[i] &&
+                a.phaMax[i] == b.phaMax[i] && a.phaMaxTime[i] == b.phaMaxTime[i] && a.phaMin[i] == b.phaMin[i] &&
+                a.phaFirst[i] == b.phaFirst[i] && a.phaLast[i] == b.phaLast[i] &&
+                a.maxDerivative[i] == b.maxDerivative[i] && a.baseline[i] == b.baseline[i] &&
+                a.nSamples[i] == b.nSamples[i];
+    for (size_t k = 0; same && k < a.nSamples[i]; k++) { same = a.getWaveform(i)[k] == b.getWaveform(i)[k]; }
+    if (!same) { nMismatches++; }
+  }
+  return nMismatches;
+}
+
+static void testStream(size_t nSamples, bool mixed) {
+  GROWTH_FY2015_ADC_Type::EventBatch expected;
+  const std::vector<uint8_t> bytes = generateStream(nSamples, mixed, expected);
+  const std::string label          = std::to_string(nSamples) + " samples" + (mixed ? " (mixed lengths, garbage)" : "");
+  size_t nMismatchesOfStateMachine = 0, nMismatchesOfFixedStride = 0, nDifferences = 0;
+  for (uint32_t seed = 0; seed < NumberOfSplitSeeds; seed++) {
+    const auto stateMachine = decode(bytes, 0, seed);
+    const auto fixedStride  = decode(bytes, nSamples, seed);
+    nMismatchesOfStateMachine += countMismatches(stateMachine, expected);
+    nMismatchesOfFixedStride += countMismatches(fixedStride, expected);
+    nDifferences += countMismatches(stateMachine, fixedStride);
+  }
+  check(nMismatchesOfStateMachine == 0, label + ": state machine decodes all packets");
+  check(nMismatchesOfFixedStride == 0, label + ": fixed-stride path decodes all packets");
+  check(nDifferences == 0, label + ": state machine and fixed-stride path agree");
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  for (size_t nSamples : {1, 4, 100}) {
+    testStream(nSamples, false);
+    testStream(nSamples, true);
+  }
+  Logger::flush();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
@@ -144,22 +144,23 @@ class MainThread : public CxxUtilities::StoppableThread {
     const size_t canvasUpdateCounterMax = 10;
 #endif
 
+    GROWTH_FY2015_ADC_Type::EventBatch events;
     while (nEvents < nEventsMax) {
-      std::vector<GROWTH_FY2015_ADC_Type::Event*> events = adcBoard->getEvent();
+      events.clear();
+      adcBoard->getEvents(events);
       cout << "Received " << events.size() << " events" << endl;
-      for (auto event : events) {
+      for (size_t i = 0; i < events.size(); i++) {
         /*
-         cout << (uint32_t) event->ch << endl;
-         for (size_t i = 0; i < event->nSamples; i++) {
-         cout << dec << (uint32_t) event->waveform[i] << " ";
+         cout << (uint32_t) events.ch[i] << endl;
+         for (size_t o = 0; o < events.nSamples[i]; o++) {
+         cout << dec << (uint32_t) events.getWaveform(i)[o] << " ";
          }
          cout << dec << endl;
          */
-        hist->Fill(event->phaMax);
+        hist->Fill(events.phaMax[i]);
       }
       nEvents += events.size();
       cout << events.size() << " events (" << nEvents << ")" << endl;
-      adcBoard->freeEvents(events);
       c.wait(100);
 #ifdef DRAW_CANVAS
       canvasUpdateCounter++;
@@ -0,0 +1,21 @@
+require "ffi-rzmq"
+
+# Sends getStatus in the binary encoding (see BinaryMessage.hh)
+MAGIC = 0xC7
+SCHEMA_VERSION = 1
+COMMAND_GET_STATUS = 5
+
+context = ZMQ::Context.new
+socket  = context.socket(ZMQ::REQ)
+socket.connect("tcp://localhost:10020")
+
+socket.send_string([MAGIC, SCHEMA_VERSION, COMMAND_GET_STATUS, 0].pack("C4"))
+reply = ""
+socket.recv_string(reply)
+
+magic, version, command, status, unix_time = reply.unpack("C4V")
+puts "schemaVersion=#{version} command=#{command} status=#{status} unixTime=#{unix_time}"
+if(status == 0)then
+	daq_status, connected, burst, gps, elapsed, n_events = reply[8..-1].unpack("C4VQ<")
+	puts "daqStatus=#{daq_status} boardConnected=#{connected} elapsedTime=#{elapsed} nEvents=#{n_events}"
+end
@@ -0,0 +1,162 @@
+/*
+ * test_nmea_parser.cc
+ *
+ * Feeds NMEA sentences to NMEAParser in various chunkings (as read from the
+ * GPS Data FIFO), and checks the decoded GGA/RMC/ZDA fields, checksum
+ * verification, truncated sentences, and the date rollover at midnight.
+ * No hardware is needed.
+ */
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include "NMEAParser.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+static const double UnixTimeOf20231114 = 1699920000;  // 2023-11-14 00:00:00 UTC
+static const double SecondsPerDay      = 86400;
+
+/** Returns "$" + body + "*hh\r\n" with the checksum of body.
+ */
+static std::string sentence(const std::string& body) {
+  uint8_t checksum = 0;
+  for (auto c : body) { checksum ^= static_cast<uint8_t>(c); }
+  char suffix[8];
+  snprintf(suffix, sizeof(suffix), "*%02X\r\n", checksum);
+  return "$" + body + suffix;
+}
+
+static size_t feed(NMEAParser& parser, const std::string& data) {
+  return parser.feed(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+static const std::string GGA = sentence("GPGGA,123519.00,4807.038,N,01131.000,W,1,08,0.9,545.4,M,46.9,M,,");
+static const std::string RMC = sentence("GPRMC,123520.00,A,4807.038,N,01131.000,W,022.4,084.4,141123,003.1,W");
+static const std::string ZDA = sentence("GPZDA,123521.00,14,11,2023,00,00");
+
+static void checkStreamResult(const NMEAParser& parser, const std::string& label) {
+  const NMEAParser::Fix& fix = parser.getFix();
+  check(parser.getNSentences() == 3 && parser.getNDiscardedSentences() == 0, label + ": 3 sentences, none discarded");
+  check(fix.timeValid && fix.utcTime == UnixTimeOf20231114 + 12 * 3600 + 35 * 60 + 21, label + ": time of ZDA");
+  check(std::fabs(fix.latitude - (48 + 7.038 / 60)) < 1e-9, label + ": GGA latitude");
+  check(std::fabs(fix.longitude + (11 + 31.0 / 60)) < 1e-9, label + ": GGA longitude (west negative)");
+  check(fix.fixQuality == 1 && fix.nSatellites == 8, label + ": GGA fix quality and satellites");
+  check(fix.hdop == 0.9 && fix.altitude == 545.4, label + ": GGA HDOP and altitude");
+  check(fix.rmcValid, label + ": RMC status");
+  check(parser.hasValidFix(), label + ": valid fix");
+}
+
+static void testChunkBoundaries() {
+  const std::string stream = GGA + RMC + ZDA;
+  size_t nMismatches       = 0;
+  for (size_t split = 0; split <= stream.size(); split++) {
+    NMEAParser parser;
+    const size_t n             = feed(parser, stream.substr(0, split)) + feed(parser, stream.substr(split));
+    const NMEAParser::Fix& fix = parser.getFix();
+    if (n != 3 || parser.getNDiscardedSentences() != 0 ||
+        fix.utcTime != UnixTimeOf20231114 + 12 * 3600 + 35 * 60 + 21) {
+      nMismatches++;
+    }
+  }
+  check(nMismatches == 0, "stream split into two chunks at every position");
+
+  NMEAParser parser;
+  for (auto c : stream) { feed(parser, std::string(1, c)); }
+  checkStreamResult(parser, "one byte per chunk");
+
+  // a chunk boundary inside "\r\n"
+  NMEAParser parserCRLF;
+  feed(parserCRLF, GGA.substr(0, GGA.size() - 1));
+  feed(parserCRLF, "\n" + RMC + ZDA);
+  checkStreamResult(parserCRLF, "chunk boundary between CR and LF");
+}
+
+static void testTimeBeforeDate() {
+  NMEAParser parser;
+  check(feed(parser, GGA) == 1, "GGA interpreted");
+  check(!parser.getFix().timeValid && parser.getFix().utcTime == 0, "no date yet: time not valid");
+  check(!parser.hasValidFix(), "no date yet: no valid fix");
+  check(parser.getFix().fixQuality == 1, "position decoded without date");
+}
+
+static void testChecksum() {
+  NMEAParser parser;
+  feed(parser, ZDA);
+  std::string corrupted = GGA;
+  corrupted[20]         = (corrupted[20] == '1') ? '2' : '1';  // a digit of the latitude
+  check(feed(parser, corrupted) == 0, "corrupted sentence not interpreted");
+  check(parser.getNDiscardedSentences() == 1, "corrupted sentence counted as discarded");
+  check(parser.getFix().fixQuality == 0 && parser.getFix().latitude == 0, "fix not changed by the corrupted sentence");
+  check(feed(parser, "$GPGGA,123519.00,4807.038,N\r\n") == 0, "sentence without checksum not interpreted");
+  check(parser.getNDiscardedSentences() == 2, "sentence without checksum counted as discarded");
+  std::string lowerCase = GGA;
+  for (size_t i = lowerCase.rfind('*'); i < lowerCase.size(); i++) { lowerCase[i] = std::tolower(lowerCase[i]); }
+  check(feed(parser, lowerCase) == 1, "lower-case checksum accepted");
+  check(feed(parser, sentence("GNGGA,123519.00,4807.038,S,01131.000,E,2,10,0.8,10.0,M,46.9,M,,")) == 1,
+        "other talker ID (GN) accepted");
+  check(parser.getFix().latitude < 0 && parser.getFix().longitude > 0 && parser.getFix().fixQuality == 2,
+        "southern/eastern hemisphere decoded");
+  check(feed(parser, sentence("GPGSV,3,1,11,03,03,111,00")) == 0, "unsupported sentence ignored");
+  check(parser.getNSentences() == 4 && parser.getNDiscardedSentences() == 2, "sentence counters");
+}
+
+static void testTruncatedSentence() {
+  NMEAParser parser;
+  feed(parser, GGA.substr(0, 20));
+  check(feed(parser, ZDA) == 1, "sentence after a truncated one interpreted");
+  check(parser.getNDiscardedSentences() == 1, "truncated sentence counted as discarded");
+
+  // the FIFO was cleared between two reads
+  feed(parser, RMC.substr(0, 30));
+  parser.discardPartialSentence();
+  check(feed(parser, RMC.substr(30)) == 0, "rest of a discarded partial sentence ignored");
+  check(feed(parser, RMC) == 1, "next complete sentence interpreted");
+
+  feed(parser, "$GPGGA," + std::string(200, '0'));
+  check(parser.getNDiscardedSentences() == 2, "overlong sentence discarded");
+  feed(parser, std::string("$GPGGA,\x01") + "\r\n");
+  check(parser.getNDiscardedSentences() == 3, "sentence with a control character discarded");
+}
+
+static void testMidnightRollover() {
+  NMEAParser parser;
+  feed(parser, sentence("GPZDA,235959.00,14,11,2023,00,00"));
+  check(parser.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay - 1, "23:59:59 on the first day");
+  // GGA has no date; the date advances when the time of day wraps
+  feed(parser, sentence("GPGGA,000000.50,4807.038,N,01131.000,W,1,08,0.9,545.4,M,46.9,M,,"));
+  check(parser.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay + 0.5, "GGA after midnight on the next day");
+  feed(parser, sentence("GPGGA,000001.00,4807.038,N,01131.000,W,1,08,0.9,545.4,M,46.9,M,,"));
+  check(parser.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay + 1, "next GGA not advanced again");
+  // the receiver reports the new date
+  feed(parser, sentence("GPZDA,000002.00,15,11,2023,00,00"));
+  check(parser.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay + 2, "ZDA with the new date");
+  feed(parser, sentence("GPRMC,000003.00,A,4807.038,N,01131.000,W,022.4,084.4,151123,003.1,W"));
+  check(parser.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay + 3, "RMC with the new date");
+
+  // time of day increasing within the day does not move the date
+  NMEAParser parser2;
+  feed(parser2, sentence("GPRMC,235959.00,A,4807.038,N,01131.000,W,022.4,084.4,141123,003.1,W"));
+  feed(parser2, sentence("GPGGA,235959.50,4807.038,N,01131.000,W,1,08,0.9,545.4,M,46.9,M,,"));
+  check(parser2.getFix().utcTime == UnixTimeOf20231114 + SecondsPerDay - 0.5, "GGA before midnight stays on the day");
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  testChunkBoundaries();
+  testTimeBeforeDate();
+  testChecksum();
+  testTruncatedSentence();
+  testMidnightRollover();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * test_serial_reconnect.cc
+ *
+ * Simulates a glitch of the UART-USB adapter with a pseudo terminal, and
+ * follows the link recovery path of RMAPHandlerUART::reconnect(): the tty
+ * read error has to be reported to the reader, the SpaceWire interface has
+ * to be closed and deleted without leaving its I/O thread running, and a
+ * new interface opened with the same device name (the re-enumerated
+ * adapter) has to work. No hardware is needed.
+ */
+#include <dirent.h>
+#include <pty.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include "SpaceWireIFOverUART.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+/** Opens a pseudo terminal, and points deviceName at its slave side
+ * (like /dev/serial/by-id/... pointing at the current /dev/ttyUSBx).
+ * @return file descriptor of the master side (the "FPGA" end of the link)
+ */
+static int openPseudoTerminal(const std::string& deviceName) {
+  int master, slave;
+  char slaveName[256];
+  if (openpty(&master, &slave, slaveName, NULL, NULL) != 0) {
+    perror("openpty");
+    exit(-1);
+  }
+  ::close(slave);  // opened again by SerialPort
+  ::unlink(deviceName.c_str());
+  if (symlink(slaveName, deviceName.c_str()) != 0) {
+    perror("symlink");
+    exit(-1);
+  }
+  return master;
+}
+
+/** Returns the number of entries in a directory (e.g. threads in /proc/self/task).
+ */
+static size_t countEntries(const std::string& directory) {
+  size_t n = 0;
+  DIR* dir = opendir(directory.c_str());
+  while (dir != NULL && readdir(dir) != NULL) { n++; }
+  if (dir != NULL) { closedir(dir); }
+  return n;
+}
+
+static std::vector<uint8_t> readFromMaster(int master, size_t length) {
+  std::vector<uint8_t> data(length);
+  size_t n = 0;
+  while (n < length) {
+    const ssize_t result = ::read(master, data.data() + n, length - n);
+    if (result <= 0) { break; }
+    n += result;
+  }
+  data.resize(n);
+  return data;
+}
+
+/** Sends a packet in both directions over an opened interface.
+ */
+static bool exchangePacket(SpaceWireIFOverUART* spwif, int master) {
+  std::vector<uint8_t> packet = {0xFE, 0x01, 0x4C, 0x00};
+  spwif->send(packet.data(), packet.size());
+  std::vector<uint8_t> frame = {0x00, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0, static_cast<uint8_t>(packet.size())};
+  frame.insert(frame.end(), packet.begin(), packet.end());
+  if (readFromMaster(master, frame.size()) != frame) { return false; }
+  if (::write(master, frame.data(), frame.size()) != static_cast<ssize_t>(frame.size())) { return false; }
+  std::vector<uint8_t> received;
+  spwif->receive(&received);
+  return received == packet;
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  alarm(60);  // a hung I/O thread fails the test instead of blocking forever
+  const std::string deviceName = "/tmp/test_serial_reconnect_" + std::to_string(getpid());
+
+  Logger::flush();  // starts the writer thread of Logger before threads are counted
+  const size_t nThreads = countEntries("/proc/self/task");
+  const size_t nFiles   = countEntries("/proc/self/fd");
+
+  // the link works
+  int master                 = openPseudoTerminal(deviceName);
+  SpaceWireIFOverUART* spwif = new SpaceWireIFOverUART(deviceName);
+  spwif->open();
+  check(exchangePacket(spwif, master), "packet exchanged over the first link");
+
+  // a cancel request issued while data are buffered does not break a later receive()
+  SerialPort* serialPort = spwif->getSerialPort();
+  const uint8_t bytes[]  = {0x01, 0x02, 0x03};
+  if (::write(master, bytes, sizeof(bytes)) != sizeof(bytes)) { perror("write"); }
+  for (size_t i = 0; i < 100 && serialPort->getNBufferedBytes() != sizeof(bytes); i++) { usleep(10000); }
+  serialPort->cancelReceive();
+  uint8_t buffer[16];
+  check(serialPort->receive(buffer, sizeof(buffer)) == sizeof(bytes), "buffered data received after cancel");
+  serialPort->setTimeout(200);
+  int status = -1;
+  try {
+    serialPort->receive(buffer, sizeof(buffer));
+  } catch (SerialPortException& e) { status = e.getStatus(); }
+  check(status == SerialPortException::Timeout, "cancel request cleared (next receive() timed out)");
+  serialPort->setTimeout(1000);
+
+  // the adapter disappears; the tty returns a read error
+  ::close(master);
+  status = -1;
+  std::vector<uint8_t> received;
+  try {
+    spwif->receive(&received);
+  } catch (SpaceWireIFException& e) { status = e.getStatus(); }
+  check(status == SpaceWireIFException::Disconnected, "read error reported as Disconnected");
+
+  // recovery (as RMAPHandlerUART::reconnect()): the failed interface is closed and deleted
+  spwif->close();
+  delete spwif;
+  check(countEntries("/proc/self/task") == nThreads, "I/O thread of the failed interface joined");
+  check(countEntries("/proc/self/fd") == nFiles, "tty of the failed interface closed");
+
+  // the adapter comes back with the same device name
+  master = openPseudoTerminal(deviceName);
+  spwif  = new SpaceWireIFOverUART(deviceName);
+  spwif->open();
+  check(exchangePacket(spwif, master), "packet exchanged over the reopened link");
+
+  spwif->close();
+  delete spwif;
+  ::close(master);
+  ::unlink(deviceName.c_str());
+
+  Logger::flush();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * test_ssdtp_resync.cc
+ *
+ * Writes SSDTP frames to a pseudo terminal and checks the deframer of
+ * SpaceWireSSDTPModuleUART: a frame truncated on the line (the rest never
+ * comes) has to be discarded as a whole when the serial port times out, so
+ * that the next frame is received immediately, and a frame whose rest
+ * arrives within the timeout has to be received intact. No hardware is
+ * needed.
+ */
+#include <pty.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "SpaceWireIFOverUART.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+static const double TimeoutInMicrosec = 200000;
+
+/** Opens a pseudo terminal, and points deviceName at its slave side.
+ * @return file descriptor of the master side (the "FPGA" end of the link)
+ */
+static int openPseudoTerminal(const std::string& deviceName) {
+  int master, slave;
+  char slaveName[256];
+  if (openpty(&master, &slave, slaveName, NULL, NULL) != 0) {
+    perror("openpty");
+    exit(-1);
+  }
+  ::close(slave);  // opened again by SerialPort
+  ::unlink(deviceName.c_str());
+  if (symlink(slaveName, deviceName.c_str()) != 0) {
+    perror("symlink");
+    exit(-1);
+  }
+  return master;
+}
+
+/** Returns an SSDTP frame (EOP) carrying packet.
+ */
+static std::vector<uint8_t> frameOf(const std::vector<uint8_t>& packet) {
+  std::vector<uint8_t> frame = {0x00, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, static_cast<uint8_t>(packet.size() >> 8),
+                                static_cast<uint8_t>(packet.size() & 0xFF)};
+  frame.insert(frame.end(), packet.begin(), packet.end());
+  return frame;
+}
+
+static void writeToMaster(int master, const std::vector<uint8_t>& data) {
+  if (::write(master, data.data(), data.size()) != static_cast<ssize_t>(data.size())) { perror("write"); }
+}
+
+/** Calls receive(), and returns the elapsed time in second.
+ * @param[out] timedOut true if receive() timed out
+ */
+static double receive(SpaceWireIFOverUART* spwif, std::vector<uint8_t>& received, bool& timedOut) {
+  const auto start = std::chrono::steady_clock::now();
+  timedOut         = false;
+  received.clear();
+  try {
+    spwif->receive(&received);
+  } catch (SpaceWireIFException& e) { timedOut = (e.getStatus() == SpaceWireIFException::Timeout); }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  alarm(60);  // a hung receive() fails the test instead of blocking forever
+  const std::string deviceName = "/tmp/test_ssdtp_resync_" + std::to_string(getpid());
+  const double timeoutInSec    = TimeoutInMicrosec / 1e6;
+
+  const int master           = openPseudoTerminal(deviceName);
+  SpaceWireIFOverUART* spwif = new SpaceWireIFOverUART(deviceName);
+  spwif->open();
+  spwif->setTimeoutDuration(TimeoutInMicrosec);
+  SpaceWireSSDTPModuleUART* ssdtp = spwif->getSSDTPModule();
+
+  std::vector<uint8_t> packet(100);
+  for (size_t i = 0; i < packet.size(); i++) { packet[i] = i; }
+  const std::vector<uint8_t> frame = frameOf(packet);
+  std::vector<uint8_t> received;
+  bool timedOut;
+
+  // a frame whose rest arrives within the timeout
+  writeToMaster(master, std::vector<uint8_t>(frame.begin(), frame.begin() + 30));
+  usleep(TimeoutInMicrosec / 4);
+  writeToMaster(master, std::vector<uint8_t>(frame.begin() + 30, frame.end()));
+  receive(spwif, received, timedOut);
+  check(!timedOut && received == packet, "frame split by a short pause received");
+  check(ssdtp->getNResyncs() == 0, "no resynchronization for a short pause");
+
+  // a truncated frame; zero bytes of the lost payload look like valid headers of empty frames
+  std::vector<uint8_t> truncated = frameOf(std::vector<uint8_t>(200, 0x00));
+  truncated.resize(12 + 42);
+  writeToMaster(master, truncated);
+  double elapsed = receive(spwif, received, timedOut);
+  check(timedOut, "truncated frame: receive() timed out");
+  check(elapsed < 2 * timeoutInSec, "truncated frame: discarded within one timeout (" + std::to_string(elapsed) + " s)");
+  check(ssdtp->getNResyncs() == 1, "truncated frame counted as one resynchronization");
+  check(ssdtp->getNDiscardedBytes() == truncated.size(), "all bytes of the truncated frame discarded");
+
+  // the next frame is received without waiting for another timeout
+  writeToMaster(master, frame);
+  elapsed = receive(spwif, received, timedOut);
+  check(!timedOut && received == packet, "frame after the truncated one received");
+  check(elapsed < timeoutInSec, "frame after the truncated one received without delay");
+  check(ssdtp->getNReceivedFrames() == 2 && ssdtp->getNResyncs() == 1, "frame counters");
+
+  spwif->close();
+  delete spwif;
+  ::close(master);
+  ::unlink(deviceName.c_str());
+
+  Logger::flush();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}
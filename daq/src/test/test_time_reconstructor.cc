@@ -0,0 +1,170 @@
+/*
+ * test_time_reconstructor.cc
+ *
+ * Feeds synthetic GPS anchors (FPGA time tag latched at PPS, UTC) and event
+ * time tags to TimeReconstructor, and checks the reconstructed UTC and the
+ * time quality flags: no model, nominal clock rate, interpolation and
+ * extrapolation, 40-bit wraparound, clock jumps, and restart of the time
+ * tag counter. No hardware is needed.
+ */
+#include <cmath>
+#include <cstdio>
+#include "TimeReconstructor.hh"
+
+static size_t nFailures = 0;
+
+static void check(bool condition, const std::string& message) {
+  std::cout << (condition ? "OK   " : "FAIL ") << message << std::endl;
+  if (!condition) { nFailures++; }
+}
+
+static const uint64_t TimeTagModulo = TimeTagUnwrapper::TimeTagModulo;
+static const double UTC0            = 1700000000;  // 2023-11-14
+static const double ClocksPerSec    = 1 / GROWTH_FY2015_ADC::ClockInterval;
+static const double Tolerance       = 1e-6;  // s
+
+/** Processes one event of the specified board, and returns it as a single-row batch.
+ */
+static GROWTH_FY2015_ADC_Type::EventBatch processEvent(TimeReconstructor& reconstructor, uint64_t timeTag,
+                                                       uint8_t boardIndex = 0) {
+  GROWTH_FY2015_ADC_Type::EventBatch events;
+  const size_t i             = events.appendEvent();
+  events.boardIndex[i]       = boardIndex;
+  events.timeTag[i]          = timeTag & TimeTagUnwrapper::TimeTagMask;
+  events.timeQualityFlags[i] = 0xFF;  // overwritten by process()
+  reconstructor.process(events);
+  return events;
+}
+
+/** Returns the FPGA time tag at sec after the first PPS for a clock faster than nominal by rateOffset.
+ */
+static uint64_t timeTagAt(uint64_t timeTag0, double sec, double rateOffset) {
+  return timeTag0 + static_cast<uint64_t>(std::llround(sec * ClocksPerSec * (1 + rateOffset)));
+}
+
+static void testWithoutAnchor() {
+  TimeReconstructor reconstructor(1, 0.01);
+  auto events = processEvent(reconstructor, 1000);
+  check(events.utcTime[0] == 0, "no anchor: utcTime is 0");
+  check(events.timeQualityFlags[0] == TimeReconstructor::NoTimeModel, "no anchor: NoTimeModel");
+  check(events.unwrappedTimeTag[0] == 1000, "no anchor: unwrappedTimeTag is filled");
+}
+
+static void testNominalClockRate() {
+  TimeReconstructor reconstructor(1, 0.01);
+  reconstructor.addTimeSample(1000, UTC0);
+  auto events = processEvent(reconstructor, timeTagAt(1000, 0.25, 0));
+  check(std::fabs(events.utcTime[0] - (UTC0 + 0.25)) < Tolerance, "one anchor: nominal clock interval used");
+  check(events.timeQualityFlags[0] == (TimeReconstructor::NominalClockRate | TimeReconstructor::Extrapolated),
+        "one anchor: NominalClockRate | Extrapolated");
+  check(reconstructor.getClockRateRatio() == 1.0, "one anchor: clock rate ratio is 1");
+}
+
+static void testInterpolationAndExtrapolation() {
+  // 20 ppm fast clock, and the counter wraps around between the anchors
+  const double rateOffset = 20e-6;
+  const uint64_t timeTag0 = TimeTagModulo - timeTagAt(0, 1.5, rateOffset);
+  TimeReconstructor reconstructor(1, 0.01);
+  for (size_t s = 0; s < 4; s++) { reconstructor.addTimeSample(timeTagAt(timeTag0, s, rateOffset), UTC0 + s); }
+  check(std::fabs(reconstructor.getClockRateRatio() - (1 / (1 + rateOffset))) < 1e-9,
+        "clock rate ratio measured from anchors");
+
+  auto events = processEvent(reconstructor, timeTagAt(timeTag0, 1.75, rateOffset));  // after the wraparound
+  check(std::fabs(events.utcTime[0] - (UTC0 + 1.75)) < Tolerance, "interpolated across the 40-bit wraparound");
+  check(events.timeQualityFlags[0] == 0, "interpolated: no flag");
+  check(events.unwrappedTimeTag[0] > TimeTagModulo, "unwrappedTimeTag continues after the wraparound");
+
+  events = processEvent(reconstructor, timeTagAt(timeTag0, 3.5, rateOffset));
+  check(std::fabs(events.utcTime[0] - (UTC0 + 3.5)) < Tolerance, "extrapolated with the measured clock rate");
+  check(events.timeQualityFlags[0] == TimeReconstructor::Extrapolated, "extrapolated: Extrapolated");
+
+  // the same PPS read again is not a new anchor
+  const size_t nAnchors = reconstructor.getNAnchors();
+  reconstructor.addTimeSample(timeTagAt(timeTag0, 3, rateOffset), UTC0 + 3);
+  check(reconstructor.getNAnchors() == nAnchors, "repeated anchor ignored");
+  check(reconstructor.getNClockJumps() == 0, "no clock jump without a discontinuity");
+}
+
+static void testClockJump() {
+  TimeReconstructor reconstructor(1, 0.01);
+  for (size_t s = 0; s < 3; s++) { reconstructor.addTimeSample(timeTagAt(1000, s, 0), UTC0 + s); }
+
+  // GPS re-lock: UTC deviates from the model by more than the threshold
+  const uint64_t timeTagOfJump = timeTagAt(1000, 3, 0);
+  reconstructor.addTimeSample(timeTagOfJump, UTC0 + 3.5);
+  check(reconstructor.getNClockJumps() == 1, "deviation larger than the threshold counted as a clock jump");
+  auto events = processEvent(reconstructor, timeTagAt(1000, 3.25, 0));
+  check(std::fabs(events.utcTime[0] - (UTC0 + 3.75)) < Tolerance, "model restarted from the anchor after the jump");
+  check(events.timeQualityFlags[0] == (TimeReconstructor::AfterClockJump | TimeReconstructor::NominalClockRate |
+                                       TimeReconstructor::Extrapolated),
+        "after jump: AfterClockJump | NominalClockRate | Extrapolated");
+
+  // the first segment after the jump keeps AfterClockJump until it is complete
+  reconstructor.addTimeSample(timeTagAt(1000, 4, 0), UTC0 + 4.5);
+  events = processEvent(reconstructor, timeTagAt(1000, 3.5, 0));
+  check(events.timeQualityFlags[0] == TimeReconstructor::AfterClockJump, "first segment after jump: AfterClockJump");
+  events = processEvent(reconstructor, timeTagAt(1000, 4.5, 0));
+  check(events.timeQualityFlags[0] == TimeReconstructor::Extrapolated, "beyond the first segment: no AfterClockJump");
+  reconstructor.addTimeSample(timeTagAt(1000, 5, 0), UTC0 + 5.5);
+  events = processEvent(reconstructor, timeTagAt(1000, 3.5, 0));
+  check(events.timeQualityFlags[0] == 0, "AfterClockJump cleared after the next anchor");
+
+  // FPGA reset: the time tag goes backward
+  reconstructor.addTimeSample(2000, UTC0 + 10);
+  check(reconstructor.getNClockJumps() == 2, "backward time tag counted as a clock jump");
+  check(std::fabs(reconstructor.getClockRateRatio() - 1.0) < 1e-12, "clock rate ratio reset after the jump");
+}
+
+static void testOtherBoardsAndRestart() {
+  TimeReconstructor reconstructor(2, 0.01);
+  reconstructor.addTimeSample(1000, UTC0);
+  reconstructor.addTimeSample(timeTagAt(1000, 1, 0), UTC0 + 1);
+
+  auto events = processEvent(reconstructor, 5000, 1);
+  check(events.timeQualityFlags[0] == TimeReconstructor::NoTimeModel && events.utcTime[0] == 0,
+        "second board: NoTimeModel");
+  check(events.unwrappedTimeTag[0] == 5000, "second board: unwrappedTimeTag is filled");
+
+  // the first board was reprogrammed; its counter restarts from 0
+  const uint64_t latest = processEvent(reconstructor, timeTagAt(1000, 1.5, 0)).unwrappedTimeTag[0];
+  reconstructor.restartTimeTag(0);
+  events = processEvent(reconstructor, 10);
+  check(events.timeQualityFlags[0] == TimeReconstructor::NoTimeModel, "after restart: NoTimeModel until an anchor");
+  check(events.unwrappedTimeTag[0] == latest, "after restart: unwrappedTimeTag continues from the latest value");
+  reconstructor.addTimeSample(20, UTC0 + 2);
+  check(reconstructor.getNClockJumps() == 0, "anchor after restart is not a clock jump");
+  events = processEvent(reconstructor, timeTagAt(20, 0.5, 0));
+  check(std::fabs(events.utcTime[0] - (UTC0 + 2.5)) < Tolerance, "after restart: model from the new anchor");
+}
+
+static void testParseGPSTimeRegister() {
+  // "GP" + YYMMDDHHMMSS + time tag latched at PPS (big endian)
+  uint8_t buffer[GROWTH_FY2015_ADC::LengthOfGPSTimeRegister + 1] = "GP231114221320";
+  const uint64_t latchedTimeTag = 0x0012345678ULL;
+  for (size_t i = 0; i < 6; i++) { buffer[14 + i] = (latchedTimeTag >> (8 * (5 - i))) & 0xFF; }
+  uint64_t timeTag = 0;
+  double utcTime   = 0;
+  check(TimeReconstructor::parseGPSTimeRegister(buffer, timeTag, utcTime), "GPS Time Register parsed");
+  check(timeTag == latchedTimeTag, "time tag extracted from the GPS Time Register");
+  check(utcTime == UTC0, "GPS time converted to UNIX time");
+  buffer[5] = ' ';  // GPS not locked
+  check(!TimeReconstructor::parseGPSTimeRegister(buffer, timeTag, utcTime), "invalid GPS time rejected");
+  TimeReconstructor reconstructor(1, 0.01);
+  check(!reconstructor.addGPSTimeRegister(buffer) && reconstructor.getNAnchors() == 0, "invalid register not added");
+}
+
+int main(int argc, char* argv[]) {
+  using namespace std;
+  testWithoutAnchor();
+  testNominalClockRate();
+  testInterpolationAndExtrapolation();
+  testClockJump();
+  testOtherBoardsAndRestart();
+  testParseGPSTimeRegister();
+  if (nFailures != 0) {
+    cout << nFailures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "All checks passed" << endl;
+  return 0;
+}